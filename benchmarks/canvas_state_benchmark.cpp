@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include "canvas.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  // The allocations are counted by the replaced operator new, so only the
+  // C++ objects such as the handles are counted and the cairo objects
+  // aren't.
+  atomic<long> allocation_count(0);
+
+  const int widget_count = 200;
+
+  void print_frame_time(const char *name, int frame_count, const function<void ()> &fun)
+  {
+    fun();
+    long old_allocation_count = allocation_count.load();
+    auto begin_time = chrono::steady_clock::now();
+    for(int i = 0; i < frame_count; i++) fun();
+    chrono::duration<double> duration = chrono::steady_clock::now() - begin_time;
+    double allocations_per_frame = static_cast<double>(allocation_count.load() - old_allocation_count) / frame_count;
+    printf("%-24s %10.1f us/frame %10.1f allocations/frame\n", name, duration.count() * 1000000.0 / frame_count, allocations_per_frame);
+  }
+}
+
+void *operator new(size_t size)
+{
+  allocation_count.fetch_add(1, memory_order_relaxed);
+  void *ptr = malloc(size > 0 ? size : 1);
+  if(ptr == nullptr) throw bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{ free(ptr); }
+
+int main(int argc, char **argv)
+{
+  int frame_count = (argc >= 2 ? atoi(argv[1]) : 1000);
+  CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, 640, 480));
+  ImplCanvas impl_canvas(::cairo_create(surface.get()));
+  Canvas *canvas = &impl_canvas;
+  canvas->set_font_face("Sans", FontSlant::NORMAL, FontWeight::NORMAL);
+  // Each widget saves the state that it changes and restores it from the
+  // handles like a widget that draws its background and its text.
+  auto draw_widget = [&](int i, CanvasPattern *pattern, CanvasTransformation *transformation, CanvasFontFace *font_face, CanvasTransformation *font_transformation) {
+    canvas->translate((i % 20) * 32.0, (i / 20) * 48.0);
+    canvas->set_color(Color(0xff3465a4));
+    canvas->rect(0.0, 0.0, 30.0, 46.0);
+    canvas->fill();
+    canvas->set_font_size(10.0);
+    canvas->set_pattern(pattern);
+    canvas->set_transformation(transformation);
+    canvas->set_font_face(font_face);
+    canvas->set_font_transformation(font_transformation);
+  };
+  unique_ptr<CanvasPattern> pattern(canvas->pattern());
+  unique_ptr<CanvasTransformation> transformation(new_canvas_transformation());
+  unique_ptr<CanvasFontFace> font_face(canvas->font_face());
+  unique_ptr<CanvasTransformation> font_transformation(new_canvas_transformation());
+  print_frame_time("reused handles", frame_count, [&]() {
+    for(int i = 0; i < widget_count; i++) {
+      canvas->get_pattern(pattern.get());
+      canvas->get_transformation(transformation.get());
+      canvas->get_font_face(font_face.get());
+      canvas->get_font_transformation(font_transformation.get());
+      draw_widget(i, pattern.get(), transformation.get(), font_face.get(), font_transformation.get());
+    }
+  });
+  print_frame_time("allocated handles", frame_count, [&]() {
+    for(int i = 0; i < widget_count; i++) {
+      unique_ptr<CanvasPattern> tmp_pattern(canvas->pattern());
+      unique_ptr<CanvasTransformation> tmp_transformation(canvas->transformation());
+      unique_ptr<CanvasFontFace> tmp_font_face(canvas->font_face());
+      unique_ptr<CanvasTransformation> tmp_font_transformation(canvas->font_transformation());
+      draw_widget(i, tmp_pattern.get(), tmp_transformation.get(), tmp_font_face.get(), tmp_font_transformation.get());
+    }
+  });
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include "canvas.hpp"
+#include "text_buffer.hpp"
+#include "text_metrics_cache.hpp"
+#include "util.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  const int line_width = 800;
+
+  // The document is a single paragraph of about 1 MB, so the breaker finds
+  // each break point in the same text line as Text::for_text with line wrap.
+  string new_paragraph()
+  {
+    const char *words[] = {
+      "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+      "Wayland", "toolkit", "renders", "widgets", "\303\263dd", "zebra", "quixotic", "a"
+    };
+    string paragraph;
+    for(size_t i = 0; paragraph.length() < 1024 * 1024; i++) {
+      if(i > 0) paragraph += ' ';
+      paragraph += words[(i * 7 + i / 16) % 16];
+    }
+    return paragraph;
+  }
+
+  // The breaker walks the paragraph once and asks the look-ahead function
+  // for the width of the word after each space.
+  long break_lines(Canvas *canvas, TextMetricsCache &text_metrics_cache, const TextBuffer &buffer, const function<int (const TextCharIterator &, int)> &word_width_fun)
+  {
+    long line_count = 1;
+    int x = 0;
+    for(auto iter = buffer.char_begin(); iter != buffer.char_end(); iter++) {
+      char buf[MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
+      get_utf8(iter, buffer.char_end(), buf);
+      TextMetrics text_metrics;
+      text_metrics_cache.get_text_metrics(canvas, buf, text_metrics);
+      int width = ceil(text_metrics.x_advance);
+      if(*buf == ' ') {
+        auto iter2 = iter;
+        iter2++;
+        if(iter2 != buffer.char_end() && **iter2 != ' ' && line_width < x + width + word_width_fun(iter2, line_width - x - width)) {
+          line_count++;
+          x = 0;
+          continue;
+        }
+      }
+      x += width;
+    }
+    return line_count;
+  }
+
+  void print_time(const char *name, int iteration_count, const function<long ()> &fun)
+  {
+    long line_count = fun();
+    auto begin_time = chrono::steady_clock::now();
+    for(int i = 0; i < iteration_count; i++) fun();
+    chrono::duration<double> duration = chrono::steady_clock::now() - begin_time;
+    printf("%-32s %10.2f ms/layout (%ld lines)\n", name, duration.count() * 1000.0 / iteration_count, line_count);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int iteration_count = (argc >= 2 ? atoi(argv[1]) : 10);
+  // The paragraph isn't edited, so the buffer has no gap.
+  ImplTextBuffer buffer(new_paragraph(), 0);
+  CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, line_width, 64));
+  ImplCanvas canvas(::cairo_create(surface.get()));
+  canvas.set_font_face("Sans", FontSlant::NORMAL, FontWeight::NORMAL);
+  canvas.set_font_size(12);
+  // The characters of a word are looked up one by one in the baseline, which
+  // is the look-ahead before the word widths were memoized.
+  print_time("per-character look-ahead", iteration_count, [&]() {
+    TextMetricsCache text_metrics_cache;
+    return break_lines(&canvas, text_metrics_cache, buffer, [&](const TextCharIterator &first_iter, int max_width) {
+      int width = 0;
+      for(auto iter = first_iter; iter != buffer.char_end(); iter++) {
+        char buf[MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
+        get_utf8(iter, buffer.char_end(), buf);
+        if(*buf == ' ' || *buf == '\t' || *buf == '\n') break;
+        TextMetrics text_metrics;
+        text_metrics_cache.get_text_metrics(&canvas, buf, text_metrics);
+        width += ceil(text_metrics.x_advance);
+        if(width > max_width) break;
+      }
+      return width;
+    });
+  });
+  print_time("memoized word widths", iteration_count, [&]() {
+    TextMetricsCache text_metrics_cache;
+    return break_lines(&canvas, text_metrics_cache, buffer, [&](const TextCharIterator &first_iter, int max_width) {
+      return text_metrics_cache.word_width(&canvas, first_iter, buffer.char_end(), max_width);
+    });
+  });
+  return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+#include "canvas.hpp"
+#include "pixel_kernels.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  const size_t width = 1920, height = 1080;
+
+  void print_throughput(const char *name, int iteration_count, const function<void ()> &fun)
+  {
+    fun();
+    auto begin_time = chrono::steady_clock::now();
+    for(int i = 0; i < iteration_count; i++) fun();
+    chrono::duration<double> duration = chrono::steady_clock::now() - begin_time;
+    printf("%-24s %10.1f Mpixels/s\n", name, iteration_count * width * height / duration.count() / 1000000.0);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int iteration_count = (argc >= 2 ? atoi(argv[1]) : 50);
+  vector<uint32_t> src_pixels(width * height), dst_pixels(width * height);
+  vector<uint8_t> alphas(width * height);
+  for(size_t i = 0; i < src_pixels.size(); i++) {
+    uint32_t a = i % 256;
+    src_pixels[i] = (a << 24) | ((a / 2) << 16) | ((a / 3) << 8) | (a / 4);
+    dst_pixels[i] = 0xff204060;
+    alphas[i] = a;
+  }
+  print_throughput("premultiply_pixels", iteration_count, [&]() { premultiply_pixels(dst_pixels.data(), dst_pixels.size()); });
+  print_throughput("fill_pixels", iteration_count, [&]() { fill_pixels(dst_pixels.data(), dst_pixels.size(), 0x80402010); });
+  print_throughput("blend_pixels_over", iteration_count, [&]() { blend_pixels_over(dst_pixels.data(), src_pixels.data(), dst_pixels.size()); });
+  print_throughput("tint_pixels", iteration_count, [&]() { tint_pixels(dst_pixels.data(), dst_pixels.size(), 0x80402010); });
+  print_throughput("colorize_a8_pixels", iteration_count, [&]() { colorize_a8_pixels(dst_pixels.data(), alphas.data(), alphas.size(), 0x80402010); });
+  print_throughput("blur_a8 (radius 8)", iteration_count, [&]() { blur_a8(alphas.data(), width, width, height, 8); });
+  // The same blending by cairo is the baseline of blend_pixels_over.
+  CairoSurfaceUniquePtr src_surface(::cairo_image_surface_create_for_data(reinterpret_cast<unsigned char *>(src_pixels.data()), ::CAIRO_FORMAT_ARGB32, width, height, width * 4));
+  CairoSurfaceUniquePtr dst_surface(::cairo_image_surface_create_for_data(reinterpret_cast<unsigned char *>(dst_pixels.data()), ::CAIRO_FORMAT_ARGB32, width, height, width * 4));
+  CairoUniquePtr context(::cairo_create(dst_surface.get()));
+  print_throughput("cairo OVER", iteration_count, [&]() {
+    ::cairo_set_source_surface(context.get(), src_surface.get(), 0.0, 0.0);
+    ::cairo_paint(context.get());
+    ::cairo_surface_flush(dst_surface.get());
+  });
+  return 0;
+}
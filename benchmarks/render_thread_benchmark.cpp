@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "display_list.hpp"
+#include "render_thread.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+static shared_ptr<const DisplayList> new_display_list(const Dimension<int> &size)
+{
+  RecordingCanvas recording_canvas;
+  Canvas *canvas = &recording_canvas;
+  canvas->set_color(Color(0xffffffff));
+  canvas->paint();
+  for(int y = 0; y < size.height; y += 24) {
+    for(int x = 0; x < size.width; x += 96) {
+      canvas->set_linear_gradient(x, y, x, y + 20, { ColorStop(0.0, 0xee, 0xee, 0xee), ColorStop(1.0, 0xcc, 0xcc, 0xcc) });
+      canvas->rect(x + 2.0, y + 2.0, 92.0, 20.0);
+      canvas->fill();
+      canvas->set_color(Color(0xff3465a4));
+      canvas->arc(x + 12.0, y + 12.0, 6.0, 0.0, 6.283185307179586);
+      canvas->fill();
+    }
+  }
+  return recording_canvas.display_list();
+}
+
+static double frames_per_second(const shared_ptr<const DisplayList> &display_list, const Dimension<int> &size, unsigned thread_count, int frame_count)
+{
+  RenderThread render_thread([](CanvasModifiableImage *buffer, const vector<Rectangle<int>> &damaged_rects) {}, thread_count);
+  Frame frame;
+  frame.display_list = display_list;
+  frame.size = size;
+  frame.damaged_rects.push_back(Rectangle<int>(0, 0, size.width, size.height));
+  // The first frame allocates the buffers.
+  render_thread.render_frame(frame);
+  auto begin_time = chrono::steady_clock::now();
+  for(int i = 0; i < frame_count; i++) render_thread.render_frame(frame);
+  chrono::duration<double> duration = chrono::steady_clock::now() - begin_time;
+  return frame_count / duration.count();
+}
+
+int main(int argc, char **argv)
+{
+  int frame_count = (argc >= 2 ? atoi(argv[1]) : 100);
+  Dimension<int> size(1920, 1080);
+  shared_ptr<const DisplayList> display_list = new_display_list(size);
+  unsigned max_thread_count = max(thread::hardware_concurrency(), 1U);
+  vector<unsigned> thread_counts;
+  for(unsigned thread_count = 1; thread_count < max_thread_count; thread_count *= 2)
+    thread_counts.push_back(thread_count);
+  thread_counts.push_back(max_thread_count);
+  double single_thread_fps = 0.0;
+  for(unsigned thread_count : thread_counts) {
+    double fps = frames_per_second(display_list, size, thread_count, frame_count);
+    if(thread_count == 1) single_thread_fps = fps;
+    printf("threads: %u, frames/s: %.1f, Mpixels/s: %.1f, speedup: %.2f\n", thread_count, fps, fps * size.width * size.height / 1000000.0, fps / single_thread_fps);
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "styles.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  void print_time(const char *name, int iteration_count, int call_count, const function<void ()> &fun)
+  {
+    fun();
+    auto begin_time = chrono::steady_clock::now();
+    for(int i = 0; i < iteration_count; i++) fun();
+    chrono::duration<double> duration = chrono::steady_clock::now() - begin_time;
+    printf("%-32s %10.1f ns/call\n", name, duration.count() * 1000000000.0 / (static_cast<double>(iteration_count) * call_count));
+  }
+
+  // The styles have the attributes of a typical theme button, so several
+  // attributes match each combination of pseudo classes.
+  void add_button_styles(ImplStyles &styles)
+  {
+    PseudoClasses pseudo_classes_list[] = {
+      PseudoClasses::NONE, PseudoClasses::HOVER, PseudoClasses::ACTIVE, PseudoClasses::FOCUS,
+      PseudoClasses::DISABLED, PseudoClasses::BACKDROP, PseudoClasses::HOVER | PseudoClasses::ACTIVE,
+      PseudoClasses::ADJACENT_TO_LEFT, PseudoClasses::ADJACENT_TO_RIGHT
+    };
+    int i = 0;
+    for(auto pseudo_classes : pseudo_classes_list) {
+      styles.add_margin(pseudo_classes, Edges<int>(i, i, i, i));
+      styles.add_border(pseudo_classes, Edges<int>(1, 1, 1, 1));
+      styles.add_padding(pseudo_classes, Edges<int>(i + 2, i + 4, i + 2, i + 4));
+      styles.add_border_radius(pseudo_classes, Corners<double>(3.0, 3.0, 3.0, 3.0));
+      styles.add_padding_radius(pseudo_classes, Corners<double>(2.0, 2.0, 2.0, 2.0));
+      styles.add_border_colors(pseudo_classes, Edges<Color>(Color(0xff808080), Color(0xff808080), Color(0xff606060), Color(0xff808080)));
+      styles.add_background_color(pseudo_classes, Color(0xff000000 | (i * 0x111111)));
+      styles.add_foreground_color(pseudo_classes, Color(0xff000000 | (0xffffff - i * 0x111111)));
+      i++;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int iteration_count = (argc >= 2 ? atoi(argv[1]) : 100000);
+  ImplStyles styles;
+  add_button_styles(styles);
+  vector<PseudoClasses> widget_pseudo_classes = {
+    PseudoClasses::NONE, PseudoClasses::HOVER, PseudoClasses::HOVER | PseudoClasses::ACTIVE,
+    PseudoClasses::FOCUS | PseudoClasses::HOVER, PseudoClasses::BACKDROP | PseudoClasses::ADJACENT_TO_LEFT
+  };
+  int call_count = widget_pseudo_classes.size() * 5;
+  volatile int sum = 0;
+  auto look_up = [&]() {
+    for(auto pseudo_classes : widget_pseudo_classes) {
+      sum += styles.margin(pseudo_classes).top;
+      sum += styles.border(pseudo_classes).left;
+      sum += styles.padding(pseudo_classes).right;
+      sum += styles.background_color(pseudo_classes).alpha();
+      sum += styles.foreground_color(pseudo_classes).alpha();
+    }
+  };
+  // The memoized lookups are the steady state of drawing; the lookups after
+  // clearing the caches measure the resolution of the attribute lists.
+  print_time("memoized box properties", iteration_count, call_count, look_up);
+  print_time("resolved box properties", iteration_count / 10, call_count, [&]() {
+    styles.clear_caches();
+    look_up();
+  });
+  // The backgrounds are drawn from the cached nine-patch images, so this
+  // measures the lookups of the background properties with the filling.
+  unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(120, 32));
+  unique_ptr<Canvas> canvas(image->canvas());
+  print_time("memoized background drawing", iteration_count / 10, widget_pseudo_classes.size(), [&]() {
+    for(auto pseudo_classes : widget_pseudo_classes)
+      styles.draw_background(pseudo_classes, canvas.get(), Rectangle<int>(0, 0, 120, 32));
+  });
+  return 0;
+}
@@ -23,7 +23,10 @@
 #define _WAYTK_CANVAS_HPP
 
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <initializer_list>
+#include <memory>
 #include <string>
 #include <vector>
 #include <waytk/structs.hpp>
@@ -112,6 +115,20 @@ namespace waytk
     BOLD                        ///< Bold font weight.
   };
 
+  ///
+  /// An enumeration of pixel format.
+  ///
+  enum class PixelFormat
+  {
+    ARGB32,                     ///< 32-bit ARGB pixels with premultiplied
+                                ///  alpha.
+    RGB24,                      ///< 32-bit RGB pixels without alpha where the
+                                ///  upper 8 bits are unused.
+    A8,                         ///< 8-bit alpha pixels for masks.
+    RGB16_565                   ///< 16-bit RGB pixels with 5 bits of red, 6
+                                ///  bits of green, and 5 bits of blue.
+  };
+
   ///
   /// A color class.
   ///
@@ -247,6 +264,11 @@ namespace waytk
     /// Returns the native pattern.
     virtual Native *native() = 0;
 
+    /// Makes this pattern a copy of \p pattern.
+    ///
+    /// The default implementation throws CanvasException.
+    virtual void assign(CanvasPattern *pattern);
+
     friend class Canvas;
   };
 
@@ -268,6 +290,9 @@ namespace waytk
     /// Returns the size of the canvas image.
     virtual Dimension<int> size() = 0;
 
+    /// Returns the pixel format of the canvas image.
+    virtual PixelFormat pixel_format();
+
     /// Returns \c true if the canvas image is modifiable, otherwise \c false.
     virtual bool is_modifiable() const;
 
@@ -290,6 +315,14 @@ namespace waytk
 
     /// Creates a new image that is modifiable copy of the canvas image. 
     virtual CanvasModifiableImage *modifiable_image();
+
+    /// Returns the mip level of the canvas image.
+    ///
+    /// The mip level is the canvas image that is downscaled by two to the power
+    /// of \p level. The level 0 is the canvas image itself and the levels of
+    /// images smaller than one pixel are clamped to the last level. The mip
+    /// levels are created on first use and are owned by the canvas image.
+    virtual CanvasImage *mip_level(int level);
   protected:
     /// Returns the native image.
     virtual Native *native() = 0;
@@ -310,6 +343,61 @@ namespace waytk
     virtual ~CanvasModifiableImage();
 
     virtual bool is_modifiable() const;
+
+    /// Multiplies the color components of the pixels by their alpha
+    /// components.
+    ///
+    /// This method converts pixel data with the straight alpha to the
+    /// premultiplied alpha that is used by the canvas images. The pixel
+    /// operations of the canvas image only support the ARGB32 pixel format and
+    /// the RGB24 pixel format. The default implementation throws
+    /// CanvasException because the pixels can't be accessed by a canvas.
+    virtual void premultiply();
+
+    /// Divides the color components of the pixels by their alpha components.
+    ///
+    /// The default implementation throws CanvasException.
+    virtual void unpremultiply();
+
+    /// Fills the canvas image with \p color.
+    ///
+    /// The default implementation paints \p color by the canvas of the canvas
+    /// image.
+    virtual void fill(Color color);
+
+    /// Blends \p image over the canvas image at the \p p point.
+    ///
+    /// The pixel format of \p image must be the ARGB32 pixel format or the
+    /// RGB24 pixel format. The default implementation paints \p image by the
+    /// canvas of the canvas image.
+    virtual void blend(CanvasImage *image, const Point<int> &p);
+
+    /// Replaces the colors of the pixels with \p color and keeps their alpha
+    /// components as coverage.
+    ///
+    /// The default implementation paints \p color with the \ref Operator::IN
+    /// operator by the canvas of the canvas image.
+    virtual void tint(Color color);
+
+    /// Creates a new canvas image that is downscaled by \p factor with a box
+    /// filter.
+    ///
+    /// The size of the new canvas image is rounded up. The pixels at its
+    /// right edge and at its bottom edge are averaged from the remaining
+    /// pixels when the size isn't divisible by \p factor. The default
+    /// implementation draws the scaled canvas image by the canvas of the new
+    /// canvas image, so the pixels are filtered by the canvas.
+    virtual CanvasModifiableImage *downscale(int factor);
+
+    /// Discards the mip levels of the canvas image.
+    ///
+    /// The mip levels are discarded by the \ref canvas method and the pixel
+    /// operations. This method should be called after the canvas image is
+    /// modified by a previously created canvas or directly in its pixel data.
+    /// A copy of the canvas image that is kept for drawing on other threads is
+    /// also discarded by this method. The default implementation does
+    /// nothing.
+    virtual void discard_mip_levels();
   };
 
   ///
@@ -327,6 +415,42 @@ namespace waytk
     virtual bool is_scalable() const;
   };
 
+  ///
+  /// A source of tiles of a large image.
+  ///
+  /// The tiles form a pyramid of levels where the level 0 has the full
+  /// resolution and each next level is downscaled by two. Only the displayed
+  /// tiles are loaded, so the image doesn't have to fit in memory. The tiles
+  /// are loaded by worker threads.
+  ///
+  class TiledImageSource
+  {
+  protected:
+    /// Default constructor.
+    TiledImageSource() {}
+  public:
+    /// Destructor.
+    virtual ~TiledImageSource();
+
+    /// Returns the size of the image at the level 0.
+    virtual Dimension<int> size() = 0;
+
+    /// Returns the size of the tiles.
+    ///
+    /// The tiles at the right edge and the bottom edge of a level can be
+    /// smaller.
+    virtual Dimension<int> tile_size() = 0;
+
+    /// Returns the number of the levels.
+    virtual int level_count() = 0;
+
+    /// Loads a tile at \p tile_point that is the column and the row of the
+    /// tile at \p level.
+    ///
+    /// This method is invoked by worker threads.
+    virtual CanvasImage *load_tile(int level, const Point<int> &tile_point) = 0;
+  };
+
   ///
   /// A class of canvas path.
   ///
@@ -366,6 +490,11 @@ namespace waytk
     /// Returns the native transformation.
     virtual Native *native() = 0;
 
+    /// Makes this transformation a copy of \p transformation.
+    ///
+    /// The default implementation throws CanvasException.
+    virtual void assign(CanvasTransformation *transformation);
+
     friend class Canvas;
   };
 
@@ -387,6 +516,11 @@ namespace waytk
     /// Returns the native font face.
     virtual Native *native() = 0;
 
+    /// Makes this font face a copy of \p font_face.
+    ///
+    /// The default implementation throws CanvasException.
+    virtual void assign(CanvasFontFace *font_face);
+
     friend class Canvas;
   };
 
@@ -406,11 +540,36 @@ namespace waytk
     virtual void save() = 0;
 
     /// Restores the saved drawing state from an internal stack.
+    ///
+    /// \throw CanvasException if a drawing operation failed, also if the
+    ///   failed operation was performed in a batch.
     virtual void restore() = 0;
 
+    /// Begins a batch of drawing operations.
+    ///
+    /// Failures of operations in a batch aren't checked after each
+    /// operation; they are checked by restore() and end_batch(). Batches can
+    /// be nested. The default implementation does nothing, so a canvas that
+    /// checks each operation doesn't have to override this method.
+    virtual void begin_batch() {}
+
+    /// Ends a batch of drawing operations.
+    ///
+    /// The default implementation does nothing.
+    ///
+    /// \throw CanvasException if an operation in the batch failed.
+    virtual void end_batch() {}
+
     /// Returns the pattern that is used for drawing.
     virtual CanvasPattern *pattern() = 0;
 
+    /// Gets the pattern that is used for drawing into \p pattern.
+    ///
+    /// Unlike pattern(), this method doesn't allocate a new object because
+    /// \p pattern that is returned by pattern() is reused. The default
+    /// implementation copies the result of pattern() and allocates it.
+    virtual void get_pattern(CanvasPattern *pattern);
+
     /// Sets the pattern that is used for drawing.
     virtual void set_pattern(CanvasPattern *pattern) = 0;
 
@@ -455,7 +614,7 @@ namespace waytk
 
     /// Sets the image that is used for drawing.
     void set_image(CanvasImage *image, double x, double y)
-    { set_image(image, x, y); }
+    { set_image(image, Point<double>(x, y)); }
 
     /// \copydoc set_image(CanvasImage *image, double x, double y)
     virtual void set_image(CanvasImage *image, const Point<double> &p) = 0;
@@ -532,6 +691,9 @@ namespace waytk
 
     /// Fills all clip region but with the specified alpha instead of the alpha
     /// of the current color.
+    ///
+    /// The alpha is in the range from 0 to 255 like the alpha component of
+    /// \ref Color.
     virtual void paint(unsigned alpha) = 0;
 
     ///
@@ -635,12 +797,26 @@ namespace waytk
     /// Returns the current transformation that used for drawing.
     virtual CanvasTransformation *transformation() = 0;
 
+    /// Gets the current transformation into \p transformation.
+    ///
+    /// Unlike transformation(), this method doesn't allocate a new object.
+    /// The default implementation copies the result of transformation() and
+    /// allocates it.
+    virtual void get_transformation(CanvasTransformation *transformation);
+
     /// Sets the current transformation that used for drawing.
     virtual void set_transformation(CanvasTransformation *transformation) = 0;
 
     /// Returns the current font face.
     virtual CanvasFontFace *font_face() = 0;
 
+    /// Gets the current font face into \p font_face.
+    ///
+    /// Unlike font_face(), this method doesn't allocate a new object because
+    /// \p font_face that is returned by font_face() is reused. The default
+    /// implementation copies the result of font_face() and allocates it.
+    virtual void get_font_face(CanvasFontFace *font_face);
+
     /// Sets the current font face.
     void set_font_face(const std::string &name)
     { set_font_face(name, FontSlant::NORMAL, FontWeight::NORMAL); }
@@ -674,6 +850,13 @@ namespace waytk
     /// Returns the current font transformation.
     virtual CanvasTransformation *font_transformation() = 0;
 
+    /// Gets the current font transformation into \p transformation.
+    ///
+    /// Unlike font_transformation(), this method doesn't allocate a new
+    /// object. The default implementation copies the result of
+    /// font_transformation() and allocates it.
+    virtual void get_font_transformation(CanvasTransformation *transformation);
+
     /// Sets the current font transformation.
     virtual void set_font_transformation(CanvasTransformation *transformation) = 0;
 
@@ -737,6 +920,43 @@ namespace waytk
     { return font_face->native(); }
   };
 
+  ///
+  /// A guard class of canvas batch.
+  ///
+  /// A canvas batch guard begins a batch of drawing operations when it is
+  /// created and ends the batch when it is destroyed or when end() is called.
+  ///
+  class CanvasBatch
+  {
+    Canvas *_M_canvas;
+  public:
+    /// Constructor.
+    explicit CanvasBatch(Canvas *canvas) :
+      _M_canvas(canvas) { _M_canvas->begin_batch(); }
+
+    /// Destructor.
+    ///
+    /// A failure of the batch isn't thrown by the destructor but a next
+    /// checked operation of the canvas throws it.
+    ~CanvasBatch();
+
+    /// Ends the batch.
+    ///
+    /// \throw CanvasException if an operation in the batch failed.
+    void end()
+    {
+      Canvas *canvas = _M_canvas;
+      _M_canvas = nullptr;
+      if(canvas != nullptr) canvas->end_batch();
+    }
+  };
+
+  /// Creates a new canvas transformation that is an identity transformation.
+  ///
+  /// The created transformation can be reused by
+  /// Canvas::get_transformation() and Canvas::get_font_transformation().
+  CanvasTransformation *new_canvas_transformation();
+
   /// Creates a new canvas image that is modifiable.
   CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size);
 
@@ -751,8 +971,61 @@ namespace waytk
   inline CanvasModifiableImage *new_canvas_modifiable_image(int width, int height, int stride, void *data)
   { return new_canvas_modifiable_image(Dimension<int>(width, height), stride, data); }
 
+  /// Creates a new canvas image that is modifiable and has pixels in
+  /// \p format.
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, PixelFormat format);
+
+  /// \copydoc new_canvas_modifiable_image(const Dimension<int> &size, PixelFormat format)
+  inline CanvasModifiableImage *new_canvas_modifiable_image(int width, int height, PixelFormat format)
+  { return new_canvas_modifiable_image(Dimension<int>(width, height), format); }
+
+  /// Creates a new canvas image that is modifiable and uses pixel data in
+  /// \p format from \p data.
+  ///
+  /// The pixel data isn't copied and must be valid while the image exists.
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, int stride, void *data, PixelFormat format);
+
+  /// Creates a new canvas image that is modifiable and takes ownership of the
+  /// pixel data.
+  ///
+  /// The pixel data isn't copied, so it can be memory that is externally
+  /// allocated or mapped. \p release_fun is invoked with \p data when the
+  /// image and all its users are destroyed. If this function throws an
+  /// exception, the ownership isn't taken.
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, int stride, void *data, PixelFormat format, const std::function<void (void *)> &release_fun);
+
+  /// Returns the minimal stride of pixel data for an image width and a pixel
+  /// format.
+  int canvas_image_stride(int width, PixelFormat format);
+
   /// Loads a canvas image from a file.
   CanvasImage *load_canvas_image(const std::string &file_name);
+
+  /// Loads a canvas image from a file and converts it to \p format.
+  ///
+  /// The loaded image is modifiable.
+  CanvasImage *load_canvas_image(const std::string &file_name, PixelFormat format);
+
+  /// Loads a canvas image from a file in the background.
+  ///
+  /// The image is decoded by a worker thread and it is cached by the file
+  /// name, so loads of the same file share one image. A cached image is
+  /// loaded again if the file was modified after the image was loaded. A loaded image isn't
+  /// modifiable because it can be shared; CanvasImage::modifiable_image()
+  /// returns its modifiable copy.
+  std::shared_future<std::shared_ptr<CanvasImage>> load_canvas_image_async(const std::string &file_name);
+
+  /// Creates a new tiled image source that loads tiles from a directory.
+  ///
+  /// The directory contains an \c info file with the width, the height, and
+  /// the tile size of the image that are separated by whitespace, and the
+  /// tile files that are named \c L/C_R.png where \c L is the level, \c C is
+  /// the column, and \c R is the row. The levels continue until the image
+  /// fits in one tile.
+  ///
+  /// \throw IOException if the info file can't be read.
+  /// \throw FileFormatException if the info file is invalid.
+  TiledImageSource *load_tiled_image_source(const std::string &dir_name);
 }
 
 #endif
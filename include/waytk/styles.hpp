@@ -22,6 +22,8 @@
 #ifndef _WAYTK_STYLES_HPP
 #define _WAYTK_STYLES_HPP
 
+#include <cstddef>
+#include <string>
 #include <waytk/canvas.hpp>
 #include <waytk/structs.hpp>
 
@@ -128,6 +130,15 @@ namespace waytk
     /// \copydoc draw_background(PseudoClasses pseudo_classes, Canvas *canvas, int x, int y, int width, int height) const
     virtual void draw_background(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const = 0;
 
+    ///
+    /// Returns a visual overflow for pseudo classes.
+    ///
+    /// The visual overflow is a width of the area outside a background that
+    /// is drawn by the background, for example, by its box shadow. By default,
+    /// the background doesn't overflow.
+    ///
+    virtual Edges<int> visual_overflow(PseudoClasses pseudo_classes) const;
+
     /// Returns a background color for pseudo classes.
     virtual Color background_color(PseudoClasses pseudo_classes) const = 0;
     
@@ -139,6 +150,38 @@ namespace waytk
     virtual bool has_adjacency_to() = 0;
   };
 
+  ///
+  /// Loads a theme from a YAML file.
+  ///
+  /// The loaded theme is compiled to a binary file in the cache directory. The
+  /// compiled theme is used instead of the YAML file while the YAML file isn't
+  /// changed. If no theme is loaded, the theme from the \c WAYTK_THEME
+  /// environment variable or the \c waytk/theme.yaml file from the data
+  /// directories is loaded.
+  ///
+  /// \throw IOException if an I/O error occurs.
+  /// \throw FileFormatException if the theme file is invalid.
+  ///
+  void load_theme(const std::string &file_name);
+
+  ///
+  /// Interns a style name and returns an identifier of the style name.
+  ///
+  /// Equal style names always have the same identifier, so styles can be
+  /// found by the identifier without comparing strings.
+  ///
+  std::size_t intern_style_name(const char *name);
+
+  ///
+  /// Finds styles for an identifier of an interned style name.
+  ///
+  /// The styles are found without locking, so this function is fast enough
+  /// for each drawing of a widget. The found styles stay valid after a next
+  /// theme is loaded because the styles of the previous themes are kept until
+  /// the program ends, but they don't have the attributes of the next theme.
+  ///
+  Styles *find_styles_by_name_id(std::size_t name_id);
+
   /// Finds styles for a specified name.
   Styles *find_styles(const char *name);
 }
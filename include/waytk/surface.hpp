@@ -26,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 #include <waytk/callback.hpp>
 #include <waytk/canvas.hpp>
 #include <waytk/structs.hpp>
@@ -102,11 +103,13 @@ namespace waytk
     bool _M_is_resizable;
     bool _M_is_visible;
     Dimension<int> _M_size;
+    Edges<int> _M_shadow_margin;
     OnSizeChangeCallback _M_on_size_change_callback;
     OnTouchCancelCallback _M_on_touch_cancel_callback;
     Widget *_M_focused_widget;
     std::map<Pointer, TouchInfo, PointerCompare> _M_touch_infos;
     std::map<Pointer, Widget *, PointerCompare> _M_touch_leaving_lock_widgets;
+    std::vector<Rectangle<int>> _M_damaged_rects;
   public:
     /// Creates a new toplevel surface without a title.
     Surface(Widget *widget);
@@ -138,7 +141,10 @@ namespace waytk
 
     /// Sets the root widget of the surface.
     void set_root_widget(Widget *widget)
-    { _M_root_widget = std::unique_ptr<Widget>(widget); }
+    {
+      _M_root_widget = std::unique_ptr<Widget>(widget);
+      damage_all();
+    }
 
     ///
     /// Returns \c true if the surface is active, otherwise \c false.
@@ -273,8 +279,68 @@ namespace waytk
     {
       _M_size.width = (size.width >= 1 ? size.width : 1);
       _M_size.height = (size.width >= 1 ? size.height : 1);
+      damage_all();
+    }
+
+    /// Returns the surface shadow margin.
+    const Edges<int> &shadow_margin() const
+    { return _M_shadow_margin; }
+
+    ///
+    /// Sets the surface shadow margin.
+    ///
+    /// The shadow margin is a transparent area of the surface around the root
+    /// widget, so the box shadow of the root widget isn't cut by the surface
+    /// edges. The root widget is laid out inside this margin. By default, the
+    /// surface hasn't the shadow margin.
+    ///
+    void set_shadow_margin(const Edges<int> &margin)
+    {
+      _M_shadow_margin = margin;
+      damage_all();
+    }
+
+    ///
+    /// Returns the damaged rectangles of the surface.
+    ///
+    /// The damaged region of the surface is an union of these rectangles. Only
+    /// this region is redrawn and should be passed to the compositor as buffer
+    /// damage. The rectangles can overlap.
+    ///
+    const std::vector<Rectangle<int>> &damaged_rects() const
+    { return _M_damaged_rects; }
+
+    /// Returns \c true if the surface has a damaged region, otherwise
+    /// \c false.
+    bool is_damaged() const
+    { return !_M_damaged_rects.empty(); }
+
+    /// Returns \c true if \p rect intersects the damaged region of the
+    /// surface, otherwise \c false.
+    bool is_damaged(const Rectangle<int> &rect) const;
+
+    /// Adds a rectangle to the damaged region of the surface.
+    void damage(const Rectangle<int> &rect);
+
+    /// Damages the whole surface.
+    void damage_all()
+    {
+      _M_damaged_rects.clear();
+      _M_damaged_rects.push_back(Rectangle<int>(Point<int>(0, 0), _M_size));
     }
 
+    /// Clears the damaged region of the surface after a buffer commit.
+    void clear_damage()
+    { _M_damaged_rects.clear(); }
+
+    ///
+    /// Draws the damaged region of the surface.
+    ///
+    /// The canvas is clipped to the damaged region and the widgets that are
+    /// outside this region are skipped. The damaged region isn't cleared.
+    ///
+    void draw(Canvas *canvas);
+
     /// Returns the listener for changes of the surface size.
     const OnSizeChangeListener &on_size_change_listener() const
     { return _M_on_size_change_callback.listener(); }
@@ -384,6 +384,24 @@ namespace waytk
     /// Returns the number of the text lines.
     virtual std::size_t line_count() const = 0;
 
+    ///
+    /// Returns the offset of the text byte that is indicated by an iterator of
+    /// the text characters.
+    ///
+    /// The offset is counted from the beginning of the text. The default
+    /// implementation of this method counts the bytes.
+    ///
+    virtual std::size_t char_iter_to_byte_offset(const TextCharIterator &iter) const;
+
+    ///
+    /// Returns an iterator of the text characters for an offset of the text
+    /// byte.
+    ///
+    /// The offset should be an offset of the first byte of a character. The
+    /// default implementation of this method counts the bytes.
+    ///
+    virtual TextCharIterator byte_offset_to_char_iter(std::size_t offset) const;
+
     /// Returns the cursor iterator of the text buffer.
     virtual TextCharIterator cursor_iter() const = 0;
 
@@ -24,6 +24,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <list>
 #include <memory>
@@ -48,6 +49,12 @@ namespace waytk
   class Surface;
   class Widget;
 
+  namespace priv
+  {
+    class ImageViewport;
+    class TextViewport;
+  }
+
   ///
   /// An enumeration of horizontal alignment.
   ///
@@ -576,8 +583,22 @@ namespace waytk
     std::weak_ptr<Surface> _M_surface;
     Widget *_M_parent;
     const char *_M_style_name;
+    std::size_t _M_style_name_id;
     Styles *_M_styles;
+    unsigned _M_styles_generation;
+    bool _M_has_resolved_styles;
+    PseudoClasses _M_resolved_pseudo_classes;
+    Edges<int> _M_resolved_margin;
+    Edges<int> _M_resolved_border;
+    Edges<int> _M_resolved_padding;
+    Color _M_resolved_foreground_color;
+    Color _M_resolved_background_color;
+    Edges<int> _M_resolved_visual_overflow;
+    std::vector<std::pair<const char *, std::size_t>> _M_block_style_name_ids;
     Dimension<int> _M_content_size;
+    bool _M_has_layer;
+    bool _M_is_layer_valid;
+    std::unique_ptr<CanvasModifiableImage> _M_layer_image;
     OnTouchCallback _M_on_touch_callback;
     OnTouchLeaveCallback _M_on_touch_leave_callback;
     OnPointerMotionCallback _M_on_pointer_motion_callback;
@@ -634,9 +655,13 @@ namespace waytk
     PseudoClasses pseudo_classes() const
     { return _M_pseudo_classes; }
 
+    ///
     /// Sets the pseudo classe of the widget.
-    void set_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_pseudo_classes = pseudo_classes; }
+    ///
+    /// The visual bounds of the widget for the old pseudo classes and the new
+    /// pseudo classes are damaged because they can differ.
+    ///
+    void set_pseudo_classes(PseudoClasses pseudo_classes);
     
     ///
     /// Returns \c true if the widget is visible, otherwise \c false.
@@ -651,7 +676,10 @@ namespace waytk
     /// Sets the widget as visible if \p is_visible is \c true, otherwise sets
     /// the widget as invisible.
     void set_visibale(bool is_visible)
-    { _M_is_visible = is_visible; }
+    {
+      if(_M_is_visible != is_visible) invalidate();
+      _M_is_visible = is_visible;
+    }
 
     ///
     /// Returns the horizontal alignment of the widget.
@@ -759,6 +787,42 @@ namespace waytk
     void set_bounds(const Rectangle<int> &bounds)
     { _M_bounds = bounds; }
   public:
+    ///
+    /// Returns the widget visual bounds.
+    ///
+    /// The visual bounds are the widget bounds that are extended by the visual
+    /// overflow of the widget background, for example, by a box shadow. The
+    /// visual bounds are damaged after an invalidation of the widget.
+    ///
+    Rectangle<int> visual_bounds();
+    ///
+    /// Returns \c true if the widget has a layer, otherwise \c false.
+    ///
+    /// If the widget has a layer, the widget and its descendants are drawn on
+    /// an offscreen image that is only redrawn after an invalidation of the
+    /// widget. Otherwise, this image is just drawn on the canvas. By default,
+    /// each widget of WayTK hasn't a layer.
+    ///
+    bool has_layer() const
+    { return _M_has_layer; }
+
+    /// Sets the widget layer if \p has_layer is \c true, otherwise unsets the
+    /// widget layer.
+    void set_layer(bool has_layer);
+
+    ///
+    /// Invalidates the widget.
+    ///
+    /// The layers of the widget and its ascendants are redrawn at next drawing
+    /// and the widget visual bounds are added to the damaged region of the
+    /// surface.
+    /// This method should be invoked if the widget content is changed.
+    ///
+    void invalidate();
+  private:
+    void damage(const Rectangle<int> &rect);
+  public:
+
     /// Returns the widget surface.
     const std::weak_ptr<Surface> &surface();
 
@@ -805,12 +869,34 @@ namespace waytk
     
     /// Returns the widget margin.
     Edges<int> margin()
-    { return styles()->margin(_M_pseudo_classes); }
+    { resolve_styles(); return _M_resolved_margin; }
+
+    /// Returns the widget border.
+    Edges<int> border()
+    { resolve_styles(); return _M_resolved_border; }
+
+    /// Returns the widget padding.
+    Edges<int> padding()
+    { resolve_styles(); return _M_resolved_padding; }
+
+    /// Returns the widget foreground color.
+    Color foreground_color()
+    { resolve_styles(); return _M_resolved_foreground_color; }
+
+    /// Returns the widget background color.
+    Color background_color()
+    { resolve_styles(); return _M_resolved_background_color; }
+
+    /// Returns the widget visual overflow.
+    Edges<int> visual_overflow()
+    { resolve_styles(); return _M_resolved_visual_overflow; }
 
     /// Returns \c true if the widget can be adjacent to other widget, otherwise
     /// \c false.
     bool has_adjacency_to(Widget *widget)
     { return styles()->has_adjacency_to(); }
+  private:
+    void resolve_styles();
   protected:
     /// Returns the content size of the widget.
     const Dimension<int> &content_size() const
@@ -934,6 +1020,8 @@ namespace waytk
 
     /// Draws the widget.
     virtual void draw(Canvas *canvas);
+  private:
+    void draw_without_layer(Canvas *canvas);
   protected:
     /// Draws the widget content.
     virtual void draw_content(Canvas *canvas, const Rectangle<int> &inner_bounds);
@@ -1005,6 +1093,14 @@ namespace waytk
     /// This method that is invoked when the widget is scrolled.
     virtual void on_scroll(Viewport *viewport);
   protected:
+    ///
+    /// Returns an identifier of an interned style name of a block.
+    ///
+    /// The identifiers are cached by the block names, so each block name
+    /// should be a string that isn't changed, for example a string literal.
+    ///
+    std::size_t block_style_name_id(const char *name);
+
     /// Returns a margin box size of a block.
     Dimension<int> block_margin_box_size(const char *name, PseudoClasses pseudo_classes, const Dimension<int> &content_size);
 
@@ -1270,6 +1366,16 @@ namespace waytk
     FontWeight _M_font_weight;
     bool _M_has_font_size;
     int _M_font_size;
+    bool _M_has_monospace_font;
+    bool _M_has_checked_font_pitch;
+    bool _M_has_fixed_font_pitch;
+    bool _M_has_char_advances;
+    int _M_char_advance;
+    int _M_password_char_advance;
+    bool _M_has_cached_column;
+    TextCharIterator _M_cached_column_iter;
+    std::size_t _M_cached_column;
+    std::size_t _M_cached_column_tab_spaces;
     bool _M_is_editable;
     bool _M_has_insert_mode;
     OnTextChangeCallback _M_on_text_change_callback;
@@ -1277,6 +1383,18 @@ namespace waytk
     OnTextSelectionCallback _M_on_text_selection_callback;
     bool _M_has_foreground_color;
     Color _M_foreground_color;
+    std::vector<std::size_t> _M_line_offsets;
+    std::vector<std::size_t> _M_line_char_indices;
+    std::vector<std::size_t> _M_line_columns;
+    std::vector<bool> _M_line_fixed_column_flags;
+    std::vector<long> _M_line_height_lines;
+    std::vector<long> _M_line_height_line_tree;
+    std::size_t _M_max_line_columns;
+    std::size_t _M_line_index_byte_count;
+    std::size_t _M_line_index_tab_spaces;
+    bool _M_has_line_index;
+    bool _M_has_view_point_change;
+    int _M_line_height;
   protected:
     /// Constructor that doesn't invoke the \ref initialize method.
     Text(Unused unused) {}
@@ -1476,6 +1594,23 @@ namespace waytk
     /// Unsets the font size of the text widget.
     void unset_font_size();
 
+    ///
+    /// Returns \c true if the font of the text widget is declared as a
+    /// monospace font, otherwise \c false.
+    ///
+    /// If the font is a monospace font, the text widget lays out the text by
+    /// column counts without measuring each character. The font pitch is also
+    /// detected if the font isn't declared as a monospace font. By default,
+    /// the font isn't declared as a monospace font.
+    ///
+    bool has_monospace_font() const
+    { return _M_has_monospace_font; }
+
+    /// Declares the font of the text widget as a monospace font if
+    /// \p has_monospace_font is \c true, otherwise the font pitch is detected.
+    void set_monospace_font(bool has_monospace_font)
+    { _M_has_monospace_font = has_monospace_font; }
+
     /// Returns \c true if the text widget is editable, otherwise \c false.
     bool is_editable() const
     { return _M_is_editable; }
@@ -1552,6 +1687,8 @@ namespace waytk
     virtual void on_touch_leave(const Pointer &pointer);
 
     virtual bool on_key(std::uint32_t key_sym, Modifiers modifiers, const char *utf8, KeyState state);
+
+    using Widget::foreground_color;
   protected:
     /// This method is invoked when the text is changed.
     virtual void on_text_change(const Range<TextCharIterator> &range);
@@ -1574,6 +1711,16 @@ namespace waytk
     
     TextDimension for_text_backward(Canvas *canvas, const TextCharIterator &first_iter, const FontMetrics &font_metrics, const std::function<std::pair<bool, bool> (const FontMetrics &, const TextMetrics &, const TextCharIterator &, const TextPoint &, std::size_t, bool)> &cond_fun, const std::function<void (const FontMetrics &, const TextMetrics &, const TextCharIterator &, const TextPoint &, std::size_t, bool)> &iter_fun);
 
+    bool has_fixed_font_pitch(Canvas *canvas);
+
+    bool find_column_from_cached_column(const TextCharIterator &iter, std::size_t &column);
+
+    bool find_fixed_column(const TextCharIterator &iter, std::size_t &column) const;
+
+    bool find_fixed_column_iter(const TextCharIterator &line_iter, std::size_t column, TextCharIterator &iter) const;
+
+    bool find_fixed_pitch_x(const TextCharIterator &iter, int &x) const;
+
     std::size_t cursor_column(Canvas *canvas);
     
     std::size_t iter_column(Canvas *canvas, TextCharIterator iter);
@@ -1605,6 +1752,28 @@ namespace waytk
     void update_visible_point_for_move_left(Canvas *canvas);
     
     void update_visible_point_for_move_right(Canvas *canvas);
+
+    bool has_valid_line_index() const;
+
+    void update_line_index(Canvas *canvas);
+
+    void update_line_index_for_change(std::size_t offset, std::size_t deleted_byte_count, std::size_t inserted_byte_count);
+
+    void scan_lines(std::size_t offset, std::size_t end_offset, std::size_t char_index, std::vector<std::size_t> &line_offsets, std::vector<std::size_t> &line_char_indices, std::vector<std::size_t> &line_columns, std::vector<bool> &line_fixed_column_flags);
+
+    void build_line_height_line_tree();
+
+    std::size_t iter_line(const TextCharIterator &iter) const;
+
+    std::size_t offset_line(std::size_t offset) const;
+
+    void set_line_height_line(std::size_t line, long height_line);
+
+    void update_first_visible_iter_for_view_point(Canvas *canvas);
+
+    void update_view_point_for_first_visible_iter(Canvas *canvas);
+
+    friend class priv::TextViewport;
   };
 
   ///
@@ -1959,7 +2128,10 @@ namespace waytk
 
     /// Sets the value of the progress bar.
     void set_value(int value)
-    { _M_value = (value < _M_max_value ? value : _M_max_value); }
+    {
+      _M_value = (value < _M_max_value ? value : _M_max_value);
+      invalidate();
+    }
 
     virtual const char *name() const;
   protected:
@@ -1980,6 +2152,14 @@ namespace waytk
   class Image : public Widget
   {
     std::shared_ptr<CanvasImage> _M_image;
+    std::shared_future<std::shared_ptr<CanvasImage>> _M_image_future;
+    std::string _M_image_file_name;
+    std::shared_ptr<Image *> _M_load_owner;
+    std::shared_ptr<TiledImageSource> _M_tiled_image_source;
+    std::vector<std::shared_future<std::shared_ptr<CanvasImage>>> _M_tile_futures;
+    bool _M_is_scaled;
+    bool _M_has_view_bounds;
+    Rectangle<int> _M_view_bounds;
   protected:
     /// Default constructor that doesn't invoke the \ref initialize method.
     Image() {}
@@ -2049,11 +2229,74 @@ namespace waytk
     void load(const std::string &file_name)
     { set_image(std::shared_ptr<CanvasImage>(load_canvas_image(file_name))); }
 
+    /// Loads an image from the file in the background.
+    ///
+    /// The previous image is displayed until the loaded image is ready. The
+    /// main loop sets the loaded image and invalidates the image widget when
+    /// the loaded image is ready; \ref update_image also sets it. If the
+    /// image can't be loaded, the image widget displays no image and the error
+    /// is reported to the standard error.
+    void load_async(const std::string &file_name);
+
+    /// Returns \c true if the image is loaded in the background, otherwise
+    /// \c false.
+    bool is_loading() const
+    { return _M_image_future.valid(); }
+
+    /// Sets the image from the background loading if the loaded image is
+    /// ready and invalidates the image widget if tiles of a tiled image were
+    /// loaded since the last drawing.
+    ///
+    /// \return \c true if the image was set or tiles were loaded, otherwise
+    ///   \c false.
+    bool update_image();
+
+    /// Returns the tiled image source of the image widget or \c nullptr if
+    /// the image widget doesn't display a tiled image.
+    const std::shared_ptr<TiledImageSource> &tiled_image_source() const
+    { return _M_tiled_image_source; }
+
+    /// Sets the tiled image source of the image widget.
+    ///
+    /// The image widget only loads the tiles that are visible in its viewport
+    /// at the level that is the closest to the displayed size. The tiles are
+    /// loaded in the background and are cached in a bounded tile cache. A tile
+    /// of a coarser level is displayed until the tile is loaded, and the main
+    /// loop invalidates the image widget when the tile is loaded.
+    void set_tiled_image_source(TiledImageSource *source)
+    { set_tiled_image_source(std::shared_ptr<TiledImageSource>(source)); }
+
+    /// \copydoc set_tiled_image_source(TiledImageSource *)
+    void set_tiled_image_source(const std::shared_ptr<TiledImageSource> &source);
+
+    /// Returns \c true if the image is scaled to the image widget, otherwise
+    /// \c false.
+    bool is_scaled() const
+    { return _M_is_scaled; }
+
+    /// Sets the image as scaled to the image widget if \p is_scaled is
+    /// \c true, otherwise the image is displayed in its size.
+    ///
+    /// The scaled image is drawn from the closest mip level of the image that
+    /// isn't smaller than the image widget.
+    void set_scaled(bool is_scaled)
+    { _M_is_scaled = is_scaled; invalidate(); }
+
     virtual const char *name() const;
+
+    virtual Viewport *viewport();
   protected:
     virtual void update_content_size(Canvas *canvas, const Dimension<int> &area_size);
 
     virtual void draw_content(Canvas *canvas, const Rectangle<int> &inner_bounds);
+  private:
+    bool take_loaded_image();
+
+    std::function<void ()> update_listener();
+
+    void draw_tiles(Canvas *canvas, const Rectangle<int> &inner_bounds);
+
+    friend class priv::ImageViewport;
   };
 
   ///
@@ -2972,7 +3215,10 @@ namespace waytk
 
     /// Sets the pseudo class of the horizontal scroll bar.
     void set_h_scroll_bar_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_h_scroll_bar_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_h_scroll_bar_pseudo_classes != pseudo_classes) invalidate();
+      _M_h_scroll_bar_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the horizontal scroll bar.
     const Dimension<int> &h_scroll_bar_margin_box_size() const
@@ -3018,7 +3264,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the left button.
     void set_left_button_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_left_button_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_left_button_pseudo_classes != pseudo_classes) invalidate();
+      _M_left_button_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the left button.
     const Dimension<int> &left_button_margin_box_size() const
@@ -3051,7 +3300,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the horizontal slider.
     void set_h_slider_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_h_slider_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_h_slider_pseudo_classes != pseudo_classes) invalidate();
+      _M_h_slider_pseudo_classes = pseudo_classes;
+    }
     
     /// Returns the margin box size of the horizontal slider.
     const Dimension<int> &h_slider_margin_box_size() const
@@ -3096,7 +3348,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the right button.
     void set_right_button_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_right_button_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_right_button_pseudo_classes != pseudo_classes) invalidate();
+      _M_right_button_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the right button.
     const Dimension<int> &right_button_margin_box_size() const
@@ -3129,7 +3384,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the vertical scroll bar.
     void set_v_scroll_bar_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_v_scroll_bar_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_v_scroll_bar_pseudo_classes != pseudo_classes) invalidate();
+      _M_v_scroll_bar_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the vertical scroll bar.
     const Dimension<int> &v_scroll_bar_margin_box_size() const
@@ -3175,7 +3433,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the top button.
     void set_top_button_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_top_button_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_top_button_pseudo_classes != pseudo_classes) invalidate();
+      _M_top_button_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the top button.
     const Dimension<int> &top_button_margin_box_size() const
@@ -3208,7 +3469,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the vertical slider.
     void set_v_slider_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_v_slider_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_v_slider_pseudo_classes != pseudo_classes) invalidate();
+      _M_v_slider_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the vertical slider.
     const Dimension<int> &v_slider_margin_box_size() const
@@ -3253,7 +3517,10 @@ namespace waytk
 
     /// Sets the pseudo classes of the bottom button.
     void set_bottom_button_pseudo_classes(PseudoClasses pseudo_classes)
-    { _M_bottom_button_pseudo_classes = pseudo_classes; }
+    {
+      if(_M_bottom_button_pseudo_classes != pseudo_classes) invalidate();
+      _M_bottom_button_pseudo_classes = pseudo_classes;
+    }
 
     /// Returns the margin box size of the bottom button.
     const Dimension<int> &bottom_button_margin_box_size() const
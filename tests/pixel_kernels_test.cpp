@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "canvas.hpp"
+#include "pixel_kernels.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  int failure_count = 0;
+  mt19937 random_generator(12345);
+
+  void check(bool is_passed, const char *test_name, const char *message, size_t i)
+  {
+    if(is_passed) return;
+    fprintf(stderr, "%s: %s at %zu\n", test_name, message, i);
+    failure_count++;
+  }
+
+  uint32_t random_pixel()
+  { return random_generator(); }
+
+  // Returns a random premultiplied pixel, so its color components aren't
+  // greater than its alpha component.
+  uint32_t random_premultiplied_pixel()
+  {
+    uint32_t a = random_generator() % 256;
+    uint32_t pixel = a << 24;
+    for(int shift = 0; shift < 24; shift += 8) pixel |= (random_generator() % (a + 1)) << shift;
+    return pixel;
+  }
+
+  uint32_t ref_mul(uint32_t x, uint32_t a)
+  { return (x * a + 127) / 255; }
+
+  uint32_t ref_component(uint32_t pixel, int shift)
+  { return (pixel >> shift) & 0xff; }
+
+  bool is_near(uint32_t pixel1, uint32_t pixel2, uint32_t tolerance)
+  {
+    for(int shift = 0; shift < 32; shift += 8) {
+      int diff = static_cast<int>(ref_component(pixel1, shift)) - static_cast<int>(ref_component(pixel2, shift));
+      if(static_cast<uint32_t>(abs(diff)) > tolerance) return false;
+    }
+    return true;
+  }
+
+  // The counts cover the vector loops and the scalar tails of the kernels.
+  const size_t max_count = 67;
+
+  //
+  // Tests against scalar references.
+  //
+
+  void test_premultiply_pixels()
+  {
+    for(size_t count = 0; count <= max_count; count++) {
+      vector<uint32_t> pixels(count);
+      generate(pixels.begin(), pixels.end(), random_pixel);
+      vector<uint32_t> expected_pixels(pixels);
+      for(auto &pixel : expected_pixels) {
+        uint32_t a = pixel >> 24;
+        pixel = (a << 24) | (ref_mul(ref_component(pixel, 16), a) << 16) | (ref_mul(ref_component(pixel, 8), a) << 8) | ref_mul(ref_component(pixel, 0), a);
+      }
+      premultiply_pixels(pixels.data(), count);
+      for(size_t i = 0; i < count; i++)
+        check(pixels[i] == expected_pixels[i], "premultiply_pixels", "pixel differs", i);
+    }
+  }
+
+  void test_unpremultiply_pixels()
+  {
+    vector<uint32_t> pixels(max_count);
+    generate(pixels.begin(), pixels.end(), random_premultiplied_pixel);
+    pixels[0] = 0;
+    pixels[1] = 0xff123456;
+    vector<uint32_t> unpremultiplied_pixels(pixels);
+    unpremultiply_pixels(unpremultiplied_pixels.data(), unpremultiplied_pixels.size());
+    check(unpremultiplied_pixels[0] == 0, "unpremultiply_pixels", "transparent pixel differs", 0);
+    check(unpremultiplied_pixels[1] == 0xff123456, "unpremultiply_pixels", "opaque pixel differs", 1);
+    // The premultiplication of the unpremultiplied pixels restores the pixels.
+    premultiply_pixels(unpremultiplied_pixels.data(), unpremultiplied_pixels.size());
+    for(size_t i = 0; i < pixels.size(); i++)
+      check(is_near(unpremultiplied_pixels[i], pixels[i], 1), "unpremultiply_pixels", "round trip differs", i);
+  }
+
+  void test_fill_pixels()
+  {
+    for(size_t count = 0; count <= max_count; count++) {
+      vector<uint32_t> pixels(count + 1, 0xdeadbeef);
+      fill_pixels(pixels.data(), count, 0x80402010);
+      for(size_t i = 0; i < count; i++)
+        check(pixels[i] == 0x80402010, "fill_pixels", "pixel differs", i);
+      check(pixels[count] == 0xdeadbeef, "fill_pixels", "pixel after end is modified", count);
+    }
+  }
+
+  void test_blend_pixels_over()
+  {
+    for(size_t count = 0; count <= max_count; count++) {
+      vector<uint32_t> src_pixels(count), dst_pixels(count);
+      generate(src_pixels.begin(), src_pixels.end(), random_premultiplied_pixel);
+      generate(dst_pixels.begin(), dst_pixels.end(), random_premultiplied_pixel);
+      vector<uint32_t> expected_pixels(count);
+      for(size_t i = 0; i < count; i++) {
+        uint32_t ia = 255 - (src_pixels[i] >> 24);
+        for(int shift = 0; shift < 32; shift += 8) {
+          uint32_t c = ref_component(src_pixels[i], shift) + ref_mul(ref_component(dst_pixels[i], shift), ia);
+          expected_pixels[i] |= min<uint32_t>(c, 255) << shift;
+        }
+      }
+      blend_pixels_over(dst_pixels.data(), src_pixels.data(), count);
+      for(size_t i = 0; i < count; i++)
+        check(dst_pixels[i] == expected_pixels[i], "blend_pixels_over", "pixel differs", i);
+    }
+  }
+
+  void test_tint_pixels()
+  {
+    uint32_t color = 0xc0604020;
+    for(size_t count = 0; count <= max_count; count++) {
+      vector<uint32_t> pixels(count);
+      generate(pixels.begin(), pixels.end(), random_premultiplied_pixel);
+      vector<uint32_t> expected_pixels(count);
+      for(size_t i = 0; i < count; i++) {
+        uint32_t a = pixels[i] >> 24;
+        for(int shift = 0; shift < 32; shift += 8)
+          expected_pixels[i] |= ref_mul(ref_component(color, shift), a) << shift;
+      }
+      tint_pixels(pixels.data(), count, color);
+      for(size_t i = 0; i < count; i++)
+        check(pixels[i] == expected_pixels[i], "tint_pixels", "pixel differs", i);
+    }
+  }
+
+  void test_colorize_a8_pixels()
+  {
+    uint32_t color = 0xc0604020;
+    for(size_t count = 0; count <= max_count; count++) {
+      vector<uint8_t> alphas(count);
+      for(auto &alpha : alphas) alpha = random_generator() % 256;
+      vector<uint32_t> pixels(count);
+      colorize_a8_pixels(pixels.data(), alphas.data(), count, color);
+      for(size_t i = 0; i < count; i++) {
+        uint32_t expected_pixel = 0;
+        for(int shift = 0; shift < 32; shift += 8)
+          expected_pixel |= ref_mul(ref_component(color, shift), alphas[i]) << shift;
+        check(pixels[i] == expected_pixel, "colorize_a8_pixels", "pixel differs", i);
+      }
+    }
+  }
+
+  void test_box_blur_a8_columns()
+  {
+    const int width = 37, height = 29;
+    vector<uint8_t> src_data(width * height);
+    for(auto &alpha : src_data) alpha = random_generator() % 256;
+    for(int radius = 1; radius <= 20; radius += 3) {
+      vector<uint8_t> dst_data(width * height);
+      box_blur_a8_columns(dst_data.data(), width, src_data.data(), width, width, height, radius);
+      for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+          // The pixels outside the image are transparent.
+          uint32_t sum = 0;
+          for(int i = max(y - radius, 0); i <= min(y + radius, height - 1); i++) sum += src_data[i * width + x];
+          int expected_alpha = (sum * 2 + 2 * radius + 1) / (4 * radius + 2);
+          check(abs(dst_data[y * width + x] - expected_alpha) <= 1, "box_blur_a8_columns", "alpha differs", y * width + x);
+        }
+      }
+    }
+  }
+
+  void test_transpose_a8()
+  {
+    const int width = 70, height = 45;
+    vector<uint8_t> src_data(width * height);
+    for(auto &alpha : src_data) alpha = random_generator() % 256;
+    vector<uint8_t> dst_data(width * height);
+    transpose_a8(dst_data.data(), height, src_data.data(), width, width, height);
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++)
+        check(dst_data[x * height + y] == src_data[y * width + x], "transpose_a8", "alpha differs", y * width + x);
+    }
+  }
+
+  void ref_blur_a8_columns(vector<uint8_t> &data, int width, int height, int radius)
+  {
+    vector<uint8_t> src_data(data);
+    uint32_t inv = (65536 + 2 * radius) / (2 * radius + 1);
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        uint32_t sum = 0;
+        for(int i = max(y - radius, 0); i <= min(y + radius, height - 1); i++) sum += src_data[i * width + x];
+        data[y * width + x] = (sum * inv) >> 16;
+      }
+    }
+  }
+
+  vector<uint8_t> ref_transpose_a8(const vector<uint8_t> &data, int width, int height)
+  {
+    vector<uint8_t> transposed_data(data.size());
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) transposed_data[x * height + y] = data[y * width + x];
+    }
+    return transposed_data;
+  }
+
+  void test_blur_a8()
+  {
+    const Dimension<int> sizes[] = { Dimension<int>(37, 29), Dimension<int>(8, 8), Dimension<int>(1, 13), Dimension<int>(70, 3) };
+    for(auto &size : sizes) {
+      int width = size.width, height = size.height;
+      vector<uint8_t> src_data(width * height);
+      for(auto &alpha : src_data) alpha = random_generator() % 256;
+      vector<uint8_t> data(src_data);
+      blur_a8(data.data(), width, width, height, 0);
+      check(data == src_data, "blur_a8", "zero radius changes image", 0);
+      for(int radius = 1; radius <= 9; radius += 4) {
+        // The blur is three box blurs of the columns and three box blurs of
+        // the rows.
+        vector<uint8_t> expected_data(src_data);
+        for(int i = 0; i < 3; i++) ref_blur_a8_columns(expected_data, width, height, radius);
+        expected_data = ref_transpose_a8(expected_data, width, height);
+        for(int i = 0; i < 3; i++) ref_blur_a8_columns(expected_data, height, width, radius);
+        expected_data = ref_transpose_a8(expected_data, height, width);
+        vector<uint8_t> data(src_data);
+        blur_a8(data.data(), width, width, height, radius);
+        for(size_t i = 0; i < data.size(); i++)
+          check(data[i] == expected_data[i], "blur_a8", "alpha differs", i);
+      }
+    }
+    // The blur of a mirrored image is the mirrored blur.
+    const int width = 23, height = 17, stride = 32;
+    vector<uint8_t> data(stride * height), mirrored_data(stride * height);
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        data[y * stride + x] = random_generator() % 256;
+        mirrored_data[y * stride + width - 1 - x] = data[y * stride + x];
+      }
+    }
+    blur_a8(data.data(), stride, width, height, 5);
+    blur_a8(mirrored_data.data(), stride, width, height, 5);
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++)
+        check(data[y * stride + x] == mirrored_data[y * stride + width - 1 - x], "blur_a8", "blur isn't symmetric", y * width + x);
+    }
+    // An opaque image stays opaque far from its edges.
+    vector<uint8_t> opaque_data(64 * 64, 255);
+    blur_a8(opaque_data.data(), 64, 64, 64, 4);
+    check(opaque_data[32 * 64 + 32] >= 254, "blur_a8", "opaque center isn't opaque", 32 * 64 + 32);
+  }
+
+  void test_downscale_pixels_box()
+  {
+    const int src_width = 11, src_height = 7;
+    vector<uint32_t> src_pixels(src_width * src_height);
+    generate(src_pixels.begin(), src_pixels.end(), random_premultiplied_pixel);
+    for(int factor = 1; factor <= 4; factor++) {
+      int dst_width = (src_width + factor - 1) / factor;
+      for(int y1 = 0, y = 0; y1 < src_height; y1 += factor, y++) {
+        vector<uint32_t> dst_pixels(dst_width);
+        downscale_pixels_box(dst_pixels.data(), src_pixels.data() + y1 * src_width, src_width * 4, src_width, src_height - y1, factor);
+        for(int x = 0; x < dst_width; x++) {
+          // The edge blocks are averaged from the remaining pixels.
+          int x2 = min((x + 1) * factor, src_width), y2 = min(y1 + factor, src_height);
+          uint32_t n = (x2 - x * factor) * (y2 - y1);
+          uint32_t expected_pixel = 0;
+          for(int shift = 0; shift < 32; shift += 8) {
+            uint32_t sum = n / 2;
+            for(int i = y1; i < y2; i++) {
+              for(int j = x * factor; j < x2; j++) sum += ref_component(src_pixels[i * src_width + j], shift);
+            }
+            expected_pixel |= (sum / n) << shift;
+          }
+          check(dst_pixels[x] == expected_pixel, "downscale_pixels_box", "pixel differs", y * dst_width + x);
+        }
+      }
+    }
+  }
+
+  //
+  // Tests against cairo.
+  //
+
+  uint32_t *surface_pixels(::cairo_surface_t *surface, int y)
+  {
+    ::cairo_surface_flush(surface);
+    return reinterpret_cast<uint32_t *>(::cairo_image_surface_get_data(surface) + y * ::cairo_image_surface_get_stride(surface));
+  }
+
+  void test_blend_against_cairo()
+  {
+    const int width = 37, height = 5;
+    unique_ptr<CanvasModifiableImage> src_image(new_canvas_modifiable_image(width, height));
+    unique_ptr<CanvasModifiableImage> dst_image(new_canvas_modifiable_image(width, height));
+    ::cairo_surface_t *src_surface = dynamic_cast<ImplCanvasImage *>(src_image.get())->surface();
+    ::cairo_surface_t *dst_surface = dynamic_cast<ImplCanvasImage *>(dst_image.get())->surface();
+    for(int y = 0; y < height; y++) {
+      generate(surface_pixels(src_surface, y), surface_pixels(src_surface, y) + width, random_premultiplied_pixel);
+      generate(surface_pixels(dst_surface, y), surface_pixels(dst_surface, y) + width, random_premultiplied_pixel);
+    }
+    ::cairo_surface_mark_dirty(src_surface);
+    ::cairo_surface_mark_dirty(dst_surface);
+    CairoSurfaceUniquePtr cairo_surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, width, height));
+    CairoUniquePtr context(::cairo_create(cairo_surface.get()));
+    ::cairo_set_source_surface(context.get(), dst_surface, 0.0, 0.0);
+    ::cairo_set_operator(context.get(), ::CAIRO_OPERATOR_SOURCE);
+    ::cairo_paint(context.get());
+    ::cairo_set_source_surface(context.get(), src_surface, 0.0, 0.0);
+    ::cairo_set_operator(context.get(), ::CAIRO_OPERATOR_OVER);
+    ::cairo_paint(context.get());
+    dst_image->blend(src_image.get(), Point<int>(0, 0));
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        check(is_near(surface_pixels(dst_surface, y)[x], surface_pixels(cairo_surface.get(), y)[x], 1),
+          "blend_against_cairo", "pixel differs", y * width + x);
+      }
+    }
+  }
+
+  void test_fill_against_cairo()
+  {
+    const int width = 9, height = 3;
+    Color color(0x80ff8040);
+    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(width, height));
+    image->fill(color);
+    CairoSurfaceUniquePtr cairo_surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, width, height));
+    CairoUniquePtr context(::cairo_create(cairo_surface.get()));
+    ::cairo_set_source_rgba(context.get(), 0xff / 255.0, 0x80 / 255.0, 0x40 / 255.0, 0x80 / 255.0);
+    ::cairo_set_operator(context.get(), ::CAIRO_OPERATOR_SOURCE);
+    ::cairo_paint(context.get());
+    ::cairo_surface_t *surface = dynamic_cast<ImplCanvasImage *>(image.get())->surface();
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        check(is_near(surface_pixels(surface, y)[x], surface_pixels(cairo_surface.get(), y)[x], 1),
+          "fill_against_cairo", "pixel differs", y * width + x);
+      }
+    }
+    // The color of the RGB24 pixels isn't premultiplied.
+    unique_ptr<CanvasModifiableImage> rgb24_image(new_canvas_modifiable_image(Dimension<int>(width, height), PixelFormat::RGB24));
+    rgb24_image->fill(color);
+    ::cairo_surface_t *rgb24_surface = dynamic_cast<ImplCanvasImage *>(rgb24_image.get())->surface();
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        check((surface_pixels(rgb24_surface, y)[x] & 0xffffff) == 0xff8040,
+          "fill_against_cairo", "RGB24 pixel differs", y * width + x);
+      }
+    }
+  }
+
+  void test_downscale_image()
+  {
+    const int width = 5, height = 3;
+    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(width, height));
+    ::cairo_surface_t *surface = dynamic_cast<ImplCanvasImage *>(image.get())->surface();
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) surface_pixels(surface, y)[x] = (x == width - 1 || y == height - 1 ? 0xffffffff : 0xff000000);
+    }
+    ::cairo_surface_mark_dirty(surface);
+    unique_ptr<CanvasModifiableImage> downscaled_image(image->downscale(2));
+    check(downscaled_image->size() == Dimension<int>(3, 2), "downscale_image", "size isn't rounded up", 0);
+    ::cairo_surface_t *downscaled_surface = dynamic_cast<ImplCanvasImage *>(downscaled_image.get())->surface();
+    // The pixels at the right edge and at the bottom edge are only averaged
+    // from the last column and the last row.
+    check(surface_pixels(downscaled_surface, 0)[0] == 0xff000000, "downscale_image", "inner pixel differs", 0);
+    check(surface_pixels(downscaled_surface, 0)[2] == 0xffffffff, "downscale_image", "right pixel differs", 2);
+    check(surface_pixels(downscaled_surface, 1)[0] == 0xffffffff, "downscale_image", "bottom pixel differs", 3);
+  }
+
+  // A modifiable image that only has the default pixel operations like an
+  // image of another implementation.
+  class DefaultModifiableImage : public CanvasModifiableImage
+  {
+    unique_ptr<CanvasModifiableImage> _M_image;
+  public:
+    DefaultModifiableImage(CanvasModifiableImage *image) :
+      _M_image(image) {}
+
+    Dimension<int> size()
+    { return _M_image->size(); }
+
+    PixelFormat pixel_format()
+    { return _M_image->pixel_format(); }
+
+    Canvas *canvas()
+    { return _M_image->canvas(); }
+
+    ::cairo_surface_t *surface()
+    { return dynamic_cast<ImplCanvasImage *>(_M_image.get())->surface(); }
+  protected:
+    Native *native()
+    { return reinterpret_cast<Native *>(surface()); }
+  };
+
+  void test_default_pixel_operations()
+  {
+    const int width = 6, height = 4;
+    unique_ptr<CanvasModifiableImage> src_image(new_canvas_modifiable_image(width, height));
+    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(width, height));
+    DefaultModifiableImage default_image(new_canvas_modifiable_image(width, height));
+    ::cairo_surface_t *src_surface = dynamic_cast<ImplCanvasImage *>(src_image.get())->surface();
+    ::cairo_surface_t *surface = dynamic_cast<ImplCanvasImage *>(image.get())->surface();
+    for(int y = 0; y < height; y++)
+      generate(surface_pixels(src_surface, y), surface_pixels(src_surface, y) + width, random_premultiplied_pixel);
+    ::cairo_surface_mark_dirty(src_surface);
+    image->fill(Color(0xc0204080));
+    default_image.fill(Color(0xc0204080));
+    image->blend(src_image.get(), Point<int>(1, 2));
+    default_image.blend(src_image.get(), Point<int>(1, 2));
+    image->tint(Color(0x80ff8040));
+    default_image.tint(Color(0x80ff8040));
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) {
+        check(is_near(surface_pixels(default_image.surface(), y)[x], surface_pixels(surface, y)[x], 1),
+          "default_pixel_operations", "pixel differs", y * width + x);
+      }
+    }
+    unique_ptr<CanvasModifiableImage> downscaled_image(default_image.downscale(2));
+    check(downscaled_image->size() == Dimension<int>(3, 2), "default_pixel_operations", "downscaled size differs", 0);
+    bool is_thrown = false;
+    try {
+      default_image.premultiply();
+    } catch(CanvasException &e) {
+      is_thrown = true;
+    }
+    check(is_thrown, "default_pixel_operations", "premultiply doesn't throw", 0);
+  }
+}
+
+int main()
+{
+  test_premultiply_pixels();
+  test_unpremultiply_pixels();
+  test_fill_pixels();
+  test_blend_pixels_over();
+  test_tint_pixels();
+  test_colorize_a8_pixels();
+  test_box_blur_a8_columns();
+  test_transpose_a8();
+  test_blur_a8();
+  test_downscale_pixels_box();
+  test_blend_against_cairo();
+  test_fill_against_cairo();
+  test_downscale_image();
+  test_default_pixel_operations();
+  if(failure_count != 0) {
+    fprintf(stderr, "%d failures\n", failure_count);
+    return 1;
+  }
+  return 0;
+}
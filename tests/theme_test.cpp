@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "theme.hpp"
+
+using namespace std;
+using namespace waytk;
+using namespace waytk::priv;
+
+namespace
+{
+  int failure_count = 0;
+  string dir_name;
+
+  void check(bool is_passed, const char *test_name, const char *message, size_t i)
+  {
+    if(is_passed) return;
+    fprintf(stderr, "%s: %s at %zu\n", test_name, message, i);
+    failure_count++;
+  }
+
+  void write_file(const string &file_name, const string &data)
+  {
+    FILE *file = fopen(file_name.c_str(), "wb");
+    if(file == nullptr) {
+      fprintf(stderr, "can't write %s\n", file_name.c_str());
+      exit(1);
+    }
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+  }
+
+  string read_file(const string &file_name)
+  {
+    string data;
+    FILE *file = fopen(file_name.c_str(), "rb");
+    if(file == nullptr) return data;
+    char buffer[4096];
+    size_t count;
+    while((count = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, count);
+    fclose(file);
+    return data;
+  }
+
+  // The offsets of the header fields and the size of the style entry of the
+  // compiled theme format.
+  const size_t styles_offset_offset = 44;
+  const size_t style_size = 16;
+
+  const char *theme_yaml =
+    "button:\n"
+    "  - margin: [1, 2]\n"
+    "    background_color: '#ff0000'\n"
+    "  - pseudo_classes: [hover]\n"
+    "    margin: 5\n"
+    "label:\n"
+    "  - padding: 3\n"
+    "zz:\n"
+    "  - border: 4\n";
+
+  void build_compiled_theme(const string &source_file_name, const string &compiled_file_name)
+  {
+    write_file(source_file_name, theme_yaml);
+    CompiledTheme compiled_theme;
+    compiled_theme.build(source_file_name);
+    compiled_theme.save(compiled_file_name);
+  }
+
+  bool load_compiled_theme(const string &source_file_name, const string &compiled_file_name)
+  {
+    CompiledTheme compiled_theme;
+    return compiled_theme.load(compiled_file_name, source_file_name);
+  }
+
+  //
+  // Tests of the compiled theme.
+  //
+
+  void test_round_trip()
+  {
+    string source_file_name = dir_name + "/round_trip.yaml";
+    string compiled_file_name = dir_name + "/round_trip.bin";
+    build_compiled_theme(source_file_name, compiled_file_name);
+    CompiledTheme compiled_theme;
+    check(compiled_theme.load(compiled_file_name, source_file_name), "round_trip", "compiled theme isn't loaded", 0);
+    unique_ptr<ImplStyles> button_styles(compiled_theme.new_styles("button"));
+    check(button_styles.get() != nullptr, "round_trip", "no button styles", 0);
+    if(button_styles.get() != nullptr) {
+      check(button_styles->margin(PseudoClasses::NONE).top == 1, "round_trip", "button margin differs", 0);
+      check(button_styles->margin(PseudoClasses::NONE).right == 2, "round_trip", "button margin differs", 1);
+      check(button_styles->margin(PseudoClasses::HOVER).right == 5, "round_trip", "hover margin differs", 0);
+      check(button_styles->background_color(PseudoClasses::NONE) == Color(0xffff0000), "round_trip", "background color differs", 0);
+    }
+    unique_ptr<ImplStyles> label_styles(compiled_theme.new_styles("label"));
+    check(label_styles.get() != nullptr && label_styles->padding(PseudoClasses::NONE).left == 3, "round_trip", "label padding differs", 0);
+    unique_ptr<ImplStyles> zz_styles(compiled_theme.new_styles("zz"));
+    check(zz_styles.get() != nullptr && zz_styles->border(PseudoClasses::NONE).bottom == 4, "round_trip", "zz border differs", 0);
+    unique_ptr<ImplStyles> missing_styles(compiled_theme.new_styles("missing"));
+    check(missing_styles.get() == nullptr, "round_trip", "missing styles are found", 0);
+  }
+
+  void test_truncated_file()
+  {
+    string source_file_name = dir_name + "/truncated.yaml";
+    string compiled_file_name = dir_name + "/truncated.bin";
+    build_compiled_theme(source_file_name, compiled_file_name);
+    string data = read_file(compiled_file_name);
+    size_t sizes[] = { 0, 8, 63, data.size() / 2, data.size() - 1 };
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      write_file(compiled_file_name, data.substr(0, sizes[i]));
+      check(!load_compiled_theme(source_file_name, compiled_file_name), "truncated_file", "truncated file is loaded", i);
+    }
+  }
+
+  void test_unsorted_file()
+  {
+    string source_file_name = dir_name + "/unsorted.yaml";
+    string compiled_file_name = dir_name + "/unsorted.bin";
+    build_compiled_theme(source_file_name, compiled_file_name);
+    string data = read_file(compiled_file_name);
+    uint32_t styles_offset;
+    memcpy(&styles_offset, data.data() + styles_offset_offset, sizeof(uint32_t));
+    // The first two style entries are swapped, so the binary search could miss
+    // the styles.
+    string style1 = data.substr(styles_offset, style_size);
+    string style2 = data.substr(styles_offset + style_size, style_size);
+    data.replace(styles_offset, style_size, style2);
+    data.replace(styles_offset + style_size, style_size, style1);
+    write_file(compiled_file_name, data);
+    check(!load_compiled_theme(source_file_name, compiled_file_name), "unsorted_file", "unsorted file is loaded", 0);
+  }
+
+  void test_stale_file()
+  {
+    string source_file_name = dir_name + "/stale.yaml";
+    string compiled_file_name = dir_name + "/stale.bin";
+    build_compiled_theme(source_file_name, compiled_file_name);
+    check(load_compiled_theme(source_file_name, compiled_file_name), "stale_file", "up-to-date file isn't loaded", 0);
+    // Only the modification time of the source file is changed.
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = 1000000000;
+    times[0].tv_usec = times[1].tv_usec = 0;
+    utimes(source_file_name.c_str(), times);
+    check(!load_compiled_theme(source_file_name, compiled_file_name), "stale_file", "file with other mtime is loaded", 0);
+    // Only the size of the source file is changed.
+    build_compiled_theme(source_file_name, compiled_file_name);
+    struct stat source_stat;
+    stat(source_file_name.c_str(), &source_stat);
+    write_file(source_file_name, string(theme_yaml) + "\n");
+    struct timespec source_times[2] = { source_stat.st_atim, source_stat.st_mtim };
+    utimensat(AT_FDCWD, source_file_name.c_str(), source_times, 0);
+    check(!load_compiled_theme(source_file_name, compiled_file_name), "stale_file", "file with other size is loaded", 0);
+    // A compiled theme of another source file isn't used.
+    build_compiled_theme(source_file_name, compiled_file_name);
+    string other_source_file_name = dir_name + "/other.yaml";
+    write_file(other_source_file_name, theme_yaml);
+    check(!load_compiled_theme(other_source_file_name, compiled_file_name), "stale_file", "file of other source is loaded", 0);
+  }
+
+  //
+  // Tests of the theme.
+  //
+
+  void test_reload()
+  {
+    string source_file_name = dir_name + "/reload.yaml";
+    write_file(source_file_name, theme_yaml);
+    theme().load(source_file_name);
+    size_t button_name_id = theme().intern_name("button");
+    size_t zz_name_id = theme().intern_name("zz");
+    Styles *old_styles = theme().find_styles_by_name_id(button_name_id);
+    check(old_styles->margin(PseudoClasses::NONE).right == 2, "reload", "button margin differs", 0);
+    unsigned generation = styles_generation();
+    // The changed theme has the same size, so only the modification time
+    // shows the change.
+    string changed_theme_yaml(theme_yaml);
+    changed_theme_yaml.replace(changed_theme_yaml.find("[1, 2]"), 6, "[1, 7]");
+    write_file(source_file_name, changed_theme_yaml);
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = 2000000000;
+    times[0].tv_usec = times[1].tv_usec = 0;
+    utimes(source_file_name.c_str(), times);
+    theme().load(source_file_name);
+    check(styles_generation() != generation, "reload", "styles generation isn't changed", 0);
+    check(theme().find_styles_by_name_id(button_name_id)->margin(PseudoClasses::NONE).right == 7, "reload", "button margin isn't changed", 0);
+    check(theme().find_styles_by_name_id(zz_name_id)->border(PseudoClasses::NONE).top == 4, "reload", "zz border differs", 0);
+    // The styles of the previous theme are still valid for the readers that
+    // found them before the reload.
+    check(old_styles->margin(PseudoClasses::NONE).right == 2, "reload", "old button margin differs", 0);
+    // A corrupted compiled theme is compiled again.
+    string cache_dir_name = string(getenv("XDG_CACHE_HOME")) + "/waytk";
+    vector<string> cache_file_names;
+    DIR *dir = opendir(cache_dir_name.c_str());
+    if(dir != nullptr) {
+      struct dirent *entry;
+      while((entry = readdir(dir)) != nullptr) {
+        if(strncmp(entry->d_name, "theme-", 6) == 0) cache_file_names.push_back(cache_dir_name + "/" + entry->d_name);
+      }
+      closedir(dir);
+    }
+    check(!cache_file_names.empty(), "reload", "no compiled theme", 0);
+    for(auto &cache_file_name : cache_file_names) write_file(cache_file_name, "corrupted");
+    theme().load(source_file_name);
+    check(theme().find_styles_by_name_id(button_name_id)->margin(PseudoClasses::NONE).right == 7, "reload", "button margin differs after corruption", 0);
+  }
+}
+
+int main()
+{
+  char dir_template[] = "/tmp/waytk_theme_test_XXXXXX";
+  if(mkdtemp(dir_template) == nullptr) {
+    fprintf(stderr, "can't create temporary directory\n");
+    return 1;
+  }
+  dir_name = dir_template;
+  setenv("XDG_CACHE_HOME", (dir_name + "/cache").c_str(), 1);
+  test_round_trip();
+  test_truncated_file();
+  test_unsorted_file();
+  test_stale_file();
+  test_reload();
+  system(("rm -rf " + dir_name).c_str());
+  if(failure_count != 0) {
+    fprintf(stderr, "%d failures\n", failure_count);
+    return 1;
+  }
+  return 0;
+}
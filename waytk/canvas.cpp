@@ -20,7 +20,13 @@
  * THE SOFTWARE.
  */
 #include <cmath>
+#include <mutex>
+#include <unordered_map>
 #include "canvas.hpp"
+#include "image_loader.hpp"
+#include "pixel_kernels.hpp"
+#include "svg_cache.hpp"
+#include "tile_cache.hpp"
 
 using namespace std;
 
@@ -28,6 +34,125 @@ namespace waytk
 {
   namespace priv
   {    
+    namespace
+    {
+      struct FontFaceCacheEntry
+      {
+        CairoFontFaceUniquePtr font_faces[3][2];
+      };
+
+      // The librsvg handles aren't thread-safe, so they are used under this
+      // mutex.
+      mutex rsvg_mutex;
+
+      struct PixelDataRelease
+      {
+        function<void (void *)> fun;
+        void *data;
+      };
+
+      ::cairo_user_data_key_t pixel_data_release_key;
+
+      void release_pixel_data(void *user_data)
+      {
+        unique_ptr<PixelDataRelease> release(reinterpret_cast<PixelDataRelease *>(user_data));
+        if(release->fun) release->fun(release->data);
+      }
+
+      mutex font_face_cache_mutex;
+      unordered_map<string, FontFaceCacheEntry> font_face_cache;
+
+      ::cairo_font_face_t *new_toy_font_face(const string &name, FontSlant slant, FontWeight weight)
+      {
+        ::cairo_font_slant_t cairo_slant = ::CAIRO_FONT_SLANT_NORMAL;
+        ::cairo_font_weight_t cairo_weight = ::CAIRO_FONT_WEIGHT_NORMAL;
+        switch(slant) {
+          case FontSlant::NORMAL:
+            cairo_slant = ::CAIRO_FONT_SLANT_NORMAL;
+            break;
+          case FontSlant::ITALIC:
+            cairo_slant = ::CAIRO_FONT_SLANT_ITALIC;
+            break;
+          case FontSlant::OBLIQUE:
+            cairo_slant = ::CAIRO_FONT_SLANT_OBLIQUE;
+            break;
+        }
+        switch(weight) {
+          case FontWeight::NORMAL:
+            cairo_weight = ::CAIRO_FONT_WEIGHT_NORMAL;
+            break;
+          case FontWeight::BOLD:
+            cairo_weight = ::CAIRO_FONT_WEIGHT_BOLD;
+            break;
+        }
+        CairoFontFaceUniquePtr font_face(::cairo_toy_font_face_create(name.c_str(), cairo_slant, cairo_weight));
+        throw_canvas_exception_for_failure(font_face.get());
+        return font_face.release();
+      }
+
+      ::cairo_font_face_t *cached_font_face(const string &name, FontSlant slant, FontWeight weight)
+      {
+        // The cached font faces are never destroyed, so fontconfig matching
+        // is done once for each font face and scaled fonts of these font
+        // faces stay in the cairo font cache.
+        lock_guard<mutex> guard(font_face_cache_mutex);
+        CairoFontFaceUniquePtr &font_face = font_face_cache[name].font_faces[static_cast<int>(slant)][static_cast<int>(weight)];
+        if(font_face.get() == nullptr) font_face = CairoFontFaceUniquePtr(new_toy_font_face(name, slant, weight));
+        return font_face.get();
+      }
+
+      inline uint32_t format_pixel(Color color, PixelFormat format)
+      {
+        // The RGB24 pixels are opaque, so their colors aren't premultiplied.
+        if(format == PixelFormat::RGB24) return color.value() | 0xff000000;
+        return premultiplied_pixel(color.value());
+      }
+
+      ::cairo_surface_t *new_downscaled_surface(::cairo_surface_t *surface, int factor)
+      {
+        ::cairo_surface_flush(surface);
+        throw_canvas_exception_for_failure(surface);
+        ::cairo_format_t format = ::cairo_image_surface_get_format(surface);
+        int src_width = ::cairo_image_surface_get_width(surface);
+        int src_height = ::cairo_image_surface_get_height(surface);
+        // The size is rounded up, so the pixels at the right edge and at the
+        // bottom edge aren't dropped.
+        int dst_width = max((src_width + factor - 1) / factor, 1);
+        int dst_height = max((src_height + factor - 1) / factor, 1);
+        CairoSurfaceUniquePtr dst_surface(::cairo_image_surface_create(format, dst_width, dst_height));
+        throw_canvas_exception_for_failure(dst_surface.get());
+        if(format == ::CAIRO_FORMAT_ARGB32 || format == ::CAIRO_FORMAT_RGB24) {
+          const uint8_t *src_data = ::cairo_image_surface_get_data(surface);
+          int src_stride = ::cairo_image_surface_get_stride(surface);
+          uint8_t *dst_data = ::cairo_image_surface_get_data(dst_surface.get());
+          int dst_stride = ::cairo_image_surface_get_stride(dst_surface.get());
+          for(int y = 0; y * factor < src_height; y++) {
+            uint32_t *dst = reinterpret_cast<uint32_t *>(dst_data + y * dst_stride);
+            const uint32_t *src = reinterpret_cast<const uint32_t *>(src_data + y * factor * src_stride);
+            downscale_pixels_box(dst, src, src_stride, src_width, src_height - y * factor, factor);
+          }
+          ::cairo_surface_mark_dirty(dst_surface.get());
+        } else {
+          // The other pixel formats are downscaled by cairo.
+          CairoUniquePtr context(::cairo_create(dst_surface.get()));
+          ::cairo_scale(context.get(), 1.0 / factor, 1.0 / factor);
+          ::cairo_set_source_surface(context.get(), surface, 0.0, 0.0);
+          ::cairo_pattern_set_filter(::cairo_get_source(context.get()), ::CAIRO_FILTER_GOOD);
+          ::cairo_set_operator(context.get(), ::CAIRO_OPERATOR_SOURCE);
+          ::cairo_paint(context.get());
+          throw_canvas_exception_for_failure(::cairo_status(context.get()));
+        }
+        return dst_surface.release();
+      }
+
+      Canvas *new_image_canvas(CanvasImage *image)
+      {
+        Canvas *canvas = image->canvas();
+        if(canvas == nullptr) throw CanvasException("unsupported canvas image");
+        return canvas;
+      }
+    }
+
     //
     // An ImplCanvasPattern class.
     //
@@ -37,6 +162,14 @@ namespace waytk
     CanvasPattern::Native *ImplCanvasPattern::native()
     { return reinterpret_cast<Native *>(_M_pattern.get()); }
 
+    void ImplCanvasPattern::assign(CanvasPattern *pattern)
+    {
+      ImplCanvasPattern *impl_pattern = dynamic_cast<ImplCanvasPattern *>(pattern);
+      if(impl_pattern == nullptr) throw CanvasException("unsupported pattern");
+      if(impl_pattern->_M_pattern.get() != nullptr) ::cairo_pattern_reference(impl_pattern->_M_pattern.get());
+      _M_pattern.reset(impl_pattern->_M_pattern.get());
+    }
+
     //
     // An ImplCanvasImage class.
     //
@@ -52,6 +185,32 @@ namespace waytk
       return Dimension<int>(width, height);
     }
 
+    PixelFormat ImplCanvasImage::pixel_format()
+    {
+      ::cairo_format_t format = ::cairo_image_surface_get_format(_M_surface.get());
+      throw_canvas_exception_for_failure(_M_surface.get());
+      return priv::pixel_format(format);
+    }
+
+    CanvasImage *ImplCanvasImage::mip_level(int level)
+    {
+      Dimension<int> tmp_size = size();
+      int level_count = 1;
+      while((tmp_size.width >> level_count) > 0 && (tmp_size.height >> level_count) > 0) level_count++;
+      level = min(level, level_count - 1);
+      if(level <= 0) return this;
+      if(_M_mip_levels.size() < static_cast<size_t>(level)) _M_mip_levels.resize(level);
+      unique_ptr<CanvasImage> &image = _M_mip_levels[level - 1];
+      if(image.get() == nullptr) {
+        // Each level is downscaled from the previous level rather than from
+        // the canvas image.
+        ImplCanvasImage *prev_image = dynamic_cast<ImplCanvasImage *>(mip_level(level - 1));
+        CairoSurfaceUniquePtr surface(new_downscaled_surface(prev_image->surface(), 2));
+        image = unique_ptr<CanvasImage>(new ImplCanvasUnmodifiableImage(surface));
+      }
+      return image.get();
+    }
+
     CanvasImage::Native *ImplCanvasImage::native()
     { return reinterpret_cast<Native *>(_M_surface.get()); }
 
@@ -66,12 +225,148 @@ namespace waytk
 
     Canvas *ImplCanvasModifiableImage::canvas()
     {
+      discard_mip_levels();
       CairoUniquePtr context(::cairo_create(_M_surface.get()));
       throw_canvas_exception_for_failure(::cairo_status(context.get()));
       throw_canvas_exception_for_failure(_M_surface.get());
       return new ImplCanvas(context);
     }
 
+    void ImplCanvasModifiableImage::premultiply()
+    {
+      int stride;
+      uint8_t *data = begin_pixel_access(stride);
+      Dimension<int> tmp_size = size();
+      if(pixel_format() == PixelFormat::ARGB32) {
+        for(int y = 0; y < tmp_size.height; y++)
+          premultiply_pixels(reinterpret_cast<uint32_t *>(data + y * stride), tmp_size.width);
+      }
+      end_pixel_access();
+    }
+
+    void ImplCanvasModifiableImage::unpremultiply()
+    {
+      int stride;
+      uint8_t *data = begin_pixel_access(stride);
+      Dimension<int> tmp_size = size();
+      if(pixel_format() == PixelFormat::ARGB32) {
+        for(int y = 0; y < tmp_size.height; y++)
+          unpremultiply_pixels(reinterpret_cast<uint32_t *>(data + y * stride), tmp_size.width);
+      }
+      end_pixel_access();
+    }
+
+    void ImplCanvasModifiableImage::fill(Color color)
+    {
+      int stride;
+      uint8_t *data = begin_pixel_access(stride);
+      Dimension<int> tmp_size = size();
+      uint32_t pixel = format_pixel(color, pixel_format());
+      for(int y = 0; y < tmp_size.height; y++)
+        fill_pixels(reinterpret_cast<uint32_t *>(data + y * stride), tmp_size.width, pixel);
+      end_pixel_access();
+    }
+
+    void ImplCanvasModifiableImage::blend(CanvasImage *image, const Point<int> &p)
+    {
+      ImplCanvasImage *impl_image = dynamic_cast<ImplCanvasImage *>(image);
+      if(impl_image == nullptr) throw CanvasException("unsupported image");
+      ::cairo_surface_t *src_surface = impl_image->surface();
+      PixelFormat src_format = impl_image->pixel_format();
+      if(src_format != PixelFormat::ARGB32 && src_format != PixelFormat::RGB24)
+        throw CanvasException("unsupported pixel format");
+      ::cairo_surface_flush(src_surface);
+      throw_canvas_exception_for_failure(src_surface);
+      const uint8_t *src_data = ::cairo_image_surface_get_data(src_surface);
+      int src_stride = ::cairo_image_surface_get_stride(src_surface);
+      Dimension<int> src_size = impl_image->size();
+      int dst_stride;
+      uint8_t *dst_data = begin_pixel_access(dst_stride);
+      Dimension<int> dst_size = size();
+      int x1 = max(p.x, 0), y1 = max(p.y, 0);
+      int x2 = min(p.x + src_size.width, dst_size.width);
+      int y2 = min(p.y + src_size.height, dst_size.height);
+      for(int y = y1; y < y2; y++) {
+        uint32_t *dst = reinterpret_cast<uint32_t *>(dst_data + y * dst_stride) + x1;
+        const uint32_t *src = reinterpret_cast<const uint32_t *>(src_data + (y - p.y) * src_stride) + (x1 - p.x);
+        if(src_format == PixelFormat::ARGB32) {
+          blend_pixels_over(dst, src, max(x2 - x1, 0));
+        } else {
+          // The pixels of the RGB24 image are opaque.
+          for(int x = x1; x < x2; x++, dst++, src++) *dst = *src | 0xff000000;
+        }
+      }
+      end_pixel_access();
+    }
+
+    void ImplCanvasModifiableImage::tint(Color color)
+    {
+      int stride;
+      uint8_t *data = begin_pixel_access(stride);
+      Dimension<int> tmp_size = size();
+      uint32_t pixel = premultiplied_pixel(color.value());
+      for(int y = 0; y < tmp_size.height; y++) {
+        uint32_t *row = reinterpret_cast<uint32_t *>(data + y * stride);
+        if(pixel_format() == PixelFormat::ARGB32)
+          tint_pixels(row, tmp_size.width, pixel);
+        else
+          fill_pixels(row, tmp_size.width, format_pixel(color, PixelFormat::RGB24));
+      }
+      end_pixel_access();
+    }
+
+    CanvasModifiableImage *ImplCanvasModifiableImage::downscale(int factor)
+    {
+      if(factor < 1) throw CanvasException("invalid downscale factor");
+      CairoSurfaceUniquePtr surface(new_downscaled_surface(_M_surface.get(), factor));
+      return new ImplCanvasModifiableImage(surface);
+    }
+
+    uint8_t *ImplCanvasModifiableImage::begin_pixel_access(int &stride)
+    {
+      PixelFormat format = pixel_format();
+      if(format != PixelFormat::ARGB32 && format != PixelFormat::RGB24)
+        throw CanvasException("unsupported pixel format");
+      ::cairo_surface_flush(_M_surface.get());
+      throw_canvas_exception_for_failure(_M_surface.get());
+      stride = ::cairo_image_surface_get_stride(_M_surface.get());
+      return ::cairo_image_surface_get_data(_M_surface.get());
+    }
+
+    void ImplCanvasModifiableImage::discard_mip_levels()
+    {
+      _M_mip_levels.clear();
+      _M_snapshot.reset();
+    }
+
+    CanvasImage *ImplCanvasModifiableImage::snapshot()
+    {
+      if(_M_snapshot.get() == nullptr) {
+        // The copy is shared by the recordings until the canvas image is
+        // modified.
+        unique_ptr<CanvasModifiableImage> image_copy(new_canvas_modifiable_image(size()));
+        unique_ptr<Canvas> image_copy_canvas(image_copy->canvas());
+        image_copy_canvas->set_op(Operator::SOURCE);
+        image_copy_canvas->set_image(this, 0.0, 0.0);
+        image_copy_canvas->paint();
+        image_copy_canvas.reset();
+        _M_snapshot = move(image_copy);
+      }
+      return _M_snapshot.get();
+    }
+
+    void ImplCanvasModifiableImage::end_pixel_access()
+    {
+      ::cairo_surface_mark_dirty(_M_surface.get());
+      discard_mip_levels();
+    }
+
+    //
+    // An ImplCanvasUnmodifiableImage class.
+    //
+
+    ImplCanvasUnmodifiableImage::~ImplCanvasUnmodifiableImage() {}
+
     //
     // An ImplCanvasScalableImage class.
     //
@@ -79,22 +374,20 @@ namespace waytk
     ImplCanvasScalableImage::~ImplCanvasScalableImage() {}
 
     Dimension<int> ImplCanvasScalableImage::size()
-    {
-      Dimension<int> tmp_size;
-      ::RsvgDimensionData dim_data;
-      ::rsvg_handle_get_dimensions(_M_handle.get(), &dim_data);
-      tmp_size.width = ceil(dim_data.width * _M_sp.x);
-      tmp_size.height = ceil(dim_data.height * _M_sp.y);
-      return tmp_size;
-    }
+    { return svg_size(_M_handle_size, _M_sp); }
+
+    PixelFormat ImplCanvasScalableImage::pixel_format()
+    { return PixelFormat::ARGB32; }
 
     bool ImplCanvasScalableImage::is_scalable() const
     { return this->CanvasScalableImage::is_scalable(); }
 
     CanvasImage *ImplCanvasScalableImage::scale(const Point<double> &sp)
     {
-      unique_ptr<ImplCanvasScalableImage> image(new ImplCanvasScalableImage(_M_handle, Point<double>(_M_sp.x * sp.x, _M_sp.y * sp.y)));
-      image->update_surface();
+      unique_ptr<ImplCanvasScalableImage> image(new ImplCanvasScalableImage(_M_handle, _M_handle_size, Point<double>(_M_sp.x * sp.x, _M_sp.y * sp.y)));
+      // The scaled image is rasterized in the background and it is waited for
+      // when the image is drawn first time.
+      image->_M_surface_future = svg_raster_cache().request(_M_handle, image->_M_sp, true);
       return image.release();
     }
 
@@ -112,17 +405,13 @@ namespace waytk
       return reinterpret_cast<Native *>(_M_surface.get());
     }
 
-    ::cairo_surface_t *ImplCanvasScalableImage::new_surface()
+    void ImplCanvasScalableImage::update_surface()
     {
-      Dimension<int> tmp_size = size();
-      CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, tmp_size.width, tmp_size.height));
-      throw_canvas_exception_for_failure(surface.get());
-      CairoUniquePtr context(::cairo_create(surface.get()));
-      ::cairo_scale(context.get(), _M_sp.x, _M_sp.y);
-      throw_canvas_exception_for_failure(context.get());
-      if(::rsvg_handle_render_cairo(_M_handle.get(), context.get()) == FALSE)
-        throw new CanvasException("can't render SVG image");
-      return surface.release();
+      if(!_M_surface_future.valid())
+        _M_surface_future = svg_raster_cache().request(_M_handle, _M_sp, false);
+      shared_ptr<::cairo_surface_t> surface = _M_surface_future.get();
+      _M_surface_future = CairoSurfaceSharedFuture();
+      _M_surface = CairoSurfaceUniquePtr(::cairo_surface_reference(surface.get()));
     }
 
     //
@@ -143,6 +432,13 @@ namespace waytk
     ImplCanvasTransformation::Native *ImplCanvasTransformation::native()
     { return reinterpret_cast<Native *>(&_M_matrix); }
 
+    void ImplCanvasTransformation::assign(CanvasTransformation *transformation)
+    {
+      ImplCanvasTransformation *impl_transformation = dynamic_cast<ImplCanvasTransformation *>(transformation);
+      if(impl_transformation == nullptr) throw CanvasException("unsupported transformation");
+      _M_matrix = impl_transformation->_M_matrix;
+    }
+
     //
     // An ImplCanvasFontFace class.
     //
@@ -152,6 +448,14 @@ namespace waytk
     CanvasFontFace::Native *ImplCanvasFontFace::native()
     { return reinterpret_cast<Native *>(_M_font_face.get()); }
 
+    void ImplCanvasFontFace::assign(CanvasFontFace *font_face)
+    {
+      ImplCanvasFontFace *impl_font_face = dynamic_cast<ImplCanvasFontFace *>(font_face);
+      if(impl_font_face == nullptr) throw CanvasException("unsupported font face");
+      if(impl_font_face->_M_font_face.get() != nullptr) ::cairo_font_face_reference(impl_font_face->_M_font_face.get());
+      _M_font_face.reset(impl_font_face->_M_font_face.get());
+    }
+
     //
     // An ImplCanvas class.
     //
@@ -161,7 +465,7 @@ namespace waytk
     void ImplCanvas::save()
     {
       ::cairo_save(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::restore()
@@ -170,25 +474,45 @@ namespace waytk
       throw_canvas_exception_for_failure(_M_context.get());
     }
 
+    void ImplCanvas::begin_batch()
+    { _M_batch_level++; }
+
+    void ImplCanvas::end_batch()
+    {
+      if(_M_batch_level > 0) _M_batch_level--;
+      throw_canvas_exception_for_failure(_M_context.get());
+    }
+
     CanvasPattern *ImplCanvas::pattern()
     {
       ::cairo_pattern_t *pattern = ::cairo_get_source(_M_context.get());
       throw_canvas_exception_for_failure(pattern);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       ::cairo_pattern_reference(pattern);
       return new ImplCanvasPattern(pattern);
     }
 
+    void ImplCanvas::get_pattern(CanvasPattern *pattern)
+    {
+      ImplCanvasPattern *impl_pattern = dynamic_cast<ImplCanvasPattern *>(pattern);
+      if(impl_pattern == nullptr) throw CanvasException("unsupported pattern");
+      ::cairo_pattern_t *cairo_pattern = ::cairo_get_source(_M_context.get());
+      throw_canvas_exception_for_failure(cairo_pattern);
+      check_context();
+      ::cairo_pattern_reference(cairo_pattern);
+      impl_pattern->set_pattern(cairo_pattern);
+    }
+
     void ImplCanvas::set_pattern(CanvasPattern *pattern)
     {
       ::cairo_set_source(_M_context.get(), cairo_pattern(pattern));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::set_color(Color color)
     {
-      ::cairo_set_source_rgba(_M_context.get(), color.red(), color.green(), color.blue(), color.alpha());
-      throw_canvas_exception_for_failure(_M_context.get());
+      ::cairo_set_source_rgba(_M_context.get(), color.red() / 255.0, color.green() / 255.0, color.blue() / 255.0, color.alpha() / 255.0);
+      check_context();
     }
 
     void ImplCanvas::set_linear_gradient(const Point<double> &p1, const Point<double> &p2, initializer_list<ColorStop> color_stops)
@@ -206,13 +530,13 @@ namespace waytk
     void ImplCanvas::set_image(CanvasImage *image, const Point<double> &p)
     {
       ::cairo_set_source_surface(_M_context.get(), cairo_surface(image), p.x, p.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
     
     Antialias ImplCanvas::antialias()
     {
       ::cairo_antialias_t crairo_antialias = ::cairo_get_antialias(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       switch(crairo_antialias) {
         case ::CAIRO_ANTIALIAS_DEFAULT:
           return Antialias::DEFAULT;
@@ -232,19 +556,19 @@ namespace waytk
       switch(antialias) {
         case Antialias::DEFAULT:
           ::cairo_set_antialias(_M_context.get(), ::CAIRO_ANTIALIAS_DEFAULT);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Antialias::NONE:
           ::cairo_set_antialias(_M_context.get(), ::CAIRO_ANTIALIAS_NONE);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Antialias::GRAY:
           ::cairo_set_antialias(_M_context.get(), ::CAIRO_ANTIALIAS_GRAY);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Antialias::SUBPIXEL:
           ::cairo_set_antialias(_M_context.get(), ::CAIRO_ANTIALIAS_SUBPIXEL);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
       }
     }
@@ -253,28 +577,28 @@ namespace waytk
     {
       dashes.clear();
       int dash_count = ::cairo_get_dash_count(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       dashes.resize(dash_count);
       ::cairo_get_dash(_M_context.get(), dashes.data(), &offset);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::set_dash(initializer_list<double> dashes, double offset)
     {
       ::cairo_set_dash(_M_context.get(), dashes.begin(), dashes.size(), offset);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::set_dash(const vector<double> &dashes, double offset)
     {
       ::cairo_set_dash(_M_context.get(), dashes.data(), dashes.size(), offset);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     LineCap ImplCanvas::line_cap()
     {
       ::cairo_line_cap_t cairo_line_cap = ::cairo_get_line_cap(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       switch(cairo_line_cap) {
         case ::CAIRO_LINE_CAP_BUTT:
           return LineCap::BUTT;
@@ -292,15 +616,15 @@ namespace waytk
       switch(line_cap) {
         case LineCap::BUTT:
           ::cairo_set_line_cap(_M_context.get(), ::CAIRO_LINE_CAP_BUTT);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case LineCap::ROUND:
           ::cairo_set_line_cap(_M_context.get(), ::CAIRO_LINE_CAP_ROUND);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case LineCap::SQUARE:
           ::cairo_set_line_cap(_M_context.get(), ::CAIRO_LINE_CAP_SQUARE);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
       }
     }
@@ -308,7 +632,7 @@ namespace waytk
     LineJoin ImplCanvas::line_join()
     {
       ::cairo_line_join_t cairo_join_cap = ::cairo_get_line_join(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       switch(cairo_join_cap) {
         case ::CAIRO_LINE_JOIN_MITER:
           return LineJoin::MITER;
@@ -326,15 +650,15 @@ namespace waytk
       switch(line_join) {
         case LineJoin::MITER:
           ::cairo_set_line_join(_M_context.get(), ::CAIRO_LINE_JOIN_MITER);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case LineJoin::ROUND:
           ::cairo_set_line_join(_M_context.get(), ::CAIRO_LINE_JOIN_ROUND);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case LineJoin::BEVEL:
           ::cairo_set_line_join(_M_context.get(), ::CAIRO_LINE_JOIN_BEVEL);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
       }
     }
@@ -342,33 +666,33 @@ namespace waytk
     double ImplCanvas::line_width()
     { 
       double tmp_line_width = ::cairo_get_line_width(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return tmp_line_width;
     }
 
     void ImplCanvas::set_line_width(double width)
     {
       ::cairo_set_line_width(_M_context.get(), width);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     double ImplCanvas::miter_limit()
     {
       double tmp_miter_limit = ::cairo_get_miter_limit(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return tmp_miter_limit;
     }
 
     void ImplCanvas::set_miter_limit(double limit)
     {
       ::cairo_set_miter_limit(_M_context.get(), limit);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     Operator ImplCanvas::op()
     {
       ::cairo_operator_t cairo_op = ::cairo_get_operator(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       switch(cairo_op) {
         case ::CAIRO_OPERATOR_CLEAR:
           return Operator::CLEAR;
@@ -408,59 +732,59 @@ namespace waytk
       switch(op) {
         case Operator::CLEAR:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_CLEAR);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::SOURCE:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_SOURCE);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::OVER:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_OVER);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::IN:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_IN);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::OUT:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_OUT);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::ATOP:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_ATOP);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::DESTINATION:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_DEST);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::DESTINATION_OVER:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_DEST_OVER);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::DESTINATION_IN:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_DEST_IN);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::DESTINATION_OUT:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_DEST_OUT);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::DESTINATION_ATOP:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_DEST_ATOP);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::XOR:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_XOR);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::ADD:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_ADD);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
         case Operator::SATURATE:
           ::cairo_set_operator(_M_context.get(), ::CAIRO_OPERATOR_SATURATE);
-          throw_canvas_exception_for_failure(_M_context.get());
+          check_context();
           break;
       }
     }
@@ -468,45 +792,44 @@ namespace waytk
     void ImplCanvas::clip()
     {
       ::cairo_clip(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::reset_clip()
     {
       ::cairo_reset_clip(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::fill()
     {
       ::cairo_fill(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::paint()
     {
       ::cairo_paint(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::paint(unsigned alpha)
     {
-      ::cairo_paint_with_alpha(_M_context.get(), alpha);
-      throw_canvas_exception_for_failure(_M_context.get());
-      
+      ::cairo_paint_with_alpha(_M_context.get(), alpha / 255.0);
+      check_context();
     }
     
     void ImplCanvas::stroke()
     {
       ::cairo_stroke(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     CanvasPath *ImplCanvas::path()
     {
       CairoPathUniquePtr path(::cairo_copy_path(_M_context.get()));
       throw_canvas_exception_for_failure(path.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return new ImplCanvasPath(path);
     }
 
@@ -514,39 +837,47 @@ namespace waytk
     {
       CairoPathUniquePtr path(::cairo_copy_path_flat(_M_context.get()));
       throw_canvas_exception_for_failure(path.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return new ImplCanvasPath(path);
     }
 
     void ImplCanvas::append_path(CanvasPath *path)
     {
       ::cairo_append_path(_M_context.get(), cairo_path(path));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     bool ImplCanvas::has_point()
     {
       bool tmp_has_point = (::cairo_has_current_point(_M_context.get()) != 0);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return tmp_has_point;
     }
 
+    void ImplCanvas::get_clip_extents(Rectangle<double> &rect)
+    {
+      double x1, y1, x2, y2;
+      ::cairo_clip_extents(_M_context.get(), &x1, &y1, &x2, &y2);
+      check_context();
+      rect = Rectangle<double>(x1, y1, x2 - x1, y2 - y1);
+    }
+
     void ImplCanvas::get_point(Point<double> &p)
     {
       ::cairo_get_current_point(_M_context.get(), &(p.x), &(p.y));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::new_path()
     {
       ::cairo_new_path(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::close_path()
     {
       ::cairo_close_path(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::arc(const Point<double> &p, double radius, double angle1, double angle2, bool is_negative)
@@ -555,187 +886,189 @@ namespace waytk
         ::cairo_arc(_M_context.get(), p.x, p.y, radius, angle1, angle2);
       else
         ::cairo_arc_negative(_M_context.get(), p.x, p.y, radius, angle1, angle2);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::curve_to(const Point<double> &p1, const Point<double> &p2, const Point<double> &p3)
     {
       ::cairo_curve_to(_M_context.get(), p1.x, p1.y, p2.x, p2.y, p3.x, p3.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::line_to(const Point<double> &p)
     {
       ::cairo_line_to(_M_context.get(), p.x, p.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::move_to(const Point<double> &p)
     {
       ::cairo_move_to(_M_context.get(), p.x, p.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::rect(const Rectangle<double> &r)
     {
       ::cairo_rectangle(_M_context.get(), r.x, r.y, r.width, r.height);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::text_path(const char *utf8)
     {
       ::cairo_text_path(_M_context.get(), utf8);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       
     }
 
     void ImplCanvas::text_path(const string &utf8)
     {
       ::cairo_text_path(_M_context.get(), utf8.c_str());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::translate(const Point<double> &tp)
     {
       ::cairo_translate(_M_context.get(), tp.x, tp.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::scale(const Point<double> &sp)
     {
       ::cairo_scale(_M_context.get(), sp.x, sp.y);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::rotate(double angle)
     {
       ::cairo_rotate(_M_context.get(), angle);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     CanvasTransformation *ImplCanvas::transformation()
     {
       unique_ptr<ImplCanvasTransformation> transformation(new ImplCanvasTransformation());
       ::cairo_get_matrix(_M_context.get(), cairo_matrix(transformation.get()));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return transformation.release();
     }
 
+    void ImplCanvas::get_transformation(CanvasTransformation *transformation)
+    {
+      ::cairo_get_matrix(_M_context.get(), cairo_matrix(transformation));
+      check_context();
+    }
+
     void ImplCanvas::set_transformation(CanvasTransformation *transformation)
     {
       ::cairo_set_matrix(_M_context.get(), cairo_matrix(transformation));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     CanvasFontFace *ImplCanvas::font_face()
     { 
       ::cairo_font_face_t *font_face = ::cairo_get_font_face(_M_context.get());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       throw_canvas_exception_for_failure(font_face);
       ::cairo_font_face_reference(font_face);
       return new ImplCanvasFontFace(font_face);
     }
 
+    void ImplCanvas::get_font_face(CanvasFontFace *font_face)
+    {
+      ImplCanvasFontFace *impl_font_face = dynamic_cast<ImplCanvasFontFace *>(font_face);
+      if(impl_font_face == nullptr) throw CanvasException("unsupported font face");
+      ::cairo_font_face_t *cairo_font_face = ::cairo_get_font_face(_M_context.get());
+      check_context();
+      throw_canvas_exception_for_failure(cairo_font_face);
+      ::cairo_font_face_reference(cairo_font_face);
+      impl_font_face->set_font_face(cairo_font_face);
+    }
+
     void ImplCanvas::set_font_face(const string &name, FontSlant slant, FontWeight weight)
     {
-      ::cairo_font_slant_t cairo_slant = ::CAIRO_FONT_SLANT_NORMAL;
-      ::cairo_font_weight_t cairo_weight = ::CAIRO_FONT_WEIGHT_NORMAL;
-      switch(slant) {
-        case FontSlant::NORMAL:
-          cairo_slant = ::CAIRO_FONT_SLANT_NORMAL;
-          break;
-        case FontSlant::ITALIC:
-          cairo_slant = ::CAIRO_FONT_SLANT_ITALIC;
-          break;
-        case FontSlant::OBLIQUE:
-          cairo_slant = ::CAIRO_FONT_SLANT_OBLIQUE;
-          break;
-      }
-      switch(weight) {
-        case FontWeight::NORMAL:
-          cairo_weight = ::CAIRO_FONT_WEIGHT_NORMAL;
-          break;
-        case FontWeight::BOLD:
-          cairo_weight = ::CAIRO_FONT_WEIGHT_BOLD;
-          break;
-      }
-      ::cairo_select_font_face(_M_context.get(), name.c_str(), cairo_slant, cairo_weight);
-      throw_canvas_exception_for_failure(_M_context.get());
+      ::cairo_set_font_face(_M_context.get(), cached_font_face(name, slant, weight));
+      check_context();
     }
 
     void ImplCanvas::set_font_face(CanvasFontFace *font_face)
     {
       ::cairo_set_font_face(_M_context.get(), cairo_font_face(font_face));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::set_font_size(double size)
     {
       ::cairo_set_font_size(_M_context.get(), size);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::translate_font(const Point<double> &tp)
     {
       ::cairo_matrix_t matrix;
       ::cairo_get_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       ::cairo_matrix_translate(&matrix, tp.x, tp.y);
       ::cairo_set_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::scale_font(const Point<double> &sp)
     {
       ::cairo_matrix_t matrix;
       ::cairo_get_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       ::cairo_matrix_scale(&matrix, sp.x, sp.y);
       ::cairo_set_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::rotate_font(double angle)
     {
       ::cairo_matrix_t matrix;
       ::cairo_get_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       ::cairo_matrix_rotate(&matrix, angle);
       ::cairo_set_font_matrix(_M_context.get(), &matrix);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     CanvasTransformation *ImplCanvas::font_transformation()
     {
       unique_ptr<ImplCanvasTransformation> transformation(new ImplCanvasTransformation());
       ::cairo_get_font_matrix(_M_context.get(), cairo_matrix(transformation.get()));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       return transformation.release();
     }
 
+    void ImplCanvas::get_font_transformation(CanvasTransformation *transformation)
+    {
+      ::cairo_get_font_matrix(_M_context.get(), cairo_matrix(transformation));
+      check_context();
+    }
+
     void ImplCanvas::set_font_transformation(CanvasTransformation *transformation)
     {
       ::cairo_set_font_matrix(_M_context.get(), cairo_matrix(transformation));
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::show_text(const char *utf8)
     {
       ::cairo_show_text(_M_context.get(), utf8);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::show_text(const string &utf8)
     {
       ::cairo_show_text(_M_context.get(), utf8.c_str());
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
     }
 
     void ImplCanvas::get_font_matrics(FontMetrics &font_metrics)
     {
       ::cairo_font_extents_t font_extents;
       ::cairo_font_extents(_M_context.get(), &font_extents);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       font_metrics.ascent = font_extents.ascent;
       font_metrics.descent = font_extents.descent;
       font_metrics.height = font_extents.height;
@@ -747,7 +1080,7 @@ namespace waytk
     {
       ::cairo_text_extents_t text_extents;
       ::cairo_text_extents(_M_context.get(), utf8, &text_extents);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       text_metrics.x_bearing = text_extents.x_bearing;
       text_metrics.y_bearing = text_extents.y_bearing;
       text_metrics.width = text_extents.width;
@@ -760,7 +1093,7 @@ namespace waytk
     {
       ::cairo_text_extents_t text_extents;
       ::cairo_text_extents(_M_context.get(), utf8.c_str(), &text_extents);
-      throw_canvas_exception_for_failure(_M_context.get());
+      check_context();
       text_metrics.x_bearing = text_extents.x_bearing;
       text_metrics.y_bearing = text_extents.y_bearing;
       text_metrics.width = text_extents.width;
@@ -768,6 +1101,78 @@ namespace waytk
       text_metrics.x_advance = text_extents.x_advance;
       text_metrics.y_advance = text_extents.y_advance;
     }
+
+    //
+    // Functions.
+    //
+
+    ::cairo_format_t cairo_format(PixelFormat format)
+    {
+      switch(format) {
+        case PixelFormat::ARGB32:
+          return ::CAIRO_FORMAT_ARGB32;
+        case PixelFormat::RGB24:
+          return ::CAIRO_FORMAT_RGB24;
+        case PixelFormat::A8:
+          return ::CAIRO_FORMAT_A8;
+        case PixelFormat::RGB16_565:
+          return ::CAIRO_FORMAT_RGB16_565;
+      }
+      return ::CAIRO_FORMAT_ARGB32;
+    }
+
+    PixelFormat pixel_format(::cairo_format_t format)
+    {
+      switch(format) {
+        case ::CAIRO_FORMAT_RGB24:
+          return PixelFormat::RGB24;
+        case ::CAIRO_FORMAT_A8:
+          return PixelFormat::A8;
+        case ::CAIRO_FORMAT_RGB16_565:
+          return PixelFormat::RGB16_565;
+        case ::CAIRO_FORMAT_ARGB32:
+          return PixelFormat::ARGB32;
+        default:
+          throw CanvasException("unsupported pixel format");
+      }
+    }
+
+    ::RsvgHandle *new_svg_handle(const uint8_t *data, size_t size)
+    {
+      ::GError *error = nullptr;
+      RsvgHandleUniquePtr handle;
+      {
+        lock_guard<mutex> guard(rsvg_mutex);
+        handle = RsvgHandleUniquePtr(::rsvg_handle_new_from_data(data, size, &error));
+      }
+      if(handle.get() == nullptr) {
+        GErrorUniquePtr tmp_error(error);
+        throw FileFormatException("invalid SVG image file");
+      }
+      return handle.release();
+    }
+
+    Dimension<int> svg_handle_size(::RsvgHandle *handle)
+    {
+      ::RsvgDimensionData dim_data;
+      lock_guard<mutex> guard(rsvg_mutex);
+      ::rsvg_handle_get_dimensions(handle, &dim_data);
+      return Dimension<int>(dim_data.width, dim_data.height);
+    }
+
+    ::cairo_surface_t *new_svg_surface(::RsvgHandle *handle, const Point<double> &sp)
+    {
+      Dimension<int> tmp_size = svg_size(handle, sp);
+      CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, tmp_size.width, tmp_size.height));
+      throw_canvas_exception_for_failure(surface.get());
+      CairoUniquePtr context(::cairo_create(surface.get()));
+      ::cairo_scale(context.get(), sp.x, sp.y);
+      throw_canvas_exception_for_failure(context.get());
+      lock_guard<mutex> guard(rsvg_mutex);
+      if(::rsvg_handle_render_cairo(handle, context.get()) == FALSE)
+        throw CanvasException("can't render SVG image");
+      return surface.release();
+    }
   }
 
   //
@@ -776,12 +1181,18 @@ namespace waytk
 
   CanvasPattern::~CanvasPattern() {}
 
+  void CanvasPattern::assign(CanvasPattern *pattern)
+  { throw CanvasException("unsupported pattern"); }
+
   //
   // A CanvasImage class.
   //
 
   CanvasImage::~CanvasImage() {}
 
+  PixelFormat CanvasImage::pixel_format()
+  { return PixelFormat::ARGB32; }
+
   bool CanvasImage::is_modifiable() const
   { return  false; }
 
@@ -797,7 +1208,7 @@ namespace waytk
   CanvasModifiableImage *CanvasImage::modifiable_image()
   {
     Dimension<int> tmp_size = size();
-    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(tmp_size));
+    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(tmp_size, pixel_format()));
     unique_ptr<Canvas> canvas(image->canvas());
     canvas->set_image(this, 0.0, 0.0);
     canvas->rect(0.0, 0.0, tmp_size.width, tmp_size.height);
@@ -805,6 +1216,9 @@ namespace waytk
     return image.release();
   }
 
+  CanvasImage *CanvasImage::mip_level(int level)
+  { return this; }
+
   //
   // A CanvasModifiableImage class.
   //
@@ -814,6 +1228,52 @@ namespace waytk
   bool CanvasModifiableImage::is_modifiable() const
   { return true; }
 
+  void CanvasModifiableImage::premultiply()
+  { throw CanvasException("unsupported pixel operation"); }
+
+  void CanvasModifiableImage::unpremultiply()
+  { throw CanvasException("unsupported pixel operation"); }
+
+  void CanvasModifiableImage::fill(Color color)
+  {
+    unique_ptr<Canvas> canvas(priv::new_image_canvas(this));
+    canvas->set_op(Operator::SOURCE);
+    canvas->set_color(color);
+    canvas->paint();
+  }
+
+  void CanvasModifiableImage::blend(CanvasImage *image, const Point<int> &p)
+  {
+    unique_ptr<Canvas> canvas(priv::new_image_canvas(this));
+    canvas->set_image(image, p.x, p.y);
+    canvas->paint();
+  }
+
+  void CanvasModifiableImage::tint(Color color)
+  {
+    unique_ptr<Canvas> canvas(priv::new_image_canvas(this));
+    canvas->set_op(Operator::IN);
+    canvas->set_color(color);
+    canvas->paint();
+  }
+
+  CanvasModifiableImage *CanvasModifiableImage::downscale(int factor)
+  {
+    if(factor < 1) throw CanvasException("invalid downscale factor");
+    Dimension<int> tmp_size = size();
+    Dimension<int> new_size(max((tmp_size.width + factor - 1) / factor, 1), max((tmp_size.height + factor - 1) / factor, 1));
+    unique_ptr<CanvasModifiableImage> image(new_canvas_modifiable_image(new_size, pixel_format()));
+    unique_ptr<Canvas> canvas(priv::new_image_canvas(image.get()));
+    canvas->set_op(Operator::SOURCE);
+    canvas->scale(1.0 / factor, 1.0 / factor);
+    canvas->set_image(this, 0.0, 0.0);
+    canvas->paint();
+    canvas.reset();
+    return image.release();
+  }
+
+  void CanvasModifiableImage::discard_mip_levels() {}
+
   //
   // A CanvasScalableImage class.
   //
@@ -823,6 +1283,12 @@ namespace waytk
   bool CanvasScalableImage::is_scalable() const
   { return true; }
 
+  //
+  // A TiledImageSource class.
+  //
+
+  TiledImageSource::~TiledImageSource() {}
+
   //
   // A CanvasPath class.
   //
@@ -835,22 +1301,72 @@ namespace waytk
 
   CanvasTransformation::~CanvasTransformation() {}
 
+  void CanvasTransformation::assign(CanvasTransformation *transformation)
+  { throw CanvasException("unsupported transformation"); }
+
   //
   // A CanvasFontFace class.
   //
 
   CanvasFontFace::~CanvasFontFace() {}
 
+  void CanvasFontFace::assign(CanvasFontFace *font_face)
+  { throw CanvasException("unsupported font face"); }
+
   //
   // A Canvas class.
   //
 
   Canvas::~Canvas() {}
 
+  void Canvas::get_pattern(CanvasPattern *pattern)
+  {
+    unique_ptr<CanvasPattern> tmp_pattern(this->pattern());
+    pattern->assign(tmp_pattern.get());
+  }
+
+  void Canvas::get_transformation(CanvasTransformation *transformation)
+  {
+    unique_ptr<CanvasTransformation> tmp_transformation(this->transformation());
+    transformation->assign(tmp_transformation.get());
+  }
+
+  void Canvas::get_font_face(CanvasFontFace *font_face)
+  {
+    unique_ptr<CanvasFontFace> tmp_font_face(this->font_face());
+    font_face->assign(tmp_font_face.get());
+  }
+
+  void Canvas::get_font_transformation(CanvasTransformation *transformation)
+  {
+    unique_ptr<CanvasTransformation> tmp_transformation(font_transformation());
+    transformation->assign(tmp_transformation.get());
+  }
+
+  //
+  // A CanvasBatch class.
+  //
+
+  CanvasBatch::~CanvasBatch()
+  {
+    if(_M_canvas != nullptr) {
+      try {
+        _M_canvas->end_batch();
+      } catch(CanvasException &) {}
+    }
+  }
+
   //
   // Functions.
   //
 
+  CanvasTransformation *new_canvas_transformation()
+  {
+    ::cairo_matrix_t matrix;
+    ::cairo_matrix_init_identity(&matrix);
+    return new priv::ImplCanvasTransformation(matrix);
+  }
+
   CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size)
   {
     priv::CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, size.width, size.height));
@@ -865,44 +1381,59 @@ namespace waytk
     return new priv::ImplCanvasModifiableImage(surface);
   }
 
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, PixelFormat format)
+  {
+    priv::CairoSurfaceUniquePtr surface(::cairo_image_surface_create(priv::cairo_format(format), size.width, size.height));
+    priv::throw_canvas_exception_for_failure(surface.get());
+    return new priv::ImplCanvasModifiableImage(surface);
+  }
+
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, int stride, void *data, PixelFormat format)
+  {
+    priv::CairoSurfaceUniquePtr surface(::cairo_image_surface_create_for_data(reinterpret_cast<unsigned char *>(data), priv::cairo_format(format), size.width, size.height, stride));
+    priv::throw_canvas_exception_for_failure(surface.get());
+    return new priv::ImplCanvasModifiableImage(surface);
+  }
+
+  CanvasModifiableImage *new_canvas_modifiable_image(const Dimension<int> &size, int stride, void *data, PixelFormat format, const function<void (void *)> &release_fun)
+  {
+    priv::CairoSurfaceUniquePtr surface(::cairo_image_surface_create_for_data(reinterpret_cast<unsigned char *>(data), priv::cairo_format(format), size.width, size.height, stride));
+    priv::throw_canvas_exception_for_failure(surface.get());
+    unique_ptr<priv::PixelDataRelease> release(new priv::PixelDataRelease { release_fun, data });
+    ::cairo_status_t status = ::cairo_surface_set_user_data(surface.get(), &priv::pixel_data_release_key, release.get(), priv::release_pixel_data);
+    priv::throw_canvas_exception_for_failure(status);
+    release.release();
+    return new priv::ImplCanvasModifiableImage(surface);
+  }
+
+  int canvas_image_stride(int width, PixelFormat format)
+  { return ::cairo_format_stride_for_width(priv::cairo_format(format), width); }
+
   CanvasImage *load_canvas_image(const string &file_name)
   {
-    // Loads a PNG file.
-    {
-      priv::CairoSurfaceUniquePtr surface(::cairo_image_surface_create_from_png(file_name.c_str()));
-      ::cairo_status_t status = ::cairo_surface_status(surface.get());
-      if(status == ::CAIRO_STATUS_SUCCESS) {
-        return new priv::ImplCanvasModifiableImage(surface);
-      } else {
-        if(status == ::CAIRO_STATUS_FILE_NOT_FOUND)
-          throw IOException("file not found");
-        else if(status == ::CAIRO_STATUS_NO_MEMORY)
-          throw CanvasException(::cairo_status_to_string(status));
-      }
-    }
-    // Loads a SVG file.
-    {
-      ::GError *error;
-      priv::RsvgHandleUniquePtr handle(::rsvg_handle_new_from_file(file_name.c_str(), &error));
-      if(handle.get() != nullptr) {
-        return  new priv::ImplCanvasScalableImage(handle);
-      } else {
-        priv::GErrorUniquePtr tmp_error(error);
-        if(tmp_error->domain == G_FILE_ERROR) {
-          switch(tmp_error->code) {
-            case ::G_FILE_ERROR_NAMETOOLONG:
-              throw IOException("name too long");
-            case ::G_FILE_ERROR_NOENT:
-              throw IOException("file not found");
-            case ::G_FILE_ERROR_NOMEM:
-              throw IOException("out of memory");
-            default:
-              throw IOException("file error");
-          }
-        } else if(tmp_error->domain == G_IO_CHANNEL_ERROR)
-          throw IOException("io channel error");
-      }
-    }
-    throw FileFormatException("unsupported image file format");
+    // The file is read once and its format is detected from its content.
+    vector<uint8_t> data;
+    priv::read_file(file_name, data);
+    return priv::new_canvas_image_from_data(data, true);
+  }
+
+  CanvasImage *load_canvas_image(const string &file_name, PixelFormat format)
+  {
+    unique_ptr<CanvasImage> image(load_canvas_image(file_name));
+    if(image->is_modifiable() && image->pixel_format() == format) return image.release();
+    Dimension<int> size = image->size();
+    unique_ptr<CanvasModifiableImage> converted_image(new_canvas_modifiable_image(size, format));
+    unique_ptr<Canvas> canvas(converted_image->canvas());
+    canvas->set_op(Operator::SOURCE);
+    canvas->set_image(image.get(), 0.0, 0.0);
+    canvas->paint();
+    canvas.reset();
+    return converted_image.release();
   }
+
+  shared_future<shared_ptr<CanvasImage>> load_canvas_image_async(const string &file_name)
+  { return priv::image_loader().load(file_name); }
+
+  TiledImageSource *load_tiled_image_source(const string &dir_name)
+  { return new priv::DirectoryTiledImageSource(dir_name); }
 }
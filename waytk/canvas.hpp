@@ -24,7 +24,10 @@
 
 #include <librsvg/rsvg.h>
 #include <algorithm>
+#include <cmath>
+#include <future>
 #include <memory>
+#include <vector>
 #include <cairo.h>
 #include <waytk.hpp>
 
@@ -81,12 +84,38 @@ namespace waytk
     typedef std::unique_ptr<::cairo_t, CairoDelete> CairoUniquePtr;
     typedef std::unique_ptr<::RsvgHandle, RsvgHandleDelete> RsvgHandleUniquePtr;
     typedef std::unique_ptr<::GError, GErrorDelete> GErrorUniquePtr;
+    typedef std::shared_future<std::shared_ptr<::cairo_surface_t>> CairoSurfaceSharedFuture;
 
     inline void throw_canvas_exception_for_failure(::cairo_t *context);
     inline void throw_canvas_exception_for_failure(::cairo_pattern_t *pattern);
     inline void throw_canvas_exception_for_failure(::cairo_surface_t *surface);
     inline void throw_canvas_exception_for_failure(::cairo_path_t *path);
     inline void throw_canvas_exception_for_failure(::cairo_font_face_t *font_face);
+
+    ::cairo_format_t cairo_format(PixelFormat format);
+
+    PixelFormat pixel_format(::cairo_format_t format);
+
+    ::RsvgHandle *new_svg_handle(const std::uint8_t *data, std::size_t size);
+
+    Dimension<int> svg_handle_size(::RsvgHandle *handle);
+
+    inline Dimension<int> svg_size(const Dimension<int> &handle_size, const Point<double> &sp)
+    { return Dimension<int>(std::ceil(handle_size.width * sp.x), std::ceil(handle_size.height * sp.y)); }
+
+    inline Dimension<int> svg_size(::RsvgHandle *handle, const Point<double> &sp)
+    { return svg_size(svg_handle_size(handle), sp); }
+
+    ::cairo_surface_t *new_svg_surface(::RsvgHandle *handle, const Point<double> &sp);
+
+    template<typename _Iter>
+    void add_color_stops(::cairo_pattern_t *pattern, const _Iter &color_stop_begin, const _Iter &color_stop_end)
+    {
+      for(_Iter iter = color_stop_begin; iter != color_stop_end; iter++) {
+        ::cairo_pattern_add_color_stop_rgba(pattern, iter->offset, iter->color.red() / 255.0, iter->color.green() / 255.0, iter->color.blue() / 255.0, iter->color.alpha() / 255.0);
+        throw_canvas_exception_for_failure(pattern);
+      }
+    }
     
     class ImplCanvasPattern : public CanvasPattern
     {
@@ -99,14 +128,20 @@ namespace waytk
         _M_pattern(pattern.release()) {}
 
       virtual ~ImplCanvasPattern();
+
+      void set_pattern(::cairo_pattern_t *pattern)
+      { _M_pattern.reset(pattern); }
     protected:
       virtual Native *native();
+
+      virtual void assign(CanvasPattern *pattern);
     };
 
     class ImplCanvasImage : public virtual CanvasImage
     {
     protected:
       CairoSurfaceUniquePtr _M_surface;
+      std::vector<std::unique_ptr<CanvasImage>> _M_mip_levels;
 
       ImplCanvasImage() {}
 
@@ -116,12 +151,21 @@ namespace waytk
       virtual ~ImplCanvasImage();
 
       virtual Dimension<int> size();
+
+      virtual PixelFormat pixel_format();
+
+      virtual CanvasImage *mip_level(int level);
+
+      ::cairo_surface_t *surface()
+      { return reinterpret_cast<::cairo_surface_t *>(native()); }
     protected:
       virtual Native *native();
     };
 
     class ImplCanvasModifiableImage : public ImplCanvasImage, public CanvasModifiableImage
     {
+      std::unique_ptr<CanvasModifiableImage> _M_snapshot;
+
       ImplCanvasModifiableImage() :
         CanvasImage(), ImplCanvasImage(), CanvasModifiableImage() {}
     public:
@@ -136,29 +180,69 @@ namespace waytk
       virtual bool is_modifiable() const;
 
       virtual Canvas *canvas();
+
+      virtual void premultiply();
+
+      virtual void unpremultiply();
+
+      virtual void fill(Color color);
+
+      virtual void blend(CanvasImage *image, const Point<int> &p);
+
+      virtual void tint(Color color);
+
+      virtual CanvasModifiableImage *downscale(int factor);
+
+      virtual void discard_mip_levels();
+
+      CanvasImage *snapshot();
+    private:
+      std::uint8_t *begin_pixel_access(int &stride);
+
+      void end_pixel_access();
+    };
+
+    class ImplCanvasUnmodifiableImage : public ImplCanvasImage
+    {
+    public:
+      explicit ImplCanvasUnmodifiableImage(::cairo_surface_t *surface) :
+        CanvasImage(), ImplCanvasImage(surface) {}
+
+      explicit ImplCanvasUnmodifiableImage(CairoSurfaceUniquePtr &surface) :
+        CanvasImage(), ImplCanvasImage(surface.release()) {}
+
+      virtual ~ImplCanvasUnmodifiableImage();
     };
     
     class ImplCanvasScalableImage : public ImplCanvasImage, public CanvasScalableImage
     {
       std::shared_ptr<::RsvgHandle> _M_handle;
+      Dimension<int> _M_handle_size;
       Point<double> _M_sp;
+      CairoSurfaceSharedFuture _M_surface_future;
     public:
       explicit ImplCanvasScalableImage(::RsvgHandle *handle, const Point<double> &sp = Point<double>(1.0, 1.0)) :
         CanvasImage(), ImplCanvasImage(), CanvasScalableImage(),
-        _M_handle(handle, RsvgHandleDelete()), _M_sp(1.0, 1.0) {}
+        _M_handle(handle, RsvgHandleDelete()), _M_handle_size(svg_handle_size(handle)), _M_sp(sp) {}
 
       explicit ImplCanvasScalableImage(RsvgHandleUniquePtr &handle, const Point<double> &sp = Point<double>(1.0, 1.0)) :
         CanvasImage(), ImplCanvasImage(), CanvasScalableImage(),
-        _M_handle(handle.release(), RsvgHandleDelete()), _M_sp(1.0, 1.0) {}
+        _M_handle(handle.release(), RsvgHandleDelete()), _M_handle_size(svg_handle_size(_M_handle.get())), _M_sp(sp) {}
 
       explicit ImplCanvasScalableImage(const std::shared_ptr<::RsvgHandle> &handle, const Point<double> &sp = Point<double>(1.0, 1.0)) :
         CanvasImage(), ImplCanvasImage(), CanvasScalableImage(),
-        _M_handle(handle), _M_sp(1.0, 1.0) {}
+        _M_handle(handle), _M_handle_size(svg_handle_size(handle.get())), _M_sp(sp) {}
+
+      ImplCanvasScalableImage(const std::shared_ptr<::RsvgHandle> &handle, const Dimension<int> &handle_size, const Point<double> &sp) :
+        CanvasImage(), ImplCanvasImage(), CanvasScalableImage(),
+        _M_handle(handle), _M_handle_size(handle_size), _M_sp(sp) {}
 
       virtual ~ImplCanvasScalableImage();
 
       virtual Dimension<int> size();
 
+      virtual PixelFormat pixel_format();
+
       virtual bool is_scalable() const;
       
       virtual CanvasImage *scale(const Point<double> &sp);
@@ -167,10 +251,10 @@ namespace waytk
     protected:
       virtual Native *native();
 
-      void update_surface()
-      { _M_surface = CairoSurfaceUniquePtr(new_surface()); }
+      void update_surface();
 
-      ::cairo_surface_t *new_surface();
+      ::cairo_surface_t *new_surface()
+      { return new_svg_surface(_M_handle.get(), _M_sp); }
     };
 
     class ImplCanvasPath : public CanvasPath
@@ -194,9 +278,17 @@ namespace waytk
     public:
       ImplCanvasTransformation() {}
 
+      explicit ImplCanvasTransformation(const ::cairo_matrix_t &matrix) :
+        _M_matrix(matrix) {}
+
       virtual ~ImplCanvasTransformation();
+
+      const ::cairo_matrix_t &matrix() const
+      { return _M_matrix; }
     protected:
       virtual Native *native();
+
+      virtual void assign(CanvasTransformation *transformation);
     };
 
     class ImplCanvasFontFace : public CanvasFontFace
@@ -210,8 +302,13 @@ namespace waytk
         _M_font_face(font_face.release()) {}
 
       virtual ~ImplCanvasFontFace();
+
+      void set_font_face(::cairo_font_face_t *font_face)
+      { _M_font_face.reset(font_face); }
     protected:
       virtual Native *native();
+
+      virtual void assign(CanvasFontFace *font_face);
     };
 
     void throw_canvas_exception_for_failure_status(::cairo_status_t status);
@@ -219,12 +316,13 @@ namespace waytk
     class ImplCanvas : public Canvas
     {
       CairoUniquePtr _M_context;
+      unsigned _M_batch_level;
     public:
       explicit ImplCanvas(::cairo_t *context) :
-        _M_context(context) {}
+        _M_context(context), _M_batch_level(0) {}
 
       explicit ImplCanvas(CairoUniquePtr &context) :
-        _M_context(context.release()) {}
+        _M_context(context.release()), _M_batch_level(0) {}
 
       virtual ~ImplCanvas();
 
@@ -232,8 +330,14 @@ namespace waytk
 
       virtual void restore();
 
+      virtual void begin_batch();
+
+      virtual void end_batch();
+
       virtual CanvasPattern *pattern();
 
+      virtual void get_pattern(CanvasPattern *pattern);
+
       virtual void set_pattern(CanvasPattern *pattern);
 
       virtual void set_color(Color color);
@@ -243,12 +347,9 @@ namespace waytk
       {
         CairoPatternUniquePtr pattern(::cairo_pattern_create_linear(p1.x, p1.y, p2.x, p2.y));
         throw_canvas_exception_for_failure(pattern.get());
-        for(_Iter iter = color_stop_begin; iter != color_stop_end; iter++) {
-          ::cairo_pattern_add_color_stop_rgba(pattern.get(), iter->offset, iter->color.red(), iter->color.green(), iter->color.blue(), iter->color.alpha());
-          throw_canvas_exception_for_failure(pattern.get());
-        }
+        add_color_stops(pattern.get(), color_stop_begin, color_stop_end);
         ::cairo_set_source(_M_context.get(), pattern.get());
-        throw_canvas_exception_for_failure(_M_context.get());
+        check_context();
       }
     public:
       virtual void set_linear_gradient(const Point<double> &p1, const Point<double> &p2, std::initializer_list<ColorStop> color_stops);
@@ -260,12 +361,9 @@ namespace waytk
       {
         CairoPatternUniquePtr pattern(::cairo_pattern_create_radial(p1.x, p1.y, radius1, p2.x, p2.y, radius2));
         throw_canvas_exception_for_failure(pattern.get());
-        for(_Iter iter = color_stop_begin; iter != color_stop_end; iter++) {
-          ::cairo_pattern_add_color_stop_rgba(pattern.get(), iter->offset, iter->color.red(), iter->color.green(), iter->color.blue(), iter->color.alpha());
-          throw_canvas_exception_for_failure(pattern.get());
-        }
+        add_color_stops(pattern.get(), color_stop_begin, color_stop_end);
         ::cairo_set_source(_M_context.get(), pattern.get());
-        throw_canvas_exception_for_failure(_M_context.get());
+        check_context();
       }
     public:
       virtual void set_radial_gradient(const Point<double> &p1, double radius1, const Point<double> &p2, double radius2, std::initializer_list<ColorStop> color_stops);
@@ -352,10 +450,14 @@ namespace waytk
 
       virtual CanvasTransformation *transformation();
 
+      virtual void get_transformation(CanvasTransformation *transformation);
+
       virtual void set_transformation(CanvasTransformation *transformation);
 
       virtual CanvasFontFace *font_face();
 
+      virtual void get_font_face(CanvasFontFace *font_face);
+
       virtual void set_font_face(const std::string &name, FontSlant slant, FontWeight weight);
 
       virtual void set_font_face(CanvasFontFace *font_face);
@@ -370,6 +472,8 @@ namespace waytk
 
       virtual CanvasTransformation *font_transformation();
 
+      virtual void get_font_transformation(CanvasTransformation *transformation);
+
       virtual void set_font_transformation(CanvasTransformation *transformation);
 
       virtual void show_text(const char *utf8);
@@ -381,6 +485,17 @@ namespace waytk
       virtual void get_text_matrics(const char *utf8, TextMetrics &text_metrics);
 
       virtual void get_text_matrics(const std::string &utf8, TextMetrics &text_metrics);
+
+      void get_clip_extents(Rectangle<double> &rect);
+    protected:
+      ::cairo_t *context() const
+      { return _M_context.get(); }
+
+      bool is_in_batch() const
+      { return _M_batch_level > 0; }
+
+      void check_context() const
+      { if(_M_batch_level == 0) throw_canvas_exception_for_failure(_M_context.get()); }
     private:
       ::cairo_pattern_t *cairo_pattern(CanvasPattern *pattern) const
       { return reinterpret_cast<::cairo_pattern_t *>(native_pattern(pattern)); }
@@ -401,7 +516,7 @@ namespace waytk
     inline void throw_canvas_exception_for_failure(::cairo_status_t status)
     {
       if(status != ::CAIRO_STATUS_SUCCESS)
-        CanvasException(::cairo_status_to_string(status));
+        throw CanvasException(::cairo_status_to_string(status));
     }
 
     inline void throw_canvas_exception_for_failure(::cairo_t *context)
@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include "display_list.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      ::cairo_t *new_recording_context()
+      {
+        CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, 1, 1));
+        throw_canvas_exception_for_failure(surface.get());
+        CairoUniquePtr context(::cairo_create(surface.get()));
+        throw_canvas_exception_for_failure(context.get());
+        return context.release();
+      }
+
+      inline void get_matrix_from_args(const double *args, ::cairo_matrix_t &matrix)
+      {
+        matrix.xx = args[0];
+        matrix.yx = args[1];
+        matrix.xy = args[2];
+        matrix.yy = args[3];
+        matrix.x0 = args[4];
+        matrix.y0 = args[5];
+      }
+    }
+
+    //
+    // A DisplayList class.
+    //
+
+    bool DisplayList::get_command_bounds(size_t i, Rectangle<double> &bounds) const
+    {
+      const Command &command = _M_commands[i];
+      if(!command.has_bounds) return false;
+      const double *args = _M_args.data() + command.arg_index;
+      bounds = Rectangle<double>(args[0], args[1], args[2], args[3]);
+      return true;
+    }
+
+    bool DisplayList::get_bounds(Rectangle<double> &bounds) const
+    {
+      double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
+      bool is_bounds = false;
+      for(auto &command : _M_commands) {
+        if(command.op == DisplayListOp::PAINT || command.op == DisplayListOp::PAINT_WITH_ALPHA) {
+          // A painting covers the whole clip region, so the bounds are unknown.
+          return false;
+        }
+        if(!command.has_bounds) continue;
+        const double *args = _M_args.data() + command.arg_index;
+        if(args[2] <= 0.0 || args[3] <= 0.0) continue;
+        if(is_bounds) {
+          x1 = min(x1, args[0]);
+          y1 = min(y1, args[1]);
+          x2 = max(x2, args[0] + args[2]);
+          y2 = max(y2, args[1] + args[3]);
+        } else {
+          x1 = args[0];
+          y1 = args[1];
+          x2 = args[0] + args[2];
+          y2 = args[1] + args[3];
+          is_bounds = true;
+        }
+      }
+      if(is_bounds) bounds = Rectangle<double>(x1, y1, x2 - x1, y2 - y1);
+      return is_bounds;
+    }
+
+    void DisplayList::clear()
+    {
+      _M_commands.clear();
+      _M_args.clear();
+      _M_strings.clear();
+      _M_dashes.clear();
+      _M_patterns.clear();
+      _M_font_faces.clear();
+      _M_has_transformation = false;
+    }
+
+    void DisplayList::replay(Canvas *canvas, const Point<double> &offset) const
+    { replay_commands(canvas, offset, nullptr); }
+
+    void DisplayList::replay(Canvas *canvas, const Point<double> &offset, const Rectangle<double> &clip_rect) const
+    { replay_commands(canvas, offset, &clip_rect); }
+
+    void DisplayList::add_command(DisplayListOp op, initializer_list<double> args)
+    {
+      _M_commands.push_back(Command(op, false, _M_args.size()));
+      _M_args.insert(_M_args.end(), args);
+    }
+
+    void DisplayList::add_command_with_bounds(DisplayListOp op, const Rectangle<double> &bounds, initializer_list<double> args)
+    {
+      _M_commands.push_back(Command(op, true, _M_args.size()));
+      _M_args.insert(_M_args.end(), { bounds.x, bounds.y, bounds.width, bounds.height });
+      _M_args.insert(_M_args.end(), args);
+    }
+
+    void DisplayList::add_matrix_command(DisplayListOp op, const ::cairo_matrix_t &matrix)
+    {
+      add_command(op, { matrix.xx, matrix.yx, matrix.xy, matrix.yy, matrix.x0, matrix.y0 });
+      if(op == DisplayListOp::SET_TRANSFORMATION) _M_has_transformation = true;
+    }
+
+    void DisplayList::add_string_command(DisplayListOp op, const string &str, initializer_list<double> args)
+    {
+      add_command(op, { static_cast<double>(_M_strings.size()) });
+      _M_args.insert(_M_args.end(), args);
+      _M_strings.push_back(str);
+    }
+
+    void DisplayList::add_string_command_with_bounds(DisplayListOp op, const string &str, const Rectangle<double> &bounds, initializer_list<double> args)
+    {
+      add_command_with_bounds(op, bounds, { static_cast<double>(_M_strings.size()) });
+      _M_args.insert(_M_args.end(), args);
+      _M_strings.push_back(str);
+    }
+
+    void DisplayList::add_dash_command(const vector<double> &dashes, double offset)
+    {
+      add_command(DisplayListOp::SET_DASH, { static_cast<double>(_M_dashes.size()), offset });
+      _M_dashes.push_back(dashes);
+    }
+
+    void DisplayList::add_pattern_command(const shared_ptr<CanvasPattern> &pattern)
+    {
+      add_command(DisplayListOp::SET_PATTERN, { static_cast<double>(_M_patterns.size()) });
+      _M_patterns.push_back(pattern);
+    }
+
+    void DisplayList::add_font_face_command(const shared_ptr<CanvasFontFace> &font_face)
+    {
+      add_command(DisplayListOp::SET_FONT_FACE, { static_cast<double>(_M_font_faces.size()) });
+      _M_font_faces.push_back(font_face);
+    }
+
+    void DisplayList::replay_commands(Canvas *canvas, const Point<double> &offset, const Rectangle<double> *clip_rect) const
+    {
+      canvas->save();
+      canvas->translate(offset);
+      ::cairo_matrix_t base_matrix;
+      if(_M_has_transformation) {
+        ImplCanvasTransformation base_transformation;
+        canvas->get_transformation(&base_transformation);
+        base_matrix = base_transformation.matrix();
+      }
+      for(auto &command : _M_commands) {
+        const double *args = _M_args.data() + command.arg_index;
+        bool is_culled = false;
+        if(command.has_bounds) {
+          if(clip_rect != nullptr) {
+            Rectangle<double> bounds(args[0] + offset.x, args[1] + offset.y, args[2], args[3]);
+            Rectangle<double> tmp_rect;
+            is_culled = !bounds.intersect(*clip_rect, tmp_rect);
+          }
+          args += 4;
+        }
+        switch(command.op) {
+          case DisplayListOp::SAVE:
+            canvas->save();
+            break;
+          case DisplayListOp::RESTORE:
+            canvas->restore();
+            break;
+          case DisplayListOp::SET_PATTERN:
+            canvas->set_pattern(_M_patterns[static_cast<size_t>(args[0])].get());
+            break;
+          case DisplayListOp::SET_COLOR:
+            canvas->set_color(Color(static_cast<uint32_t>(args[0])));
+            break;
+          case DisplayListOp::SET_ANTIALIAS:
+            canvas->set_antialias(static_cast<Antialias>(static_cast<int>(args[0])));
+            break;
+          case DisplayListOp::SET_DASH:
+            canvas->set_dash(_M_dashes[static_cast<size_t>(args[0])], args[1]);
+            break;
+          case DisplayListOp::SET_LINE_CAP:
+            canvas->set_line_cap(static_cast<LineCap>(static_cast<int>(args[0])));
+            break;
+          case DisplayListOp::SET_LINE_JOIN:
+            canvas->set_line_join(static_cast<LineJoin>(static_cast<int>(args[0])));
+            break;
+          case DisplayListOp::SET_LINE_WIDTH:
+            canvas->set_line_width(args[0]);
+            break;
+          case DisplayListOp::SET_MITER_LIMIT:
+            canvas->set_miter_limit(args[0]);
+            break;
+          case DisplayListOp::SET_OP:
+            canvas->set_op(static_cast<Operator>(static_cast<int>(args[0])));
+            break;
+          case DisplayListOp::CLIP:
+            canvas->clip();
+            break;
+          case DisplayListOp::RESET_CLIP:
+            canvas->reset_clip();
+            break;
+          case DisplayListOp::FILL:
+            if(!is_culled)
+              canvas->fill();
+            else
+              canvas->new_path();
+            break;
+          case DisplayListOp::PAINT:
+            canvas->paint();
+            break;
+          case DisplayListOp::PAINT_WITH_ALPHA:
+            canvas->paint(static_cast<unsigned>(args[0]));
+            break;
+          case DisplayListOp::STROKE:
+            if(!is_culled)
+              canvas->stroke();
+            else
+              canvas->new_path();
+            break;
+          case DisplayListOp::NEW_PATH:
+            canvas->new_path();
+            break;
+          case DisplayListOp::CLOSE_PATH:
+            canvas->close_path();
+            break;
+          case DisplayListOp::ARC:
+            canvas->arc(Point<double>(args[0], args[1]), args[2], args[3], args[4], false);
+            break;
+          case DisplayListOp::ARC_NEGATIVE:
+            canvas->arc(Point<double>(args[0], args[1]), args[2], args[3], args[4], true);
+            break;
+          case DisplayListOp::CURVE_TO:
+            canvas->curve_to(Point<double>(args[0], args[1]), Point<double>(args[2], args[3]), Point<double>(args[4], args[5]));
+            break;
+          case DisplayListOp::LINE_TO:
+            canvas->line_to(Point<double>(args[0], args[1]));
+            break;
+          case DisplayListOp::MOVE_TO:
+            canvas->move_to(Point<double>(args[0], args[1]));
+            break;
+          case DisplayListOp::RECT:
+            canvas->rect(Rectangle<double>(args[0], args[1], args[2], args[3]));
+            break;
+          case DisplayListOp::TEXT_PATH:
+            canvas->text_path(_M_strings[static_cast<size_t>(args[0])]);
+            break;
+          case DisplayListOp::TRANSLATE:
+            canvas->translate(Point<double>(args[0], args[1]));
+            break;
+          case DisplayListOp::SCALE:
+            canvas->scale(Point<double>(args[0], args[1]));
+            break;
+          case DisplayListOp::ROTATE:
+            canvas->rotate(args[0]);
+            break;
+          case DisplayListOp::SET_TRANSFORMATION:
+            {
+              ::cairo_matrix_t matrix, result_matrix;
+              get_matrix_from_args(args, matrix);
+              ::cairo_matrix_multiply(&result_matrix, &matrix, &base_matrix);
+              ImplCanvasTransformation transformation(result_matrix);
+              canvas->set_transformation(&transformation);
+              break;
+            }
+          case DisplayListOp::SET_FONT_FACE_NAME:
+            canvas->set_font_face(_M_strings[static_cast<size_t>(args[0])], static_cast<FontSlant>(static_cast<int>(args[1])), static_cast<FontWeight>(static_cast<int>(args[2])));
+            break;
+          case DisplayListOp::SET_FONT_FACE:
+            canvas->set_font_face(_M_font_faces[static_cast<size_t>(args[0])].get());
+            break;
+          case DisplayListOp::SET_FONT_SIZE:
+            canvas->set_font_size(args[0]);
+            break;
+          case DisplayListOp::SET_FONT_TRANSFORMATION:
+            {
+              ::cairo_matrix_t matrix;
+              get_matrix_from_args(args, matrix);
+              ImplCanvasTransformation transformation(matrix);
+              canvas->set_font_transformation(&transformation);
+              break;
+            }
+          case DisplayListOp::SHOW_TEXT:
+            if(!is_culled)
+              canvas->show_text(_M_strings[static_cast<size_t>(args[0])]);
+            else
+              // A skipped text only moves the current point.
+              canvas->move_to(Point<double>(args[1], args[2]));
+            break;
+        }
+      }
+      canvas->restore();
+    }
+
+    //
+    // A RecordingCanvas class.
+    //
+
+    RecordingCanvas::RecordingCanvas() :
+      ImplCanvas(new_recording_context()), _M_display_list(new DisplayList()) {}
+
+    RecordingCanvas::~RecordingCanvas() {}
+
+    void RecordingCanvas::save()
+    {
+      ImplCanvas::save();
+      _M_display_list->add_command(DisplayListOp::SAVE);
+    }
+
+    void RecordingCanvas::restore()
+    {
+      ImplCanvas::restore();
+      _M_display_list->add_command(DisplayListOp::RESTORE);
+    }
+
+    void RecordingCanvas::set_pattern(CanvasPattern *pattern)
+    {
+      ImplCanvas::set_pattern(pattern);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_color(Color color)
+    {
+      ImplCanvas::set_color(color);
+      _M_display_list->add_command(DisplayListOp::SET_COLOR, { static_cast<double>(color.value()) });
+    }
+
+    void RecordingCanvas::set_linear_gradient(const Point<double> &p1, const Point<double> &p2, initializer_list<ColorStop> color_stops)
+    {
+      ImplCanvas::set_linear_gradient(p1, p2, color_stops);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_linear_gradient(const Point<double> &p1, const Point<double> &p2, const vector<ColorStop> &color_stops)
+    {
+      ImplCanvas::set_linear_gradient(p1, p2, color_stops);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_radial_gradient(const Point<double> &p1, double radius1, const Point<double> &p2, double radius2, initializer_list<ColorStop> color_stops)
+    {
+      ImplCanvas::set_radial_gradient(p1, radius1, p2, radius2, color_stops);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_radial_gradient(const Point<double> &p1, double radius1, const Point<double> &p2, double radius2, const vector<ColorStop> &color_stops)
+    {
+      ImplCanvas::set_radial_gradient(p1, radius1, p2, radius2, color_stops);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_image(CanvasImage *image, const Point<double> &p)
+    {
+      ImplCanvasModifiableImage *modifiable_image = dynamic_cast<ImplCanvasModifiableImage *>(image);
+      if(modifiable_image != nullptr) {
+        // A modifiable image can be redrawn after the recording, so its copy
+        // is recorded. The copy is only made again after a modification.
+        ImplCanvas::set_image(modifiable_image->snapshot(), p);
+      } else
+        ImplCanvas::set_image(image, p);
+      add_source_command();
+    }
+
+    void RecordingCanvas::set_antialias(Antialias antialias)
+    {
+      ImplCanvas::set_antialias(antialias);
+      _M_display_list->add_command(DisplayListOp::SET_ANTIALIAS, { static_cast<double>(static_cast<int>(antialias)) });
+    }
+
+    void RecordingCanvas::set_dash(initializer_list<double> dashes, double offset)
+    {
+      ImplCanvas::set_dash(dashes, offset);
+      _M_display_list->add_dash_command(vector<double>(dashes), offset);
+    }
+
+    void RecordingCanvas::set_dash(const vector<double> &dashes, double offset)
+    {
+      ImplCanvas::set_dash(dashes, offset);
+      _M_display_list->add_dash_command(dashes, offset);
+    }
+
+    void RecordingCanvas::set_line_cap(LineCap line_cap)
+    {
+      ImplCanvas::set_line_cap(line_cap);
+      _M_display_list->add_command(DisplayListOp::SET_LINE_CAP, { static_cast<double>(static_cast<int>(line_cap)) });
+    }
+
+    void RecordingCanvas::set_line_join(LineJoin line_join)
+    {
+      ImplCanvas::set_line_join(line_join);
+      _M_display_list->add_command(DisplayListOp::SET_LINE_JOIN, { static_cast<double>(static_cast<int>(line_join)) });
+    }
+
+    void RecordingCanvas::set_line_width(double width)
+    {
+      ImplCanvas::set_line_width(width);
+      _M_display_list->add_command(DisplayListOp::SET_LINE_WIDTH, { width });
+    }
+
+    void RecordingCanvas::set_miter_limit(double limit)
+    {
+      ImplCanvas::set_miter_limit(limit);
+      _M_display_list->add_command(DisplayListOp::SET_MITER_LIMIT, { limit });
+    }
+
+    void RecordingCanvas::set_op(Operator op)
+    {
+      ImplCanvas::set_op(op);
+      _M_display_list->add_command(DisplayListOp::SET_OP, { static_cast<double>(static_cast<int>(op)) });
+    }
+
+    void RecordingCanvas::clip()
+    {
+      ImplCanvas::clip();
+      _M_display_list->add_command(DisplayListOp::CLIP);
+    }
+
+    void RecordingCanvas::reset_clip()
+    {
+      ImplCanvas::reset_clip();
+      _M_display_list->add_command(DisplayListOp::RESET_CLIP);
+    }
+
+    void RecordingCanvas::fill()
+    {
+      double x1, y1, x2, y2;
+      ::cairo_fill_extents(context(), &x1, &y1, &x2, &y2);
+      check_context();
+      _M_display_list->add_command_with_bounds(DisplayListOp::FILL, device_rect(x1, y1, x2, y2));
+      ImplCanvas::fill();
+    }
+
+    void RecordingCanvas::paint()
+    {
+      ImplCanvas::paint();
+      _M_display_list->add_command(DisplayListOp::PAINT);
+    }
+
+    void RecordingCanvas::paint(unsigned alpha)
+    {
+      ImplCanvas::paint(alpha);
+      _M_display_list->add_command(DisplayListOp::PAINT_WITH_ALPHA, { static_cast<double>(alpha) });
+    }
+
+    void RecordingCanvas::stroke()
+    {
+      double x1, y1, x2, y2;
+      ::cairo_stroke_extents(context(), &x1, &y1, &x2, &y2);
+      check_context();
+      _M_display_list->add_command_with_bounds(DisplayListOp::STROKE, device_rect(x1, y1, x2, y2));
+      ImplCanvas::stroke();
+    }
+
+    void RecordingCanvas::append_path(CanvasPath *path)
+    {
+      ::cairo_path_t *cairo_path = reinterpret_cast<::cairo_path_t *>(native_path(path));
+      for(int i = 0; i < cairo_path->num_data; i += cairo_path->data[i].header.length) {
+        ::cairo_path_data_t *data = cairo_path->data + i;
+        switch(data->header.type) {
+          case ::CAIRO_PATH_MOVE_TO:
+            move_to(Point<double>(data[1].point.x, data[1].point.y));
+            break;
+          case ::CAIRO_PATH_LINE_TO:
+            line_to(Point<double>(data[1].point.x, data[1].point.y));
+            break;
+          case ::CAIRO_PATH_CURVE_TO:
+            curve_to(Point<double>(data[1].point.x, data[1].point.y), Point<double>(data[2].point.x, data[2].point.y), Point<double>(data[3].point.x, data[3].point.y));
+            break;
+          case ::CAIRO_PATH_CLOSE_PATH:
+            close_path();
+            break;
+        }
+      }
+    }
+
+    void RecordingCanvas::new_path()
+    {
+      ImplCanvas::new_path();
+      _M_display_list->add_command(DisplayListOp::NEW_PATH);
+    }
+
+    void RecordingCanvas::close_path()
+    {
+      ImplCanvas::close_path();
+      _M_display_list->add_command(DisplayListOp::CLOSE_PATH);
+    }
+
+    void RecordingCanvas::arc(const Point<double> &p, double radius, double angle1, double angle2, bool is_negative)
+    {
+      ImplCanvas::arc(p, radius, angle1, angle2, is_negative);
+      _M_display_list->add_command(is_negative ? DisplayListOp::ARC_NEGATIVE : DisplayListOp::ARC, { p.x, p.y, radius, angle1, angle2 });
+    }
+
+    void RecordingCanvas::curve_to(const Point<double> &p1, const Point<double> &p2, const Point<double> &p3)
+    {
+      ImplCanvas::curve_to(p1, p2, p3);
+      _M_display_list->add_command(DisplayListOp::CURVE_TO, { p1.x, p1.y, p2.x, p2.y, p3.x, p3.y });
+    }
+
+    void RecordingCanvas::line_to(const Point<double> &p)
+    {
+      ImplCanvas::line_to(p);
+      _M_display_list->add_command(DisplayListOp::LINE_TO, { p.x, p.y });
+    }
+
+    void RecordingCanvas::move_to(const Point<double> &p)
+    {
+      ImplCanvas::move_to(p);
+      _M_display_list->add_command(DisplayListOp::MOVE_TO, { p.x, p.y });
+    }
+
+    void RecordingCanvas::rect(const Rectangle<double> &r)
+    {
+      ImplCanvas::rect(r);
+      _M_display_list->add_command(DisplayListOp::RECT, { r.x, r.y, r.width, r.height });
+    }
+
+    void RecordingCanvas::text_path(const char *utf8)
+    {
+      ImplCanvas::text_path(utf8);
+      _M_display_list->add_string_command(DisplayListOp::TEXT_PATH, utf8);
+    }
+
+    void RecordingCanvas::text_path(const string &utf8)
+    {
+      ImplCanvas::text_path(utf8);
+      _M_display_list->add_string_command(DisplayListOp::TEXT_PATH, utf8);
+    }
+
+    void RecordingCanvas::translate(const Point<double> &tp)
+    {
+      ImplCanvas::translate(tp);
+      _M_display_list->add_command(DisplayListOp::TRANSLATE, { tp.x, tp.y });
+    }
+
+    void RecordingCanvas::scale(const Point<double> &sp)
+    {
+      ImplCanvas::scale(sp);
+      _M_display_list->add_command(DisplayListOp::SCALE, { sp.x, sp.y });
+    }
+
+    void RecordingCanvas::rotate(double angle)
+    {
+      ImplCanvas::rotate(angle);
+      _M_display_list->add_command(DisplayListOp::ROTATE, { angle });
+    }
+
+    void RecordingCanvas::set_transformation(CanvasTransformation *transformation)
+    {
+      ImplCanvas::set_transformation(transformation);
+      ::cairo_matrix_t matrix;
+      ::cairo_get_matrix(context(), &matrix);
+      check_context();
+      _M_display_list->add_matrix_command(DisplayListOp::SET_TRANSFORMATION, matrix);
+    }
+
+    void RecordingCanvas::set_font_face(const string &name, FontSlant slant, FontWeight weight)
+    {
+      ImplCanvas::set_font_face(name, slant, weight);
+      _M_display_list->add_string_command(DisplayListOp::SET_FONT_FACE_NAME, name, { static_cast<double>(static_cast<int>(slant)), static_cast<double>(static_cast<int>(weight)) });
+    }
+
+    void RecordingCanvas::set_font_face(CanvasFontFace *font_face)
+    {
+      ImplCanvas::set_font_face(font_face);
+      _M_display_list->add_font_face_command(shared_ptr<CanvasFontFace>(ImplCanvas::font_face()));
+    }
+
+    void RecordingCanvas::set_font_size(double size)
+    {
+      ImplCanvas::set_font_size(size);
+      _M_display_list->add_command(DisplayListOp::SET_FONT_SIZE, { size });
+    }
+
+    void RecordingCanvas::translate_font(const Point<double> &tp)
+    {
+      ImplCanvas::translate_font(tp);
+      add_font_transformation_command();
+    }
+
+    void RecordingCanvas::scale_font(const Point<double> &sp)
+    {
+      ImplCanvas::scale_font(sp);
+      add_font_transformation_command();
+    }
+
+    void RecordingCanvas::rotate_font(double angle)
+    {
+      ImplCanvas::rotate_font(angle);
+      add_font_transformation_command();
+    }
+
+    void RecordingCanvas::set_font_transformation(CanvasTransformation *transformation)
+    {
+      ImplCanvas::set_font_transformation(transformation);
+      add_font_transformation_command();
+    }
+
+    void RecordingCanvas::show_text(const char *utf8)
+    {
+      double x = 0.0, y = 0.0;
+      if(::cairo_has_current_point(context())) ::cairo_get_current_point(context(), &x, &y);
+      ::cairo_text_extents_t text_extents;
+      ::cairo_text_extents(context(), utf8, &text_extents);
+      check_context();
+      double x1 = x + text_extents.x_bearing, y1 = y + text_extents.y_bearing;
+      Rectangle<double> bounds = device_rect(x1, y1, x1 + text_extents.width, y1 + text_extents.height);
+      _M_display_list->add_string_command_with_bounds(DisplayListOp::SHOW_TEXT, utf8, bounds, { x + text_extents.x_advance, y + text_extents.y_advance });
+      ImplCanvas::show_text(utf8);
+    }
+
+    void RecordingCanvas::show_text(const string &utf8)
+    { show_text(utf8.c_str()); }
+
+    void RecordingCanvas::add_source_command()
+    {
+      ::cairo_pattern_t *pattern = ::cairo_get_source(context());
+      check_context();
+      ::cairo_pattern_reference(pattern);
+      _M_display_list->add_pattern_command(shared_ptr<CanvasPattern>(new ImplCanvasPattern(pattern)));
+    }
+
+    void RecordingCanvas::add_font_transformation_command()
+    {
+      ::cairo_matrix_t matrix;
+      ::cairo_get_font_matrix(context(), &matrix);
+      check_context();
+      _M_display_list->add_matrix_command(DisplayListOp::SET_FONT_TRANSFORMATION, matrix);
+    }
+
+    Rectangle<double> RecordingCanvas::device_rect(double x1, double y1, double x2, double y2) const
+    {
+      if(x1 >= x2 || y1 >= y2) return Rectangle<double>(0.0, 0.0, 0.0, 0.0);
+      double xs[4] = { x1, x2, x1, x2 };
+      double ys[4] = { y1, y1, y2, y2 };
+      for(int i = 0; i < 4; i++) ::cairo_user_to_device(context(), xs + i, ys + i);
+      double min_x = *min_element(xs, xs + 4), max_x = *max_element(xs, xs + 4);
+      double min_y = *min_element(ys, ys + 4), max_y = *max_element(ys, ys + 4);
+      return Rectangle<double>(min_x, min_y, max_x - min_x, max_y - min_y);
+    }
+  }
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _DISPLAY_LIST_HPP
+#define _DISPLAY_LIST_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <waytk.hpp>
+#include "canvas.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    enum class DisplayListOp : std::uint8_t
+    {
+      SAVE,
+      RESTORE,
+      SET_PATTERN,
+      SET_COLOR,
+      SET_ANTIALIAS,
+      SET_DASH,
+      SET_LINE_CAP,
+      SET_LINE_JOIN,
+      SET_LINE_WIDTH,
+      SET_MITER_LIMIT,
+      SET_OP,
+      CLIP,
+      RESET_CLIP,
+      FILL,
+      PAINT,
+      PAINT_WITH_ALPHA,
+      STROKE,
+      NEW_PATH,
+      CLOSE_PATH,
+      ARC,
+      ARC_NEGATIVE,
+      CURVE_TO,
+      LINE_TO,
+      MOVE_TO,
+      RECT,
+      TEXT_PATH,
+      TRANSLATE,
+      SCALE,
+      ROTATE,
+      SET_TRANSFORMATION,
+      SET_FONT_FACE_NAME,
+      SET_FONT_FACE,
+      SET_FONT_SIZE,
+      SET_FONT_TRANSFORMATION,
+      SHOW_TEXT
+    };
+
+    class DisplayList
+    {
+      struct Command
+      {
+        DisplayListOp op;
+        bool has_bounds;
+        std::uint32_t arg_index;
+
+        Command() {}
+
+        Command(DisplayListOp op, bool has_bounds, std::uint32_t arg_index) :
+          op(op), has_bounds(has_bounds), arg_index(arg_index) {}
+      };
+
+      std::vector<Command> _M_commands;
+      std::vector<double> _M_args;
+      std::vector<std::string> _M_strings;
+      std::vector<std::vector<double>> _M_dashes;
+      std::vector<std::shared_ptr<CanvasPattern>> _M_patterns;
+      std::vector<std::shared_ptr<CanvasFontFace>> _M_font_faces;
+      bool _M_has_transformation;
+    public:
+      DisplayList() :
+        _M_has_transformation(false) {}
+
+      std::size_t command_count() const
+      { return _M_commands.size(); }
+
+      DisplayListOp command_op(std::size_t i) const
+      { return _M_commands[i].op; }
+
+      bool get_command_bounds(std::size_t i, Rectangle<double> &bounds) const;
+
+      bool get_bounds(Rectangle<double> &bounds) const;
+
+      void clear();
+
+      void replay(Canvas *canvas) const
+      { replay(canvas, Point<double>(0.0, 0.0)); }
+
+      void replay(Canvas *canvas, const Point<double> &offset) const;
+
+      void replay(Canvas *canvas, const Point<double> &offset, const Rectangle<double> &clip_rect) const;
+
+      void add_command(DisplayListOp op)
+      { _M_commands.push_back(Command(op, false, _M_args.size())); }
+
+      void add_command(DisplayListOp op, std::initializer_list<double> args);
+
+      void add_command_with_bounds(DisplayListOp op, const Rectangle<double> &bounds, std::initializer_list<double> args = {});
+
+      void add_matrix_command(DisplayListOp op, const ::cairo_matrix_t &matrix);
+
+      void add_string_command(DisplayListOp op, const std::string &str, std::initializer_list<double> args = {});
+
+      void add_string_command_with_bounds(DisplayListOp op, const std::string &str, const Rectangle<double> &bounds, std::initializer_list<double> args = {});
+
+      void add_dash_command(const std::vector<double> &dashes, double offset);
+
+      void add_pattern_command(const std::shared_ptr<CanvasPattern> &pattern);
+
+      void add_font_face_command(const std::shared_ptr<CanvasFontFace> &font_face);
+    private:
+      void replay_commands(Canvas *canvas, const Point<double> &offset, const Rectangle<double> *clip_rect) const;
+    };
+
+    class RecordingCanvas : public ImplCanvas
+    {
+      std::shared_ptr<DisplayList> _M_display_list;
+    public:
+      RecordingCanvas();
+
+      virtual ~RecordingCanvas();
+
+      const std::shared_ptr<DisplayList> &display_list() const
+      { return _M_display_list; }
+
+      virtual void save();
+
+      virtual void restore();
+
+      virtual void set_pattern(CanvasPattern *pattern);
+
+      virtual void set_color(Color color);
+
+      virtual void set_linear_gradient(const Point<double> &p1, const Point<double> &p2, std::initializer_list<ColorStop> color_stops);
+
+      virtual void set_linear_gradient(const Point<double> &p1, const Point<double> &p2, const std::vector<ColorStop> &color_stops);
+
+      virtual void set_radial_gradient(const Point<double> &p1, double radius1, const Point<double> &p2, double radius2, std::initializer_list<ColorStop> color_stops);
+
+      virtual void set_radial_gradient(const Point<double> &p1, double radius1, const Point<double> &p2, double radius2, const std::vector<ColorStop> &color_stops);
+
+      virtual void set_image(CanvasImage *image, const Point<double> &p);
+
+      virtual void set_antialias(Antialias antialias);
+
+      virtual void set_dash(std::initializer_list<double> dashes, double offset);
+
+      virtual void set_dash(const std::vector<double> &dashes, double offset);
+
+      virtual void set_line_cap(LineCap line_cap);
+
+      virtual void set_line_join(LineJoin line_join);
+
+      virtual void set_line_width(double width);
+
+      virtual void set_miter_limit(double limit);
+
+      virtual void set_op(Operator op);
+
+      virtual void clip();
+
+      virtual void reset_clip();
+
+      virtual void fill();
+
+      virtual void paint();
+
+      virtual void paint(unsigned alpha);
+
+      virtual void stroke();
+
+      virtual void append_path(CanvasPath *path);
+
+      virtual void new_path();
+
+      virtual void close_path();
+
+      virtual void arc(const Point<double> &p, double radius, double angle1, double angle2, bool is_negative);
+
+      virtual void curve_to(const Point<double> &p1, const Point<double> &p2, const Point<double> &p3);
+
+      virtual void line_to(const Point<double> &p);
+
+      virtual void move_to(const Point<double> &p);
+
+      virtual void rect(const Rectangle<double> &r);
+
+      virtual void text_path(const char *utf8);
+
+      virtual void text_path(const std::string &utf8);
+
+      virtual void translate(const Point<double> &tp);
+
+      virtual void scale(const Point<double> &sp);
+
+      virtual void rotate(double angle);
+
+      virtual void set_transformation(CanvasTransformation *transformation);
+
+      virtual void set_font_face(const std::string &name, FontSlant slant, FontWeight weight);
+
+      virtual void set_font_face(CanvasFontFace *font_face);
+
+      virtual void set_font_size(double size);
+
+      virtual void translate_font(const Point<double> &tp);
+
+      virtual void scale_font(const Point<double> &sp);
+
+      virtual void rotate_font(double angle);
+
+      virtual void set_font_transformation(CanvasTransformation *transformation);
+
+      virtual void show_text(const char *utf8);
+
+      virtual void show_text(const std::string &utf8);
+    private:
+      void add_source_command();
+
+      void add_font_transformation_command();
+
+      Rectangle<double> device_rect(double x1, double y1, double x2, double y2) const;
+    };
+  }
+}
+
+#endif
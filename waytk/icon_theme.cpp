@@ -0,0 +1,609 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "icon_theme.hpp"
+#include "image_loader.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      const char index_magic[8] = { 'W', 'T', 'K', 'I', 'C', 'O', 'N', '2' };
+
+      struct BuildEntry
+      {
+        string name;
+        uint32_t root_index;
+        int32_t pixel_size;
+        string path;
+      };
+
+      struct BuildDir
+      {
+        string path;
+        int64_t mtime;
+      };
+
+      struct DirDelete
+      {
+        void operator()(DIR *dir) const
+        { closedir(dir); }
+      };
+
+      int64_t stat_mtime(const struct stat &path_stat)
+      { return static_cast<int64_t>(path_stat.st_mtim.tv_sec) * 1000000000 + path_stat.st_mtim.tv_nsec; }
+
+      int64_t dir_mtime(const string &dir_name)
+      {
+        struct stat dir_stat;
+        if(stat(dir_name.c_str(), &dir_stat) == -1 || !S_ISDIR(dir_stat.st_mode)) return -1;
+        return stat_mtime(dir_stat);
+      }
+
+      // Returns the icon size for a directory name such as "16x16", "16x16@2",
+      // "16", or "scalable". Zero is the size of scalable icons.
+      bool dir_pixel_size(const char *dir_name, int32_t &pixel_size)
+      {
+        if(strcmp(dir_name, "scalable") == 0) {
+          pixel_size = 0;
+          return true;
+        }
+        char *end;
+        long width = strtol(dir_name, &end, 10);
+        if(end == dir_name || width <= 0) return false;
+        if(*end == 0) {
+          pixel_size = width;
+          return true;
+        }
+        if(*end != 'x') return false;
+        const char *height_str = end + 1;
+        long height = strtol(height_str, &end, 10);
+        if(end == height_str || height != width || (*end != 0 && *end != '@')) return false;
+        pixel_size = width;
+        return true;
+      }
+
+      void scan_dir(const string &dir_name, uint32_t root_index, int32_t pixel_size, unsigned depth, vector<BuildDir> &dirs, vector<BuildEntry> &entries)
+      {
+        if(depth > 8) return;
+        unique_ptr<DIR, DirDelete> dir(opendir(dir_name.c_str()));
+        if(dir.get() == nullptr) return;
+        struct dirent *dir_entry;
+        while((dir_entry = readdir(dir.get())) != nullptr) {
+          if(strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) continue;
+          string path = dir_name + "/" + dir_entry->d_name;
+          struct stat path_stat;
+          if(stat(path.c_str(), &path_stat) == -1) continue;
+          if(S_ISDIR(path_stat.st_mode)) {
+            // The modification times of the subdirectories are also checked
+            // because an icon that is added to a subdirectory doesn't change
+            // the modification time of the theme directory.
+            BuildDir dir;
+            dir.path = path;
+            dir.mtime = stat_mtime(path_stat);
+            dirs.push_back(dir);
+            int32_t tmp_pixel_size = pixel_size;
+            dir_pixel_size(dir_entry->d_name, tmp_pixel_size);
+            scan_dir(path, root_index, tmp_pixel_size, depth + 1, dirs, entries);
+          } else if(S_ISREG(path_stat.st_mode)) {
+            const char *ext = strrchr(dir_entry->d_name, '.');
+            if(ext == nullptr) continue;
+            int32_t tmp_pixel_size = pixel_size;
+            if(strcmp(ext, ".svg") == 0) {
+              if(tmp_pixel_size == -1) tmp_pixel_size = 0;
+            } else if(strcmp(ext, ".png") != 0)
+              continue;
+            BuildEntry entry;
+            entry.name = string(dir_entry->d_name, ext - dir_entry->d_name);
+            entry.root_index = root_index;
+            entry.pixel_size = tmp_pixel_size;
+            entry.path = path;
+            entries.push_back(entry);
+          }
+        }
+      }
+
+      template<typename _T>
+      void append_to_buffer(vector<uint8_t> &buffer, const _T &object)
+      {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&object);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(_T));
+      }
+
+      void split_dirs(const char *dirs, vector<string> &dir_names)
+      {
+        const char *begin = dirs;
+        while(true) {
+          const char *end = strchr(begin, ':');
+          string dir_name(begin, end != nullptr ? end - begin : strlen(begin));
+          if(!dir_name.empty()) dir_names.push_back(dir_name);
+          if(end == nullptr) break;
+          begin = end + 1;
+        }
+      }
+
+      string index_file_name()
+      { return cache_file_name("icon-index"); }
+
+      string trim(const string &str)
+      {
+        size_t begin = str.find_first_not_of(" \t\r");
+        if(begin == string::npos) return string();
+        size_t end = str.find_last_not_of(" \t\r");
+        return str.substr(begin, end - begin + 1);
+      }
+
+      // Reads the parent themes from the Inherits key of the index.theme file
+      // of the theme.
+      void read_inherited_theme_names(const string &theme_name, const vector<string> &data_dirs, vector<string> &names)
+      {
+        for(auto &data_dir : data_dirs) {
+          FILE *file = fopen((data_dir + "/icons/" + theme_name + "/index.theme").c_str(), "r");
+          if(file == nullptr) continue;
+          bool is_icon_theme_section = false;
+          char buffer[1024];
+          while(fgets(buffer, sizeof(buffer), file) != nullptr) {
+            string line = trim(string(buffer, strcspn(buffer, "\n")));
+            if(!line.empty() && line[0] == '[') {
+              is_icon_theme_section = (line == "[Icon Theme]");
+              continue;
+            }
+            if(!is_icon_theme_section) continue;
+            size_t equal_pos = line.find('=');
+            if(equal_pos == string::npos || trim(line.substr(0, equal_pos)) != "Inherits") continue;
+            string value = line.substr(equal_pos + 1);
+            size_t begin = 0;
+            while(begin <= value.size()) {
+              size_t end = value.find(',', begin);
+              if(end == string::npos) end = value.size();
+              string name = trim(value.substr(begin, end - begin));
+              if(!name.empty()) names.push_back(name);
+              begin = end + 1;
+            }
+          }
+          fclose(file);
+          // The first index.theme file of the theme is only read.
+          return;
+        }
+      }
+
+      void add_theme_name(const string &theme_name, const vector<string> &data_dirs, unsigned depth, vector<string> &names)
+      {
+        if(depth > 16 || find(names.begin(), names.end(), theme_name) != names.end()) return;
+        names.push_back(theme_name);
+        vector<string> inherited_names;
+        read_inherited_theme_names(theme_name, data_dirs, inherited_names);
+        for(auto &inherited_name : inherited_names)
+          add_theme_name(inherited_name, data_dirs, depth + 1, names);
+      }
+    }
+
+    //
+    // A MappedFile class.
+    //
+
+    bool MappedFile::map(const string &file_name)
+    {
+      unmap();
+      int fd = open(file_name.c_str(), O_RDONLY);
+      if(fd == -1) return false;
+      struct stat file_stat;
+      if(fstat(fd, &file_stat) == -1 || file_stat.st_size <= 0) {
+        close(fd);
+        return false;
+      }
+      void *data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if(data == MAP_FAILED) return false;
+      _M_data = data;
+      _M_size = file_stat.st_size;
+      return true;
+    }
+
+    void MappedFile::unmap()
+    {
+      if(_M_data != nullptr) munmap(_M_data, _M_size);
+      _M_data = nullptr;
+      _M_size = 0;
+    }
+
+    //
+    // An IconIndex class.
+    //
+
+    struct IconIndex::Header
+    {
+      char magic[8];
+      uint32_t root_dir_count;
+      uint32_t dir_count;
+      uint32_t entry_count;
+      uint32_t root_dirs_offset;
+      uint32_t dirs_offset;
+      uint32_t entries_offset;
+      uint32_t strings_offset;
+      uint32_t strings_size;
+    };
+
+    struct IconIndex::RootDir
+    {
+      int64_t mtime;
+      uint32_t path_offset;
+      uint32_t pad;
+    };
+
+    struct IconIndex::Dir
+    {
+      int64_t mtime;
+      uint32_t path_offset;
+      uint32_t pad;
+    };
+
+    struct IconIndex::Entry
+    {
+      uint32_t name_offset;
+      uint32_t name_length;
+      uint32_t path_offset;
+      int32_t pixel_size;
+      uint32_t root_index;
+    };
+
+    bool IconIndex::load(const string &file_name, const vector<string> &root_dirs)
+    {
+      _M_buffer.clear();
+      if(file_name.empty() || !_M_file.map(file_name)) return false;
+      _M_data = _M_file.data();
+      _M_size = _M_file.size();
+      if(!check(root_dirs)) {
+        _M_file.unmap();
+        _M_data = nullptr;
+        _M_size = 0;
+        return false;
+      }
+      return true;
+    }
+
+    void IconIndex::build(const vector<string> &root_dirs)
+    {
+      vector<BuildDir> build_dirs;
+      vector<BuildEntry> build_entries;
+      for(uint32_t i = 0; i < root_dirs.size(); i++)
+        scan_dir(root_dirs[i], i, -1, 0, build_dirs, build_entries);
+      sort(build_entries.begin(), build_entries.end(), [](const BuildEntry &entry1, const BuildEntry &entry2) {
+        if(entry1.name != entry2.name) return entry1.name < entry2.name;
+        if(entry1.root_index != entry2.root_index) return entry1.root_index < entry2.root_index;
+        return entry1.pixel_size < entry2.pixel_size;
+      });
+      string strings;
+      vector<RootDir> tmp_root_dirs;
+      for(auto &root_dir : root_dirs) {
+        RootDir tmp_root_dir;
+        tmp_root_dir.mtime = dir_mtime(root_dir);
+        tmp_root_dir.path_offset = strings.size();
+        tmp_root_dir.pad = 0;
+        tmp_root_dirs.push_back(tmp_root_dir);
+        strings.append(root_dir.c_str(), root_dir.size() + 1);
+      }
+      vector<Dir> dirs;
+      for(auto &build_dir : build_dirs) {
+        Dir dir;
+        dir.mtime = build_dir.mtime;
+        dir.path_offset = strings.size();
+        dir.pad = 0;
+        dirs.push_back(dir);
+        strings.append(build_dir.path.c_str(), build_dir.path.size() + 1);
+      }
+      vector<Entry> entries;
+      for(auto &build_entry : build_entries) {
+        Entry entry;
+        entry.name_offset = strings.size();
+        entry.name_length = build_entry.name.size();
+        strings.append(build_entry.name.c_str(), build_entry.name.size() + 1);
+        entry.path_offset = strings.size();
+        strings.append(build_entry.path.c_str(), build_entry.path.size() + 1);
+        entry.pixel_size = build_entry.pixel_size;
+        entry.root_index = build_entry.root_index;
+        entries.push_back(entry);
+      }
+      Header header;
+      copy(index_magic, index_magic + 8, header.magic);
+      header.root_dir_count = tmp_root_dirs.size();
+      header.dir_count = dirs.size();
+      header.entry_count = entries.size();
+      header.root_dirs_offset = sizeof(Header);
+      header.dirs_offset = header.root_dirs_offset + tmp_root_dirs.size() * sizeof(RootDir);
+      header.entries_offset = header.dirs_offset + dirs.size() * sizeof(Dir);
+      header.strings_offset = header.entries_offset + entries.size() * sizeof(Entry);
+      header.strings_size = strings.size();
+      _M_file.unmap();
+      _M_buffer.clear();
+      append_to_buffer(_M_buffer, header);
+      for(auto &root_dir : tmp_root_dirs) append_to_buffer(_M_buffer, root_dir);
+      for(auto &dir : dirs) append_to_buffer(_M_buffer, dir);
+      for(auto &entry : entries) append_to_buffer(_M_buffer, entry);
+      _M_buffer.insert(_M_buffer.end(), strings.begin(), strings.end());
+      _M_data = _M_buffer.data();
+      _M_size = _M_buffer.size();
+    }
+
+    bool IconIndex::save(const string &file_name) const
+    {
+      if(file_name.empty() || _M_data == nullptr) return false;
+      // The index is written to a temporary file and it is renamed, so other
+      // processes never map a partial index.
+      string tmp_file_name = file_name + ".tmp";
+      FILE *file = fopen(tmp_file_name.c_str(), "wb");
+      if(file == nullptr) return false;
+      bool is_written = (fwrite(_M_data, 1, _M_size, file) == _M_size);
+      if(fclose(file) != 0) is_written = false;
+      if(!is_written || rename(tmp_file_name.c_str(), file_name.c_str()) == -1) {
+        remove(tmp_file_name.c_str());
+        return false;
+      }
+      return true;
+    }
+
+    bool IconIndex::find(const string &name, int pixel_size, string &file_name) const
+    {
+      if(_M_data == nullptr) return false;
+      const Entry *entry_begin = entries();
+      const Entry *entry_end = entry_begin + header()->entry_count;
+      const Entry *iter = lower_bound(entry_begin, entry_end, name, [this](const Entry &entry, const string &tmp_name) {
+        return index_string(entry.name_offset) < tmp_name;
+      });
+      const Entry *scalable_entry = nullptr;
+      const Entry *larger_entry = nullptr;
+      const Entry *smaller_entry = nullptr;
+      const Entry *unknown_entry = nullptr;
+      uint32_t root_index = (iter != entry_end ? iter->root_index : 0);
+      for(; iter != entry_end && name == index_string(iter->name_offset); iter++) {
+        // The icons from the first root directory that has the icon are only
+        // considered.
+        if(iter->root_index != root_index) break;
+        if(iter->pixel_size == pixel_size) {
+          file_name = index_string(iter->path_offset);
+          return true;
+        } else if(iter->pixel_size == 0)
+          scalable_entry = iter;
+        else if(iter->pixel_size > pixel_size) {
+          if(larger_entry == nullptr) larger_entry = iter;
+        } else if(iter->pixel_size > 0)
+          smaller_entry = iter;
+        else
+          unknown_entry = iter;
+      }
+      const Entry *entry = scalable_entry;
+      if(entry == nullptr) entry = larger_entry;
+      if(entry == nullptr) entry = smaller_entry;
+      if(entry == nullptr) entry = unknown_entry;
+      if(entry == nullptr) return false;
+      file_name = index_string(entry->path_offset);
+      return true;
+    }
+
+    bool IconIndex::check(const vector<string> &root_dirs) const
+    {
+      if(_M_size < sizeof(Header)) return false;
+      const Header *tmp_header = header();
+      if(!equal(index_magic, index_magic + 8, tmp_header->magic)) return false;
+      if(tmp_header->root_dirs_offset != sizeof(Header)) return false;
+      if(tmp_header->dirs_offset != tmp_header->root_dirs_offset + tmp_header->root_dir_count * sizeof(RootDir)) return false;
+      if(tmp_header->entries_offset != tmp_header->dirs_offset + tmp_header->dir_count * sizeof(Dir)) return false;
+      if(tmp_header->strings_offset != tmp_header->entries_offset + tmp_header->entry_count * sizeof(Entry)) return false;
+      if(static_cast<size_t>(tmp_header->strings_offset) + tmp_header->strings_size != _M_size) return false;
+      if(tmp_header->strings_size == 0 || _M_data[_M_size - 1] != 0) return false;
+      if(tmp_header->root_dir_count != root_dirs.size()) return false;
+      const RootDir *tmp_root_dirs = this->root_dirs();
+      for(size_t i = 0; i < root_dirs.size(); i++) {
+        if(tmp_root_dirs[i].path_offset >= tmp_header->strings_size) return false;
+        if(root_dirs[i] != index_string(tmp_root_dirs[i].path_offset)) return false;
+        // The index is rebuilt if a theme directory is changed.
+        if(tmp_root_dirs[i].mtime != dir_mtime(root_dirs[i])) return false;
+      }
+      const Dir *tmp_dirs = dirs();
+      for(size_t i = 0; i < tmp_header->dir_count; i++) {
+        if(tmp_dirs[i].path_offset >= tmp_header->strings_size) return false;
+        // A removed subdirectory has the -1 modification time.
+        if(tmp_dirs[i].mtime != dir_mtime(index_string(tmp_dirs[i].path_offset))) return false;
+      }
+      const Entry *tmp_entries = entries();
+      for(size_t i = 0; i < tmp_header->entry_count; i++) {
+        if(tmp_entries[i].name_offset >= tmp_header->strings_size) return false;
+        if(tmp_entries[i].path_offset >= tmp_header->strings_size) return false;
+      }
+      return true;
+    }
+
+    const IconIndex::Header *IconIndex::header() const
+    { return reinterpret_cast<const Header *>(_M_data); }
+
+    const IconIndex::RootDir *IconIndex::root_dirs() const
+    { return reinterpret_cast<const RootDir *>(_M_data + header()->root_dirs_offset); }
+
+    const IconIndex::Dir *IconIndex::dirs() const
+    { return reinterpret_cast<const Dir *>(_M_data + header()->dirs_offset); }
+
+    const IconIndex::Entry *IconIndex::entries() const
+    { return reinterpret_cast<const Entry *>(_M_data + header()->entries_offset); }
+
+    const char *IconIndex::index_string(uint32_t offset) const
+    { return reinterpret_cast<const char *>(_M_data + header()->strings_offset + offset); }
+
+    //
+    // An IconTheme class.
+    //
+
+    IconTheme::IconTheme() :
+      _M_theme_names({ "Adwaita", "hicolor" }), _M_has_index(false), _M_max_image_count(DEFAULT_MAX_IMAGE_COUNT) {}
+
+    shared_ptr<CanvasImage> IconTheme::image(const string &name, IconSize size)
+    {
+      int pixel_size = icon_pixel_size(size);
+      ImageKey key(name, pixel_size);
+      lock_guard<mutex> guard(_M_mutex);
+      auto iter = _M_images.find(key);
+      if(iter != _M_images.end()) {
+        _M_lru_keys.splice(_M_lru_keys.begin(), _M_lru_keys, iter->second.lru_iter);
+        return iter->second.image;
+      }
+      if(!_M_has_index) load_index();
+      shared_ptr<CanvasImage> image = new_image(name, pixel_size);
+      _M_lru_keys.push_front(key);
+      ImageEntry &entry = _M_images[key];
+      entry.image = image;
+      entry.lru_iter = _M_lru_keys.begin();
+      evict();
+      return image;
+    }
+
+    void IconTheme::set_theme_names(const vector<string> &names)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_theme_names = names;
+      _M_has_index = false;
+      _M_images.clear();
+      _M_lru_keys.clear();
+    }
+
+    void IconTheme::set_max_image_count(size_t count)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_max_image_count = count;
+      evict();
+    }
+
+    void IconTheme::load_index()
+    {
+      vector<string> data_dirs;
+      get_data_dirs(data_dirs);
+      // The themes are followed by their parent themes from the Inherits keys
+      // and by the hicolor theme that is the fallback theme.
+      vector<string> theme_names;
+      for(auto &theme_name : _M_theme_names) add_theme_name(theme_name, data_dirs, 0, theme_names);
+      add_theme_name("hicolor", data_dirs, 0, theme_names);
+      vector<string> root_dirs;
+      for(auto &theme_name : theme_names) {
+        for(auto &data_dir : data_dirs) root_dirs.push_back(data_dir + "/icons/" + theme_name);
+      }
+      for(auto &data_dir : data_dirs) root_dirs.push_back(data_dir + "/pixmaps");
+      string file_name = index_file_name();
+      if(!_M_index.load(file_name, root_dirs)) {
+        _M_index.build(root_dirs);
+        _M_index.save(file_name);
+      }
+      _M_has_index = true;
+    }
+
+    shared_ptr<CanvasImage> IconTheme::new_image(const string &name, int pixel_size)
+    {
+      string file_name;
+      if(_M_index.find(name, pixel_size, file_name)) {
+        try {
+          vector<uint8_t> data;
+          read_file(file_name, data);
+          shared_ptr<CanvasImage> image(new_canvas_image_from_data(data, false));
+          Dimension<int> size = image->size();
+          if(image->is_scalable() && size.width > 0 && size.height > 0 && (size.width != pixel_size || size.height != pixel_size)) {
+            double scale = static_cast<double>(pixel_size) / max(size.width, size.height);
+            image = shared_ptr<CanvasImage>(image->scale(Point<double>(scale, scale)));
+          }
+          return image;
+        } catch(Exception &e) {}
+      }
+      // A missing icon is an empty transparent image.
+      return shared_ptr<CanvasImage>(new_canvas_modifiable_image(pixel_size, pixel_size));
+    }
+
+    void IconTheme::evict()
+    {
+      while(_M_lru_keys.size() > _M_max_image_count) {
+        _M_images.erase(_M_lru_keys.back());
+        _M_lru_keys.pop_back();
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    void get_data_dirs(vector<string> &dir_names)
+    {
+      const char *data_home = getenv("XDG_DATA_HOME");
+      const char *home = getenv("HOME");
+      if(data_home != nullptr && data_home[0] != 0)
+        dir_names.push_back(data_home);
+      else if(home != nullptr)
+        dir_names.push_back(string(home) + "/.local/share");
+      const char *data_dirs = getenv("XDG_DATA_DIRS");
+      split_dirs(data_dirs != nullptr && data_dirs[0] != 0 ? data_dirs : "/usr/local/share:/usr/share", dir_names);
+    }
+
+    string cache_file_name(const string &name)
+    {
+      const char *cache_home = getenv("XDG_CACHE_HOME");
+      const char *home = getenv("HOME");
+      string dir_name;
+      if(cache_home != nullptr && cache_home[0] != 0)
+        dir_name = cache_home;
+      else if(home != nullptr)
+        dir_name = string(home) + "/.cache";
+      else
+        return string();
+      mkdir(dir_name.c_str(), 0700);
+      dir_name += "/waytk";
+      mkdir(dir_name.c_str(), 0700);
+      return dir_name + "/" + name;
+    }
+
+    int icon_pixel_size(IconSize size)
+    {
+      switch(size) {
+        case IconSize::SMALL:
+          return 16;
+        case IconSize::MEDIUM:
+          return 24;
+        case IconSize::LARGE:
+          return 32;
+      }
+      return 24;
+    }
+
+    IconTheme &icon_theme()
+    {
+      static IconTheme theme;
+      return theme;
+    }
+  }
+}
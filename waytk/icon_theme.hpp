@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _ICON_THEME_HPP
+#define _ICON_THEME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <waytk.hpp>
+
+namespace waytk
+{
+  namespace priv
+  {
+    class MappedFile
+    {
+      void *_M_data;
+      std::size_t _M_size;
+    public:
+      MappedFile() :
+        _M_data(nullptr), _M_size(0) {}
+
+      ~MappedFile()
+      { unmap(); }
+
+      bool map(const std::string &file_name);
+
+      void unmap();
+
+      const std::uint8_t *data() const
+      { return reinterpret_cast<const std::uint8_t *>(_M_data); }
+
+      std::size_t size() const
+      { return _M_size; }
+    };
+
+    class IconIndex
+    {
+      struct Header;
+      struct RootDir;
+      struct Dir;
+      struct Entry;
+
+      MappedFile _M_file;
+      std::vector<std::uint8_t> _M_buffer;
+      const std::uint8_t *_M_data;
+      std::size_t _M_size;
+    public:
+      IconIndex() :
+        _M_data(nullptr), _M_size(0) {}
+
+      bool load(const std::string &file_name, const std::vector<std::string> &root_dirs);
+
+      void build(const std::vector<std::string> &root_dirs);
+
+      bool save(const std::string &file_name) const;
+
+      bool find(const std::string &name, int pixel_size, std::string &file_name) const;
+    private:
+      bool check(const std::vector<std::string> &root_dirs) const;
+
+      const Header *header() const;
+
+      const RootDir *root_dirs() const;
+
+      const Dir *dirs() const;
+
+      const Entry *entries() const;
+
+      const char *index_string(std::uint32_t offset) const;
+    };
+
+    class IconTheme
+    {
+      typedef std::pair<std::string, int> ImageKey;
+
+      struct ImageEntry
+      {
+        std::shared_ptr<CanvasImage> image;
+        std::list<ImageKey>::iterator lru_iter;
+      };
+
+      std::mutex _M_mutex;
+      std::vector<std::string> _M_theme_names;
+      IconIndex _M_index;
+      bool _M_has_index;
+      std::map<ImageKey, ImageEntry> _M_images;
+      std::list<ImageKey> _M_lru_keys;
+      std::size_t _M_max_image_count;
+    public:
+      static constexpr std::size_t DEFAULT_MAX_IMAGE_COUNT = 256;
+
+      IconTheme();
+
+      std::shared_ptr<CanvasImage> image(const std::string &name, IconSize size);
+
+      void set_theme_names(const std::vector<std::string> &names);
+
+      void set_max_image_count(std::size_t count);
+    private:
+      void load_index();
+
+      std::shared_ptr<CanvasImage> new_image(const std::string &name, int pixel_size);
+
+      void evict();
+    };
+
+    void get_data_dirs(std::vector<std::string> &dir_names);
+
+    std::string cache_file_name(const std::string &name);
+
+    int icon_pixel_size(IconSize size);
+
+    IconTheme &icon_theme();
+  }
+}
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "image_loader.hpp"
+#include "task_queue.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      struct FileDelete
+      {
+        void operator()(FILE *file) const
+        { fclose(file); }
+      };
+
+      struct PngReadClosure
+      {
+        const uint8_t *data;
+        size_t size;
+        size_t offset;
+      };
+
+      ::cairo_status_t read_png_data(void *closure, unsigned char *data, unsigned length)
+      {
+        PngReadClosure *png_closure = reinterpret_cast<PngReadClosure *>(closure);
+        if(png_closure->size - png_closure->offset < length) return ::CAIRO_STATUS_READ_ERROR;
+        memcpy(data, png_closure->data + png_closure->offset, length);
+        png_closure->offset += length;
+        return ::CAIRO_STATUS_SUCCESS;
+      }
+
+      ::timespec file_mtime(const string &file_name)
+      {
+        struct ::stat stat_buf;
+        if(::stat(file_name.c_str(), &stat_buf) == -1) return ::timespec { 0, 0 };
+        return stat_buf.st_mtim;
+      }
+    }
+
+    //
+    // An ImageLoader class.
+    //
+
+    CanvasImageSharedFuture ImageLoader::load(const string &file_name, const function<void ()> &listener)
+    {
+      ::timespec mtime = file_mtime(file_name);
+      shared_ptr<ImagePromise> promise;
+      CanvasImageSharedFuture image_future;
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(file_name);
+        if(iter != _M_entries.end()) {
+          if(iter->second.promise.get() != nullptr) {
+            // The listener of a pending load is notified by the decoding.
+            if(listener) iter->second.listeners.push_back(listener);
+            _M_lru_file_names.splice(_M_lru_file_names.begin(), _M_lru_file_names, iter->second.lru_iter);
+            return iter->second.image_future;
+          }
+          if(iter->second.mtime.tv_sec == mtime.tv_sec && iter->second.mtime.tv_nsec == mtime.tv_nsec) {
+            _M_lru_file_names.splice(_M_lru_file_names.begin(), _M_lru_file_names, iter->second.lru_iter);
+            return iter->second.image_future;
+          }
+          // The file was modified after it was loaded.
+          _M_byte_count -= iter->second.byte_count;
+          _M_lru_file_names.erase(iter->second.lru_iter);
+          _M_entries.erase(iter);
+        }
+        promise = shared_ptr<ImagePromise>(new ImagePromise());
+        image_future = promise->get_future().share();
+        _M_lru_file_names.push_front(file_name);
+        Entry &entry = _M_entries[file_name];
+        entry.image_future = image_future;
+        entry.promise = promise;
+        if(listener) entry.listeners.push_back(listener);
+        entry.mtime = mtime;
+        entry.byte_count = 0;
+        entry.lru_iter = _M_lru_file_names.begin();
+      }
+      background_task_queue().push([this, file_name, promise]() { decode(file_name, promise); });
+      return image_future;
+    }
+
+    size_t ImageLoader::byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_byte_count;
+    }
+
+    size_t ImageLoader::max_byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_max_byte_count;
+    }
+
+    void ImageLoader::set_max_byte_count(size_t count)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_max_byte_count = count;
+      evict();
+    }
+
+    void ImageLoader::clear()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_entries.clear();
+      _M_lru_file_names.clear();
+      _M_byte_count = 0;
+    }
+
+    void ImageLoader::decode(const string &file_name, const shared_ptr<ImagePromise> &promise)
+    {
+      shared_ptr<CanvasImage> image;
+      size_t byte_count;
+      try {
+        vector<uint8_t> data;
+        read_file(file_name, data);
+        image = shared_ptr<CanvasImage>(new_canvas_image_from_data(data, false));
+        if(image->is_scalable()) {
+          byte_count = data.size();
+        } else {
+          Dimension<int> size = image->size();
+          byte_count = static_cast<size_t>(size.width) * size.height * 4;
+        }
+      } catch(...) {
+        promise->set_exception(current_exception());
+        notify_listeners(file_name, promise, false, 0);
+        return;
+      }
+      promise->set_value(image);
+      notify_listeners(file_name, promise, true, byte_count);
+    }
+
+    void ImageLoader::notify_listeners(const string &file_name, const shared_ptr<ImagePromise> &promise, bool is_loaded, size_t byte_count)
+    {
+      vector<function<void ()>> listeners;
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(file_name);
+        if(iter != _M_entries.end() && iter->second.promise == promise) {
+          listeners.swap(iter->second.listeners);
+          if(is_loaded) {
+            iter->second.promise.reset();
+            iter->second.byte_count = byte_count;
+            _M_byte_count += byte_count;
+            evict();
+          } else {
+            // A failed load isn't cached.
+            _M_lru_file_names.erase(iter->second.lru_iter);
+            _M_entries.erase(iter);
+          }
+        }
+      }
+      for(auto &listener : listeners) listener();
+    }
+
+    void ImageLoader::evict()
+    {
+      auto lru_iter = _M_lru_file_names.end();
+      while(_M_byte_count > _M_max_byte_count && lru_iter != _M_lru_file_names.begin()) {
+        lru_iter--;
+        auto iter = _M_entries.find(*lru_iter);
+        // The pending loads aren't evicted.
+        if(iter->second.promise.get() != nullptr) continue;
+        _M_byte_count -= iter->second.byte_count;
+        _M_entries.erase(iter);
+        lru_iter = _M_lru_file_names.erase(lru_iter);
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    ImageLoader &image_loader()
+    {
+      static ImageLoader loader;
+      return loader;
+    }
+
+    void read_file(const string &file_name, vector<uint8_t> &data)
+    {
+      unique_ptr<FILE, FileDelete> file(fopen(file_name.c_str(), "rb"));
+      if(file.get() == nullptr) {
+        switch(errno) {
+          case ENAMETOOLONG:
+            throw IOException("name too long");
+          case ENOENT:
+            throw IOException("file not found");
+          case ENOMEM:
+            throw IOException("out of memory");
+          default:
+            throw IOException("file error");
+        }
+      }
+      data.clear();
+      uint8_t buffer[16384];
+      size_t count;
+      while((count = fread(buffer, 1, sizeof(buffer), file.get())) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+      if(ferror(file.get())) throw IOException("file error");
+    }
+
+    ImageFileFormat image_file_format(const vector<uint8_t> &data)
+    {
+      static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+      if(data.size() >= sizeof(png_signature) && equal(png_signature, png_signature + sizeof(png_signature), data.begin()))
+        return ImageFileFormat::PNG;
+      // A compressed SVG file.
+      if(data.size() >= 2 && data[0] == 0x1f && data[1] == 0x8b)
+        return ImageFileFormat::SVG;
+      // An uncompressed SVG file is a XML file.
+      size_t i = 0;
+      if(data.size() >= 3 && data[0] == 0xef && data[1] == 0xbb && data[2] == 0xbf) i = 3;
+      for(; i < data.size(); i++) {
+        if(data[i] != ' ' && data[i] != '\t' && data[i] != '\r' && data[i] != '\n') break;
+      }
+      if(i < data.size() && data[i] == '<') return ImageFileFormat::SVG;
+      return ImageFileFormat::UNKNOWN;
+    }
+
+    CanvasImage *new_canvas_image_from_data(const vector<uint8_t> &data, bool is_modifiable)
+    {
+      switch(image_file_format(data)) {
+        case ImageFileFormat::PNG:
+          {
+            PngReadClosure closure { data.data(), data.size(), 0 };
+            CairoSurfaceUniquePtr surface(::cairo_image_surface_create_from_png_stream(read_png_data, &closure));
+            ::cairo_status_t status = ::cairo_surface_status(surface.get());
+            if(status == ::CAIRO_STATUS_NO_MEMORY)
+              throw CanvasException(::cairo_status_to_string(status));
+            else if(status != ::CAIRO_STATUS_SUCCESS)
+              throw FileFormatException("invalid PNG image file");
+            if(is_modifiable)
+              return new ImplCanvasModifiableImage(surface);
+            else
+              return new ImplCanvasUnmodifiableImage(surface);
+          }
+        case ImageFileFormat::SVG:
+          {
+            RsvgHandleUniquePtr handle(new_svg_handle(data.data(), data.size()));
+            return new ImplCanvasScalableImage(handle);
+          }
+        default:
+          throw FileFormatException("unsupported image file format");
+      }
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _IMAGE_LOADER_HPP
+#define _IMAGE_LOADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "canvas.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    enum class ImageFileFormat
+    {
+      UNKNOWN,
+      PNG,
+      SVG
+    };
+
+    typedef std::shared_future<std::shared_ptr<CanvasImage>> CanvasImageSharedFuture;
+
+    class ImageLoader
+    {
+      typedef std::promise<std::shared_ptr<CanvasImage>> ImagePromise;
+
+      struct Entry
+      {
+        CanvasImageSharedFuture image_future;
+        std::shared_ptr<ImagePromise> promise;
+        std::vector<std::function<void ()>> listeners;
+        ::timespec mtime;
+        std::size_t byte_count;
+        std::list<std::string>::iterator lru_iter;
+      };
+
+      std::mutex _M_mutex;
+      std::unordered_map<std::string, Entry> _M_entries;
+      std::list<std::string> _M_lru_file_names;
+      std::size_t _M_byte_count;
+      std::size_t _M_max_byte_count;
+    public:
+      static constexpr std::size_t DEFAULT_MAX_BYTE_COUNT = 64 * 1024 * 1024;
+
+      ImageLoader() :
+        _M_byte_count(0), _M_max_byte_count(DEFAULT_MAX_BYTE_COUNT) {}
+
+      CanvasImageSharedFuture load(const std::string &file_name)
+      { return load(file_name, std::function<void ()>()); }
+
+      CanvasImageSharedFuture load(const std::string &file_name, const std::function<void ()> &listener);
+
+      std::size_t byte_count();
+
+      std::size_t max_byte_count();
+
+      void set_max_byte_count(std::size_t count);
+
+      void clear();
+    private:
+      void decode(const std::string &file_name, const std::shared_ptr<ImagePromise> &promise);
+
+      void notify_listeners(const std::string &file_name, const std::shared_ptr<ImagePromise> &promise, bool is_loaded, std::size_t byte_count);
+
+      void evict();
+    };
+
+    ImageLoader &image_loader();
+
+    void read_file(const std::string &file_name, std::vector<std::uint8_t> &data);
+
+    ImageFileFormat image_file_format(const std::vector<std::uint8_t> &data);
+
+    CanvasImage *new_canvas_image_from_data(const std::vector<std::uint8_t> &data, bool is_modifiable);
+  }
+}
+
+#endif
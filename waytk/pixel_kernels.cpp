@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#include "pixel_kernels.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      // The kernels operate on premultiplied ARGB32 pixels and round like
+      // pixman so that their results are the same as the cairo results.
+
+      inline uint32_t mul_un8(uint32_t x, uint32_t a)
+      {
+        uint32_t t = x * a + 0x80;
+        return ((t >> 8) + t) >> 8;
+      }
+
+      inline uint32_t alpha_of(uint32_t pixel)
+      { return pixel >> 24; }
+
+      inline uint32_t component(uint32_t pixel, int shift)
+      { return (pixel >> shift) & 0xff; }
+
+      inline uint32_t premultiply_pixel(uint32_t pixel)
+      {
+        uint32_t a = alpha_of(pixel);
+        return (a << 24) |
+          (mul_un8(component(pixel, 16), a) << 16) |
+          (mul_un8(component(pixel, 8), a) << 8) |
+          mul_un8(component(pixel, 0), a);
+      }
+
+      inline uint32_t unpremultiply_component(uint32_t c, uint32_t a)
+      { return min<uint32_t>((c * 255 + a / 2) / a, 255); }
+
+      inline uint32_t unpremultiply_pixel(uint32_t pixel)
+      {
+        uint32_t a = alpha_of(pixel);
+        if(a == 0) return 0;
+        if(a == 255) return pixel;
+        return (a << 24) |
+          (unpremultiply_component(component(pixel, 16), a) << 16) |
+          (unpremultiply_component(component(pixel, 8), a) << 8) |
+          unpremultiply_component(component(pixel, 0), a);
+      }
+
+      inline uint32_t blend_pixel_over(uint32_t dst, uint32_t src)
+      {
+        uint32_t ia = 255 - alpha_of(src);
+        uint32_t result = 0;
+        for(int shift = 0; shift < 32; shift += 8) {
+          uint32_t c = component(src, shift) + mul_un8(component(dst, shift), ia);
+          result |= min<uint32_t>(c, 255) << shift;
+        }
+        return result;
+      }
+
+      inline uint32_t tint_pixel(uint32_t pixel, uint32_t color)
+      {
+        uint32_t a = alpha_of(pixel);
+        return (mul_un8(component(color, 24), a) << 24) |
+          (mul_un8(component(color, 16), a) << 16) |
+          (mul_un8(component(color, 8), a) << 8) |
+          mul_un8(component(color, 0), a);
+      }
+
+#if defined(__SSE2__)
+      inline __m128i sse2_alphas(__m128i pixels)
+      {
+        __m128i alphas = _mm_srli_epi32(pixels, 24);
+        alphas = _mm_or_si128(alphas, _mm_slli_epi32(alphas, 8));
+        return _mm_or_si128(alphas, _mm_slli_epi32(alphas, 16));
+      }
+
+      inline __m128i sse2_mul_un8_epi16(__m128i x, __m128i a)
+      {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(0x80));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+      }
+
+      inline __m128i sse2_mul_un8(__m128i x, __m128i a)
+      {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = sse2_mul_un8_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(a, zero));
+        __m128i hi = sse2_mul_un8_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(a, zero));
+        return _mm_packus_epi16(lo, hi);
+      }
+
+      inline void sse2_transpose_a8_8x8(uint8_t *dst_data, int dst_stride, const uint8_t *src_data, int src_stride)
+      {
+        // The rows are interleaved by bytes, words and double words, so each
+        // half of the results is a column.
+        __m128i rows[8];
+        for(int i = 0; i < 8; i++) rows[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_data + i * src_stride));
+        __m128i a0 = _mm_unpacklo_epi8(rows[0], rows[1]);
+        __m128i a1 = _mm_unpacklo_epi8(rows[2], rows[3]);
+        __m128i a2 = _mm_unpacklo_epi8(rows[4], rows[5]);
+        __m128i a3 = _mm_unpacklo_epi8(rows[6], rows[7]);
+        __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+        __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+        __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+        __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+        __m128i columns[4] = {
+          _mm_unpacklo_epi32(b0, b2),
+          _mm_unpackhi_epi32(b0, b2),
+          _mm_unpacklo_epi32(b1, b3),
+          _mm_unpackhi_epi32(b1, b3)
+        };
+        for(int i = 0; i < 4; i++) {
+          _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_data + (i * 2) * dst_stride), columns[i]);
+          _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_data + (i * 2 + 1) * dst_stride), _mm_unpackhi_epi64(columns[i], columns[i]));
+        }
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      inline uint8x8_t neon_mul_un8(uint8x8_t x, uint8x8_t a)
+      {
+        uint16x8_t t = vmull_u8(x, a);
+        return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+      }
+
+      inline void neon_transpose_a8_8x8(uint8_t *dst_data, int dst_stride, const uint8_t *src_data, int src_stride)
+      {
+        // The rows are transposed in pairs of bytes, words and double words.
+        uint8x8_t rows[8];
+        for(int i = 0; i < 8; i++) rows[i] = vld1_u8(src_data + i * src_stride);
+        uint8x8x2_t a01 = vtrn_u8(rows[0], rows[1]);
+        uint8x8x2_t a23 = vtrn_u8(rows[2], rows[3]);
+        uint8x8x2_t a45 = vtrn_u8(rows[4], rows[5]);
+        uint8x8x2_t a67 = vtrn_u8(rows[6], rows[7]);
+        uint16x4x2_t b02 = vtrn_u16(vreinterpret_u16_u8(a01.val[0]), vreinterpret_u16_u8(a23.val[0]));
+        uint16x4x2_t b13 = vtrn_u16(vreinterpret_u16_u8(a01.val[1]), vreinterpret_u16_u8(a23.val[1]));
+        uint16x4x2_t b46 = vtrn_u16(vreinterpret_u16_u8(a45.val[0]), vreinterpret_u16_u8(a67.val[0]));
+        uint16x4x2_t b57 = vtrn_u16(vreinterpret_u16_u8(a45.val[1]), vreinterpret_u16_u8(a67.val[1]));
+        uint32x2x2_t c0 = vtrn_u32(vreinterpret_u32_u16(b02.val[0]), vreinterpret_u32_u16(b46.val[0]));
+        uint32x2x2_t c1 = vtrn_u32(vreinterpret_u32_u16(b13.val[0]), vreinterpret_u32_u16(b57.val[0]));
+        uint32x2x2_t c2 = vtrn_u32(vreinterpret_u32_u16(b02.val[1]), vreinterpret_u32_u16(b46.val[1]));
+        uint32x2x2_t c3 = vtrn_u32(vreinterpret_u32_u16(b13.val[1]), vreinterpret_u32_u16(b57.val[1]));
+        uint8x8_t columns[8] = {
+          vreinterpret_u8_u32(c0.val[0]), vreinterpret_u8_u32(c1.val[0]),
+          vreinterpret_u8_u32(c2.val[0]), vreinterpret_u8_u32(c3.val[0]),
+          vreinterpret_u8_u32(c0.val[1]), vreinterpret_u8_u32(c1.val[1]),
+          vreinterpret_u8_u32(c2.val[1]), vreinterpret_u8_u32(c3.val[1])
+        };
+        for(int i = 0; i < 8; i++) vst1_u8(dst_data + i * dst_stride, columns[i]);
+      }
+#endif
+    }
+
+    //
+    // Functions.
+    //
+
+    void premultiply_pixels(uint32_t *pixels, size_t count)
+    {
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+      for(; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<__m128i *>(pixels + i));
+        __m128i a = _mm_or_si128(sse2_alphas(p), alpha_mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), sse2_mul_un8(p, a));
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      for(; i + 8 <= count; i += 8) {
+        uint8x8x4_t p = vld4_u8(reinterpret_cast<uint8_t *>(pixels + i));
+        p.val[0] = neon_mul_un8(p.val[0], p.val[3]);
+        p.val[1] = neon_mul_un8(p.val[1], p.val[3]);
+        p.val[2] = neon_mul_un8(p.val[2], p.val[3]);
+        vst4_u8(reinterpret_cast<uint8_t *>(pixels + i), p);
+      }
+#endif
+      for(; i < count; i++) pixels[i] = premultiply_pixel(pixels[i]);
+    }
+
+    void unpremultiply_pixels(uint32_t *pixels, size_t count)
+    {
+      // SSE2 and NEON don't have an integer division, thus this kernel is
+      // scalar.
+      for(size_t i = 0; i < count; i++) pixels[i] = unpremultiply_pixel(pixels[i]);
+    }
+
+    void fill_pixels(uint32_t *pixels, size_t count, uint32_t pixel)
+    {
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128i p = _mm_set1_epi32(static_cast<int>(pixel));
+      for(; i + 4 <= count; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), p);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      uint32x4_t p = vdupq_n_u32(pixel);
+      for(; i + 4 <= count; i += 4) vst1q_u32(pixels + i, p);
+#endif
+      for(; i < count; i++) pixels[i] = pixel;
+    }
+
+    void blend_pixels_over(uint32_t *dst_pixels, const uint32_t *src_pixels, size_t count)
+    {
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128i ones = _mm_set1_epi32(-1);
+      for(; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src_pixels + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i *>(dst_pixels + i));
+        __m128i ia = _mm_xor_si128(sse2_alphas(s), ones);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst_pixels + i), _mm_adds_epu8(s, sse2_mul_un8(d, ia)));
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      for(; i + 8 <= count; i += 8) {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t *>(src_pixels + i));
+        uint8x8x4_t d = vld4_u8(reinterpret_cast<uint8_t *>(dst_pixels + i));
+        uint8x8_t ia = vmvn_u8(s.val[3]);
+        for(int j = 0; j < 4; j++)
+          d.val[j] = vqadd_u8(s.val[j], neon_mul_un8(d.val[j], ia));
+        vst4_u8(reinterpret_cast<uint8_t *>(dst_pixels + i), d);
+      }
+#endif
+      for(; i < count; i++) dst_pixels[i] = blend_pixel_over(dst_pixels[i], src_pixels[i]);
+    }
+
+    void tint_pixels(uint32_t *pixels, size_t count, uint32_t pixel)
+    {
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128i c = _mm_set1_epi32(static_cast<int>(pixel));
+      for(; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<__m128i *>(pixels + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), sse2_mul_un8(c, sse2_alphas(p)));
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      uint8x8x4_t c;
+      for(int j = 0; j < 4; j++) c.val[j] = vdup_n_u8((pixel >> (j * 8)) & 0xff);
+      for(; i + 8 <= count; i += 8) {
+        uint8x8x4_t p = vld4_u8(reinterpret_cast<uint8_t *>(pixels + i));
+        uint8x8_t a = p.val[3];
+        for(int j = 0; j < 4; j++) p.val[j] = neon_mul_un8(c.val[j], a);
+        vst4_u8(reinterpret_cast<uint8_t *>(pixels + i), p);
+      }
+#endif
+      for(; i < count; i++) pixels[i] = tint_pixel(pixels[i], pixel);
+    }
+
+    void downscale_pixels_box(uint32_t *dst_pixels, const uint32_t *src_pixels, int src_stride, int src_width, int src_height, int factor)
+    {
+      // The blocks at the right edge and at the bottom edge can have fewer
+      // pixels, so they are averaged from their pixels only.
+      int block_height = min(src_height, factor);
+      const uint8_t *src_row = reinterpret_cast<const uint8_t *>(src_pixels);
+      for(int x1 = 0, x = 0; x1 < src_width; x1 += factor, x++) {
+        int block_width = min(src_width - x1, factor);
+        uint32_t n = block_width * block_height;
+        uint32_t sums[4] = { n / 2, n / 2, n / 2, n / 2 };
+        for(int y = 0; y < block_height; y++) {
+          const uint32_t *src = reinterpret_cast<const uint32_t *>(src_row + y * src_stride) + x1;
+          for(int i = 0; i < block_width; i++) {
+            sums[0] += src[i] & 0xff;
+            sums[1] += (src[i] >> 8) & 0xff;
+            sums[2] += (src[i] >> 16) & 0xff;
+            sums[3] += src[i] >> 24;
+          }
+        }
+        dst_pixels[x] = ((sums[3] / n) << 24) | ((sums[2] / n) << 16) | ((sums[1] / n) << 8) | (sums[0] / n);
+      }
+    }
+
+    void colorize_a8_pixels(uint32_t *dst_pixels, const uint8_t *src_alphas, size_t count, uint32_t pixel)
+    {
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128i c = _mm_set1_epi32(static_cast<int>(pixel));
+      __m128i zero = _mm_setzero_si128();
+      for(; i + 4 <= count; i += 4) {
+        int32_t tmp_alphas;
+        copy(src_alphas + i, src_alphas + i + 4, reinterpret_cast<uint8_t *>(&tmp_alphas));
+        __m128i a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(tmp_alphas), zero), zero);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst_pixels + i), sse2_mul_un8(c, a));
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      uint8x8x4_t c;
+      for(int j = 0; j < 4; j++) c.val[j] = vdup_n_u8((pixel >> (j * 8)) & 0xff);
+      for(; i + 8 <= count; i += 8) {
+        uint8x8_t a = vld1_u8(src_alphas + i);
+        uint8x8x4_t p;
+        for(int j = 0; j < 4; j++) p.val[j] = neon_mul_un8(c.val[j], a);
+        vst4_u8(reinterpret_cast<uint8_t *>(dst_pixels + i), p);
+      }
+#endif
+      for(; i < count; i++) dst_pixels[i] = tint_pixel(static_cast<uint32_t>(src_alphas[i]) << 24, pixel);
+    }
+
+    void box_blur_a8_columns(uint8_t *dst_data, int dst_stride, const uint8_t *src_data, int src_stride, int width, int height, int radius)
+    {
+      // The pixels outside the image are transparent. The window sum is
+      // divided by the multiplication by a 16-bit reciprocal, so the radius
+      // is at most 127.
+      uint32_t inv = (65536 + 2 * radius) / (2 * radius + 1);
+      int x = 0;
+#if defined(__SSE2__)
+      __m128i zero = _mm_setzero_si128();
+      __m128i inv_vec = _mm_set1_epi16(static_cast<short>(inv));
+      for(; x + 8 <= width; x += 8) {
+        __m128i sum = zero;
+        for(int y = 0; y < radius && y < height; y++)
+          sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_data + y * src_stride + x)), zero));
+        for(int y = 0; y < height; y++) {
+          if(y + radius < height)
+            sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_data + (y + radius) * src_stride + x)), zero));
+          __m128i result = _mm_mulhi_epu16(sum, inv_vec);
+          _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_data + y * dst_stride + x), _mm_packus_epi16(result, zero));
+          if(y - radius >= 0)
+            sum = _mm_sub_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_data + (y - radius) * src_stride + x)), zero));
+        }
+      }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      uint16x4_t inv_vec = vdup_n_u16(static_cast<uint16_t>(inv));
+      for(; x + 8 <= width; x += 8) {
+        uint16x8_t sum = vdupq_n_u16(0);
+        for(int y = 0; y < radius && y < height; y++)
+          sum = vaddw_u8(sum, vld1_u8(src_data + y * src_stride + x));
+        for(int y = 0; y < height; y++) {
+          if(y + radius < height) sum = vaddw_u8(sum, vld1_u8(src_data + (y + radius) * src_stride + x));
+          uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(sum), inv_vec), 16);
+          uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(sum), inv_vec), 16);
+          vst1_u8(dst_data + y * dst_stride + x, vmovn_u16(vcombine_u16(lo, hi)));
+          if(y - radius >= 0) sum = vsubw_u8(sum, vld1_u8(src_data + (y - radius) * src_stride + x));
+        }
+      }
+#endif
+      for(; x < width; x++) {
+        uint32_t sum = 0;
+        for(int y = 0; y < radius && y < height; y++) sum += src_data[y * src_stride + x];
+        for(int y = 0; y < height; y++) {
+          if(y + radius < height) sum += src_data[(y + radius) * src_stride + x];
+          dst_data[y * dst_stride + x] = (sum * inv) >> 16;
+          if(y - radius >= 0) sum -= src_data[(y - radius) * src_stride + x];
+        }
+      }
+    }
+
+    void transpose_a8(uint8_t *dst_data, int dst_stride, const uint8_t *src_data, int src_stride, int width, int height)
+    {
+      // The image is transposed in blocks to keep the both images in the
+      // cache. The blocks are transposed in 8x8 tiles of vectors.
+      const int block_size = 32;
+      for(int y1 = 0; y1 < height; y1 += block_size) {
+        for(int x1 = 0; x1 < width; x1 += block_size) {
+          int y2 = min(y1 + block_size, height), x2 = min(x1 + block_size, width);
+          int y = y1;
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+          for(; y + 8 <= y2; y += 8) {
+            int x = x1;
+            for(; x + 8 <= x2; x += 8) {
+#if defined(__SSE2__)
+              sse2_transpose_a8_8x8(dst_data + x * dst_stride + y, dst_stride, src_data + y * src_stride + x, src_stride);
+#else
+              neon_transpose_a8_8x8(dst_data + x * dst_stride + y, dst_stride, src_data + y * src_stride + x, src_stride);
+#endif
+            }
+            for(; x < x2; x++) {
+              for(int i = y; i < y + 8; i++) dst_data[x * dst_stride + i] = src_data[i * src_stride + x];
+            }
+          }
+#endif
+          for(; y < y2; y++) {
+            for(int x = x1; x < x2; x++) dst_data[x * dst_stride + y] = src_data[y * src_stride + x];
+          }
+        }
+      }
+    }
+
+    void blur_a8(uint8_t *data, int stride, int width, int height, int radius)
+    {
+      // Three box blurs approximate a Gaussian blur. The rows are blurred as
+      // the columns of the transposed image, so both passes use the vector
+      // column kernel.
+      radius = min(radius, 127);
+      if(radius <= 0 || width <= 0 || height <= 0) return;
+      vector<uint8_t> tmp1(static_cast<size_t>(width) * height);
+      vector<uint8_t> tmp2(static_cast<size_t>(width) * height);
+      box_blur_a8_columns(tmp1.data(), width, data, stride, width, height, radius);
+      box_blur_a8_columns(tmp2.data(), width, tmp1.data(), width, width, height, radius);
+      box_blur_a8_columns(tmp1.data(), width, tmp2.data(), width, width, height, radius);
+      transpose_a8(tmp2.data(), height, tmp1.data(), width, width, height);
+      box_blur_a8_columns(tmp1.data(), height, tmp2.data(), height, height, width, radius);
+      box_blur_a8_columns(tmp2.data(), height, tmp1.data(), height, height, width, radius);
+      box_blur_a8_columns(tmp1.data(), height, tmp2.data(), height, height, width, radius);
+      transpose_a8(data, stride, tmp1.data(), height, height, width);
+    }
+
+    uint32_t premultiplied_pixel(uint32_t color)
+    { return premultiply_pixel(color); }
+  }
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _PIXEL_KERNELS_HPP
+#define _PIXEL_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace waytk
+{
+  namespace priv
+  {
+    void premultiply_pixels(std::uint32_t *pixels, std::size_t count);
+
+    void unpremultiply_pixels(std::uint32_t *pixels, std::size_t count);
+
+    void fill_pixels(std::uint32_t *pixels, std::size_t count, std::uint32_t pixel);
+
+    void blend_pixels_over(std::uint32_t *dst_pixels, const std::uint32_t *src_pixels, std::size_t count);
+
+    void tint_pixels(std::uint32_t *pixels, std::size_t count, std::uint32_t pixel);
+
+    void downscale_pixels_box(std::uint32_t *dst_pixels, const std::uint32_t *src_pixels, int src_stride, int src_width, int src_height, int factor);
+
+    void colorize_a8_pixels(std::uint32_t *dst_pixels, const std::uint8_t *src_alphas, std::size_t count, std::uint32_t pixel);
+
+    void box_blur_a8_columns(std::uint8_t *dst_data, int dst_stride, const std::uint8_t *src_data, int src_stride, int width, int height, int radius);
+
+    void transpose_a8(std::uint8_t *dst_data, int dst_stride, const std::uint8_t *src_data, int src_stride, int width, int height);
+
+    void blur_a8(std::uint8_t *data, int stride, int width, int height, int radius);
+
+    std::uint32_t premultiplied_pixel(std::uint32_t color);
+  }
+}
+
+#endif
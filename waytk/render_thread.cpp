@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include "render_thread.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    //
+    // A WorkerPool class.
+    //
+
+    WorkerPool::WorkerPool(unsigned thread_count) :
+      _M_task(nullptr), _M_task_count(0), _M_next_task_index(0), _M_done_task_count(0), _M_is_stopped(false)
+    {
+      for(unsigned i = 1; i < thread_count; i++)
+        _M_threads.push_back(thread([this]() { run_worker(); }));
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        _M_is_stopped = true;
+      }
+      _M_condition.notify_all();
+      for(auto &thread : _M_threads) thread.join();
+    }
+
+    void WorkerPool::run(size_t task_count, const function<void (size_t)> &task)
+    {
+      if(task_count == 0) return;
+      unique_lock<mutex> lock(_M_mutex);
+      _M_task = &task;
+      _M_task_count = task_count;
+      _M_next_task_index = 0;
+      _M_done_task_count = 0;
+      _M_exception = exception_ptr();
+      _M_condition.notify_all();
+      // The calling thread also runs the tasks.
+      while(run_next_task(lock));
+      _M_done_condition.wait(lock, [this]() { return _M_done_task_count >= _M_task_count; });
+      _M_task = nullptr;
+      if(_M_exception) {
+        exception_ptr tmp_exception = _M_exception;
+        _M_exception = exception_ptr();
+        rethrow_exception(tmp_exception);
+      }
+    }
+
+    void WorkerPool::run_worker()
+    {
+      unique_lock<mutex> lock(_M_mutex);
+      while(true) {
+        _M_condition.wait(lock, [this]() { return _M_is_stopped || (_M_task != nullptr && _M_next_task_index < _M_task_count); });
+        if(_M_is_stopped) break;
+        while(run_next_task(lock));
+      }
+    }
+
+    bool WorkerPool::run_next_task(unique_lock<mutex> &lock)
+    {
+      if(_M_task == nullptr || _M_next_task_index >= _M_task_count) return false;
+      const function<void (size_t)> *task = _M_task;
+      size_t task_index = _M_next_task_index++;
+      lock.unlock();
+      exception_ptr tmp_exception;
+      try {
+        (*task)(task_index);
+      } catch(...) {
+        tmp_exception = current_exception();
+      }
+      lock.lock();
+      if(tmp_exception && !_M_exception) _M_exception = tmp_exception;
+      _M_done_task_count++;
+      if(_M_done_task_count >= _M_task_count) _M_done_condition.notify_all();
+      return true;
+    }
+
+    //
+    // A RenderThread class.
+    //
+
+    constexpr int RenderThread::TILE_SIZE;
+
+    RenderThread::RenderThread(const OnFrameRenderListener &listener, unsigned raster_thread_count) :
+      _M_on_frame_render_listener(listener), _M_is_stopped(false)
+    {
+      if(raster_thread_count > 1) _M_worker_pool = unique_ptr<WorkerPool>(new WorkerPool(raster_thread_count));
+      _M_thread = thread([this]() { run(); });
+    }
+
+    RenderThread::~RenderThread()
+    { stop(); }
+
+    bool RenderThread::publish_frame(Surface *surface)
+    {
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        if(_M_exception) {
+          exception_ptr tmp_exception = _M_exception;
+          _M_exception = exception_ptr();
+          rethrow_exception(tmp_exception);
+        }
+      }
+      if(!surface->is_damaged()) return false;
+      Frame &frame = _M_frames.back();
+      RecordingCanvas canvas;
+      surface->draw(&canvas);
+      frame.display_list = canvas.display_list();
+      frame.size = surface->size();
+      frame.damaged_rects = surface->damaged_rects();
+      surface->clear_damage();
+      if(_M_frames.has_new_front()) {
+        // The render thread can skip the previous frame, so its damaged region
+        // is also redrawn by this frame.
+        frame.damaged_rects.insert(frame.damaged_rects.end(), _M_published_damaged_rects.begin(), _M_published_damaged_rects.end());
+      }
+      _M_published_damaged_rects = frame.damaged_rects;
+      if(_M_frames.publish()) _M_frames.back().display_list.reset();
+      {
+        // The mutex is only locked to avoid a lost wakeup of the render thread.
+        lock_guard<mutex> guard(_M_mutex);
+      }
+      _M_condition.notify_one();
+      return true;
+    }
+
+    void RenderThread::stop()
+    {
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        _M_is_stopped = true;
+      }
+      _M_condition.notify_one();
+      if(_M_thread.joinable()) _M_thread.join();
+    }
+
+    void RenderThread::run()
+    {
+      unique_lock<mutex> lock(_M_mutex);
+      while(true) {
+        _M_condition.wait(lock, [this]() { return _M_is_stopped || _M_frames.has_new_front(); });
+        if(_M_is_stopped) break;
+        lock.unlock();
+        exception_ptr tmp_exception;
+        try {
+          if(_M_frames.update_front()) render_frame(_M_frames.front());
+        } catch(...) {
+          tmp_exception = current_exception();
+        }
+        lock.lock();
+        if(tmp_exception) _M_exception = tmp_exception;
+      }
+    }
+
+    void RenderThread::render_frame(Frame &frame)
+    {
+      if(frame.size.width <= 0 || frame.size.height <= 0) return;
+      if(_M_buffer.get() == nullptr || _M_buffer->size() != frame.size)
+        _M_buffer = unique_ptr<CanvasModifiableImage>(new_canvas_modifiable_image(frame.size));
+      if(_M_worker_pool.get() != nullptr) {
+        render_frame_tiles(frame);
+      } else {
+        unique_ptr<Canvas> canvas(_M_buffer->canvas());
+        frame.display_list->replay(canvas.get());
+      }
+      if(_M_on_frame_render_listener)
+        _M_on_frame_render_listener(_M_buffer.get(), frame.damaged_rects);
+    }
+
+    void RenderThread::render_frame_tiles(Frame &frame)
+    {
+      _M_tile_rects.clear();
+      for(int y = 0; y < frame.size.height; y += TILE_SIZE) {
+        for(int x = 0; x < frame.size.width; x += TILE_SIZE) {
+          Rectangle<int> tile_rect(x, y, min(TILE_SIZE, frame.size.width - x), min(TILE_SIZE, frame.size.height - y));
+          bool is_damaged = any_of(frame.damaged_rects.begin(), frame.damaged_rects.end(), [&tile_rect](const Rectangle<int> &rect) {
+            Rectangle<int> tmp_rect;
+            return tile_rect.intersect(rect, tmp_rect);
+          });
+          if(is_damaged) _M_tile_rects.push_back(tile_rect);
+        }
+      }
+      if(_M_tile_images.size() < _M_tile_rects.size()) _M_tile_images.resize(_M_tile_rects.size());
+      // Each tile is drawn to an own image, so the workers never share a cairo
+      // surface.
+      _M_worker_pool->run(_M_tile_rects.size(), [this, &frame](size_t i) {
+        if(_M_tile_images[i].get() == nullptr)
+          _M_tile_images[i] = unique_ptr<CanvasModifiableImage>(new_canvas_modifiable_image(TILE_SIZE, TILE_SIZE));
+        Rectangle<double> tile_rect(_M_tile_rects[i].x, _M_tile_rects[i].y, _M_tile_rects[i].width, _M_tile_rects[i].height);
+        unique_ptr<Canvas> canvas(_M_tile_images[i]->canvas());
+        canvas->set_op(Operator::CLEAR);
+        canvas->paint();
+        canvas->set_op(Operator::OVER);
+        canvas->rect(0.0, 0.0, tile_rect.width, tile_rect.height);
+        canvas->clip();
+        canvas->new_path();
+        frame.display_list->replay(canvas.get(), Point<double>(-tile_rect.x, -tile_rect.y), Rectangle<double>(0.0, 0.0, tile_rect.width, tile_rect.height));
+      });
+      // The tile images are composited to the buffer in the damaged region
+      // because the display list only draws in this region.
+      unique_ptr<Canvas> canvas(_M_buffer->canvas());
+      for(auto &rect : frame.damaged_rects) canvas->rect(rect.x, rect.y, rect.width, rect.height);
+      canvas->clip();
+      canvas->new_path();
+      canvas->set_op(Operator::SOURCE);
+      for(size_t i = 0; i < _M_tile_rects.size(); i++) {
+        Rectangle<int> &tile_rect = _M_tile_rects[i];
+        canvas->save();
+        canvas->rect(tile_rect.x, tile_rect.y, tile_rect.width, tile_rect.height);
+        canvas->clip();
+        canvas->new_path();
+        canvas->set_image(_M_tile_images[i].get(), tile_rect.x, tile_rect.y);
+        canvas->paint();
+        canvas->restore();
+      }
+    }
+  }
+}
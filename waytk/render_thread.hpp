@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _RENDER_THREAD_HPP
+#define _RENDER_THREAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <waytk.hpp>
+#include "display_list.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    struct Frame
+    {
+      std::shared_ptr<const DisplayList> display_list;
+      Dimension<int> size;
+      std::vector<Rectangle<int>> damaged_rects;
+
+      Frame() :
+        size(0, 0) {}
+    };
+
+    template<typename _T>
+    class TripleBuffer
+    {
+      static constexpr unsigned INDEX_MASK = 3;
+      static constexpr unsigned NEW_FLAG = 4;
+
+      _T _M_buffers[3];
+      unsigned _M_back_index;
+      std::atomic<unsigned> _M_middle_state;
+      unsigned _M_front_index;
+    public:
+      TripleBuffer() :
+        _M_back_index(0), _M_middle_state(1), _M_front_index(2) {}
+
+      _T &back()
+      { return _M_buffers[_M_back_index]; }
+
+      // Swaps the back buffer with the middle buffer and returns true if the
+      // previous middle buffer wasn't consumed. The back buffer then contains
+      // this unconsumed value.
+      bool publish()
+      {
+        unsigned state = _M_middle_state.exchange(_M_back_index | NEW_FLAG, std::memory_order_acq_rel);
+        _M_back_index = state & INDEX_MASK;
+        return (state & NEW_FLAG) != 0;
+      }
+
+      bool has_new_front() const
+      { return (_M_middle_state.load(std::memory_order_acquire) & NEW_FLAG) != 0; }
+
+      // Swaps the front buffer with the middle buffer if the middle buffer is
+      // new.
+      bool update_front()
+      {
+        if(!has_new_front()) return false;
+        unsigned state = _M_middle_state.exchange(_M_front_index, std::memory_order_acq_rel);
+        _M_front_index = state & INDEX_MASK;
+        return true;
+      }
+
+      _T &front()
+      { return _M_buffers[_M_front_index]; }
+    };
+
+    class WorkerPool
+    {
+      std::vector<std::thread> _M_threads;
+      std::mutex _M_mutex;
+      std::condition_variable _M_condition;
+      std::condition_variable _M_done_condition;
+      const std::function<void (std::size_t)> *_M_task;
+      std::size_t _M_task_count;
+      std::size_t _M_next_task_index;
+      std::size_t _M_done_task_count;
+      std::exception_ptr _M_exception;
+      bool _M_is_stopped;
+    public:
+      explicit WorkerPool(unsigned thread_count);
+
+      ~WorkerPool();
+
+      std::size_t thread_count() const
+      { return _M_threads.size() + 1; }
+
+      void run(std::size_t task_count, const std::function<void (std::size_t)> &task);
+    private:
+      void run_worker();
+
+      bool run_next_task(std::unique_lock<std::mutex> &lock);
+    };
+
+    typedef std::function<void (CanvasModifiableImage *buffer, const std::vector<Rectangle<int>> &damaged_rects)> OnFrameRenderListener;
+
+    class RenderThread
+    {
+      TripleBuffer<Frame> _M_frames;
+      std::unique_ptr<CanvasModifiableImage> _M_buffer;
+      std::unique_ptr<WorkerPool> _M_worker_pool;
+      std::vector<Rectangle<int>> _M_tile_rects;
+      std::vector<std::unique_ptr<CanvasModifiableImage>> _M_tile_images;
+      std::vector<Rectangle<int>> _M_published_damaged_rects;
+      OnFrameRenderListener _M_on_frame_render_listener;
+      std::mutex _M_mutex;
+      std::condition_variable _M_condition;
+      bool _M_is_stopped;
+      std::exception_ptr _M_exception;
+      std::thread _M_thread;
+    public:
+      static constexpr int TILE_SIZE = 256;
+
+      explicit RenderThread(const OnFrameRenderListener &listener, unsigned raster_thread_count = 1);
+
+      ~RenderThread();
+
+      bool publish_frame(Surface *surface);
+
+      void stop();
+
+      void render_frame(Frame &frame);
+    private:
+      void run();
+
+      void render_frame_tiles(Frame &frame);
+    };
+  }
+}
+
+#endif
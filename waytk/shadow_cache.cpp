@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include "pixel_kernels.hpp"
+#include "shadow_cache.hpp"
+#include "styles.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      ::cairo_surface_t *new_shadow_mask_surface(const Dimension<int> &size, int blur_radius, const Corners<double> &radiuses)
+      {
+        int margin = shadow_margin(blur_radius);
+        int width = size.width + margin * 2, height = size.height + margin * 2;
+        CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_A8, width, height));
+        throw_canvas_exception_for_failure(surface.get());
+        {
+          CairoUniquePtr context(::cairo_create(surface.get()));
+          throw_canvas_exception_for_failure(::cairo_status(context.get()));
+          ImplCanvas canvas(context);
+          rounded_rect_path(&canvas, Rectangle<double>(margin, margin, size.width, size.height), radiuses, false);
+          canvas.set_color(Color(0xff000000));
+          canvas.fill();
+        }
+        ::cairo_surface_flush(surface.get());
+        uint8_t *data = ::cairo_image_surface_get_data(surface.get());
+        int stride = ::cairo_image_surface_get_stride(surface.get());
+        blur_a8(data, stride, width, height, shadow_box_blur_radius(blur_radius));
+        ::cairo_surface_mark_dirty(surface.get());
+        return surface.release();
+      }
+
+      ::cairo_surface_t *new_shadow_surface(::cairo_surface_t *mask_surface, Color color)
+      {
+        int width = ::cairo_image_surface_get_width(mask_surface);
+        int height = ::cairo_image_surface_get_height(mask_surface);
+        CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, width, height));
+        throw_canvas_exception_for_failure(surface.get());
+        const uint8_t *src_data = ::cairo_image_surface_get_data(mask_surface);
+        int src_stride = ::cairo_image_surface_get_stride(mask_surface);
+        uint8_t *dst_data = ::cairo_image_surface_get_data(surface.get());
+        int dst_stride = ::cairo_image_surface_get_stride(surface.get());
+        uint32_t pixel = premultiplied_pixel(color.value());
+        for(int y = 0; y < height; y++)
+          colorize_a8_pixels(reinterpret_cast<uint32_t *>(dst_data + y * dst_stride), src_data + y * src_stride, width, pixel);
+        ::cairo_surface_mark_dirty(surface.get());
+        return surface.release();
+      }
+    }
+
+    //
+    // A ShadowCache class.
+    //
+
+    shared_ptr<CanvasImage> ShadowCache::image(const Dimension<int> &size, int blur_radius, const Corners<double> &radiuses, Color color)
+    {
+      Key key { size, blur_radius, radiuses };
+      lock_guard<mutex> guard(_M_mutex);
+      auto iter = _M_entries.find(key);
+      if(iter == _M_entries.end()) {
+        // The blurred mask is shared by the shadows of all colors.
+        CairoSurfaceUniquePtr mask_surface(new_shadow_mask_surface(size, blur_radius, radiuses));
+        _M_lru_keys.push_front(key);
+        Entry &entry = _M_entries[key];
+        entry.mask_surface = move(mask_surface);
+        entry.byte_count = static_cast<size_t>(::cairo_image_surface_get_stride(entry.mask_surface.get())) * ::cairo_image_surface_get_height(entry.mask_surface.get());
+        entry.lru_iter = _M_lru_keys.begin();
+        _M_byte_count += entry.byte_count;
+        iter = _M_entries.find(key);
+      } else
+        _M_lru_keys.splice(_M_lru_keys.begin(), _M_lru_keys, iter->second.lru_iter);
+      Entry &entry = iter->second;
+      auto image_iter = entry.images.find(color.value());
+      if(image_iter != entry.images.end()) return image_iter->second;
+      CairoSurfaceUniquePtr surface(new_shadow_surface(entry.mask_surface.get(), color));
+      size_t byte_count = static_cast<size_t>(::cairo_image_surface_get_stride(surface.get())) * ::cairo_image_surface_get_height(surface.get());
+      shared_ptr<CanvasImage> image(new ImplCanvasUnmodifiableImage(surface));
+      entry.images.insert(make_pair(color.value(), image));
+      entry.byte_count += byte_count;
+      _M_byte_count += byte_count;
+      evict();
+      return image;
+    }
+
+    void ShadowCache::clear()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_entries.clear();
+      _M_lru_keys.clear();
+      _M_byte_count = 0;
+    }
+
+    void ShadowCache::evict()
+    {
+      // The most recently used entry isn't evicted because its image is
+      // returned.
+      while(_M_byte_count > _M_max_byte_count && _M_lru_keys.size() > 1) {
+        auto iter = _M_entries.find(_M_lru_keys.back());
+        _M_byte_count -= iter->second.byte_count;
+        _M_entries.erase(iter);
+        _M_lru_keys.pop_back();
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    ShadowCache &shadow_cache()
+    {
+      static ShadowCache cache;
+      return cache;
+    }
+
+    int shadow_box_blur_radius(int blur_radius)
+    {
+      // The blur radius is twice the standard deviation of the Gaussian blur
+      // like in CSS, and three box blurs with the radius that is about the
+      // standard deviation approximate this Gaussian blur.
+      return min(static_cast<int>(lround(blur_radius / 2.0)), 127);
+    }
+
+    int shadow_margin(int blur_radius)
+    { return shadow_box_blur_radius(blur_radius) * 3; }
+  }
+}
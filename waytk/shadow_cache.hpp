@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SHADOW_CACHE_HPP
+#define _SHADOW_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "canvas.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    class ShadowCache
+    {
+      struct Key
+      {
+        Dimension<int> size;
+        int blur_radius;
+        Corners<double> radiuses;
+
+        bool operator==(const Key &key) const
+        {
+          return size == key.size && blur_radius == key.blur_radius &&
+            radiuses.top_left == key.radiuses.top_left && radiuses.top_right == key.radiuses.top_right &&
+            radiuses.bottom_right == key.radiuses.bottom_right && radiuses.bottom_left == key.radiuses.bottom_left;
+        }
+      };
+
+      struct KeyHash
+      {
+        std::size_t operator()(const Key &key) const
+        {
+          std::size_t hash = std::hash<int>()(key.size.width);
+          hash = hash * 31 + std::hash<int>()(key.size.height);
+          hash = hash * 31 + std::hash<int>()(key.blur_radius);
+          hash = hash * 31 + std::hash<double>()(key.radiuses.top_left);
+          hash = hash * 31 + std::hash<double>()(key.radiuses.top_right);
+          hash = hash * 31 + std::hash<double>()(key.radiuses.bottom_right);
+          return hash * 31 + std::hash<double>()(key.radiuses.bottom_left);
+        }
+      };
+
+      struct Entry
+      {
+        CairoSurfaceUniquePtr mask_surface;
+        std::unordered_map<std::uint32_t, std::shared_ptr<CanvasImage>> images;
+        std::size_t byte_count;
+        std::list<Key>::iterator lru_iter;
+      };
+
+      std::mutex _M_mutex;
+      std::unordered_map<Key, Entry, KeyHash> _M_entries;
+      std::list<Key> _M_lru_keys;
+      std::size_t _M_byte_count;
+      std::size_t _M_max_byte_count;
+    public:
+      static constexpr std::size_t DEFAULT_MAX_BYTE_COUNT = 16 * 1024 * 1024;
+
+      ShadowCache() :
+        _M_byte_count(0), _M_max_byte_count(DEFAULT_MAX_BYTE_COUNT) {}
+
+      std::shared_ptr<CanvasImage> image(const Dimension<int> &size, int blur_radius, const Corners<double> &radiuses, Color color);
+
+      void clear();
+    private:
+      void evict();
+    };
+
+    ShadowCache &shadow_cache();
+
+    int shadow_box_blur_radius(int blur_radius);
+
+    int shadow_margin(int blur_radius);
+  }
+}
+
+#endif
@@ -19,8 +19,12 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <waytk.hpp>
+#include "canvas.hpp"
+#include "shadow_cache.hpp"
 #include "styles.hpp"
 
 using namespace std;
@@ -34,52 +38,492 @@ namespace waytk
       template<typename _T>
       inline _T find_style_attr(const list<pair<PseudoClasses, _T>> &values, PseudoClasses pseudo_classes, _T value)
       {
-        return accumulate(values.begin(), values.end(), value, [pseudo_classes](_T value, pair<PseudoClasses, _T> tmp_pair) {
-          return (pseudo_classes & tmp_pair.first) == tmp_pair.first ? tmp_pair.second : value;
+        for(auto &tmp_pair : values) {
+          if((pseudo_classes & tmp_pair.first) == tmp_pair.first) value = tmp_pair.second;
+        }
+        return value;
+      }
+
+      template<typename _T>
+      inline bool has_style_attr(const list<pair<PseudoClasses, _T>> &values, PseudoClasses pseudo_classes)
+      {
+        return any_of(values.begin(), values.end(), [pseudo_classes](const pair<PseudoClasses, _T> &tmp_pair) {
+          return (pseudo_classes & tmp_pair.first) == tmp_pair.first;
         });
       }
+
+      const Gradient *find_gradient(const list<pair<PseudoClasses, GradientUniquePtr>> &gradients, PseudoClasses pseudo_classes)
+      {
+        const Gradient *gradient = nullptr;
+        for(auto &tmp_pair : gradients) {
+          if((pseudo_classes & tmp_pair.first) == tmp_pair.first) gradient = tmp_pair.second.get();
+        }
+        return gradient;
+      }
+
+      Corners<double> clamp_radiuses(const Corners<double> &radiuses, const Rectangle<double> &rect)
+      {
+        double max_radius = min(rect.width, rect.height) / 2.0;
+        return Corners<double>(min(radiuses.top_left, max_radius), min(radiuses.top_right, max_radius),
+                               min(radiuses.bottom_right, max_radius), min(radiuses.bottom_left, max_radius));
+      }
+
+      ::cairo_pattern_t *new_gradient_pattern(const Gradient *gradient, const Dimension<int> &size)
+      {
+        // The pattern is defined for the rectangle at the origin, so it can be
+        // used for all rectangles of this size.
+        double width = size.width, height = size.height;
+        CairoPatternUniquePtr pattern;
+        const LinearGradient *linear_gradient = dynamic_cast<const LinearGradient *>(gradient);
+        const RadialGradient *radial_gradient = dynamic_cast<const RadialGradient *>(gradient);
+        if(linear_gradient != nullptr) {
+          Point<double> p1, p2;
+          switch(linear_gradient->direction) {
+            case Direction::TOP_TO_BOTTOM:
+              p1 = Point<double>(0.0, 0.0);
+              p2 = Point<double>(0.0, height);
+              break;
+            case Direction::LEFT_TO_RIGHT:
+              p1 = Point<double>(0.0, 0.0);
+              p2 = Point<double>(width, 0.0);
+              break;
+            case Direction::TOP_LEFT_TO_BOTTOM_RIGHT:
+              p1 = Point<double>(0.0, 0.0);
+              p2 = Point<double>(width, height);
+              break;
+            case Direction::TOP_RIGHT_TO_BOTTOM_LEFT:
+              p1 = Point<double>(width, 0.0);
+              p2 = Point<double>(0.0, height);
+              break;
+          }
+          pattern = CairoPatternUniquePtr(::cairo_pattern_create_linear(p1.x, p1.y, p2.x, p2.y));
+          throw_canvas_exception_for_failure(pattern.get());
+        } else if(radial_gradient != nullptr) {
+          // The radial gradient reaches the farthest corners of the rectangle.
+          if(radial_gradient->shape == Shape::ELIPSE && width > 0.0 && height > 0.0) {
+            pattern = CairoPatternUniquePtr(::cairo_pattern_create_radial(0.0, 0.0, 0.0, 0.0, 0.0, 1.0));
+            throw_canvas_exception_for_failure(pattern.get());
+            ::cairo_matrix_t matrix;
+            ::cairo_matrix_init_scale(&matrix, M_SQRT2 / width, M_SQRT2 / height);
+            ::cairo_matrix_translate(&matrix, -width / 2.0, -height / 2.0);
+            ::cairo_pattern_set_matrix(pattern.get(), &matrix);
+          } else {
+            double radius = hypot(width, height) / 2.0;
+            pattern = CairoPatternUniquePtr(::cairo_pattern_create_radial(width / 2.0, height / 2.0, 0.0, width / 2.0, height / 2.0, radius));
+          }
+          throw_canvas_exception_for_failure(pattern.get());
+        } else
+          throw CanvasException("unsupported gradient");
+        add_color_stops(pattern.get(), gradient->color_stops.begin(), gradient->color_stops.end());
+        return pattern.release();
+      }
     }
   
+    //
+    // An ImplStyles class.
+    //
+
+    ImplStyles::~ImplStyles() {}
+
     Edges<int> ImplStyles::margin(PseudoClasses pseudo_classes) const
-    {
-      Edges<int> tmp_margin;
-      tmp_margin.top = find_style_attr(_M_margins.top, pseudo_classes, 0);
-      tmp_margin.right = find_style_attr(_M_margins.right, pseudo_classes, 0);
-      tmp_margin.bottom = find_style_attr(_M_margins.bottom, pseudo_classes, 0);
-      tmp_margin.left = find_style_attr(_M_margins.left, pseudo_classes, 0);
-      return tmp_margin;
-    }
+    { return resolved_style(pseudo_classes).margin; }
 
     Edges<int> ImplStyles::border(PseudoClasses pseudo_classes) const
-    {
-      Edges<int> tmp_border;
-      tmp_border.top = find_style_attr(_M_borders.top, pseudo_classes, 0);
-      tmp_border.right = find_style_attr(_M_borders.right, pseudo_classes, 0);
-      tmp_border.bottom = find_style_attr(_M_borders.bottom, pseudo_classes, 0);
-      tmp_border.left = find_style_attr(_M_borders.left, pseudo_classes, 0);
-      return tmp_border;
-    }
+    { return resolved_style(pseudo_classes).border; }
 
     Edges<int> ImplStyles::padding(PseudoClasses pseudo_classes) const
+    { return resolved_style(pseudo_classes).padding; }
+
+    void ImplStyles::draw_background(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const
     {
-      Edges<int> tmp_padding;
-      tmp_padding.top = find_style_attr(_M_paddings.top, pseudo_classes, 0);
-      tmp_padding.right = find_style_attr(_M_paddings.right, pseudo_classes, 0);
-      tmp_padding.bottom = find_style_attr(_M_paddings.bottom, pseudo_classes, 0);
-      tmp_padding.left = find_style_attr(_M_paddings.left, pseudo_classes, 0);
-      return tmp_padding;
+      if(rect.width <= 0 || rect.height <= 0) return;
+      const ResolvedStyle &style = resolved_style(pseudo_classes);
+      draw_box_shadow(pseudo_classes, canvas, rect);
+      Edges<int> tmp_border = style.border;
+      Corners<double> radiuses = style.border_radius;
+      Corners<double> padding_radiuses = style.padding_radius;
+      // The corners of the nine-patch contain the rounded corners of the
+      // border and the padding.
+      Edges<int> corner_edges;
+      corner_edges.top = static_cast<int>(ceil(max({ radiuses.top_left, radiuses.top_right, tmp_border.top + padding_radiuses.top_left, tmp_border.top + padding_radiuses.top_right, static_cast<double>(tmp_border.top) })));
+      corner_edges.right = static_cast<int>(ceil(max({ radiuses.top_right, radiuses.bottom_right, tmp_border.right + padding_radiuses.top_right, tmp_border.right + padding_radiuses.bottom_right, static_cast<double>(tmp_border.right) })));
+      corner_edges.bottom = static_cast<int>(ceil(max({ radiuses.bottom_right, radiuses.bottom_left, tmp_border.bottom + padding_radiuses.bottom_right, tmp_border.bottom + padding_radiuses.bottom_left, static_cast<double>(tmp_border.bottom) })));
+      corner_edges.left = static_cast<int>(ceil(max({ radiuses.bottom_left, radiuses.top_left, tmp_border.left + padding_radiuses.bottom_left, tmp_border.left + padding_radiuses.top_left, static_cast<double>(tmp_border.left) })));
+      int corner_size = max({ corner_edges.top, corner_edges.right, corner_edges.bottom, corner_edges.left });
+      // A background that is smaller than the nine-patch image isn't
+      // stretchable, so it is cached in its size.
+      if(rect.width < corner_size * 2 || rect.height < corner_size * 2) {
+        shared_ptr<CanvasImage> image = background_image(pseudo_classes, rect.size());
+        canvas->save();
+        canvas->rect(rect.x, rect.y, rect.width, rect.height);
+        canvas->set_image(image.get(), rect.x, rect.y);
+        canvas->fill();
+        canvas->restore();
+        return;
+      }
+      int x1 = rect.x, y1 = rect.y;
+      int x2 = rect.x + rect.width, y2 = rect.y + rect.height;
+      int center_width = rect.width - corner_edges.left - corner_edges.right;
+      int center_height = rect.height - corner_edges.top - corner_edges.bottom;
+      Rectangle<double> outer_rect(rect.x, rect.y, rect.width, rect.height);
+      canvas->save();
+      if(corner_size > 0) {
+        // The nine-patch image is shared by all backgrounds of these pseudo
+        // classes. The colors of gradients in the corners depend on the
+        // background size, so the corners of a background with gradients are
+        // cached for each size.
+        shared_ptr<CanvasImage> image;
+        if(style.has_gradients)
+          image = corner_image(pseudo_classes, rect.size(), corner_size);
+        else
+          image = background_image(pseudo_classes, Dimension<int>(corner_size * 2, corner_size * 2));
+        canvas->rect(x1, y1, corner_edges.left, corner_edges.top);
+        canvas->set_image(image.get(), x1, y1);
+        canvas->fill();
+        canvas->rect(x2 - corner_edges.right, y1, corner_edges.right, corner_edges.top);
+        canvas->set_image(image.get(), x2 - corner_size * 2, y1);
+        canvas->fill();
+        canvas->rect(x2 - corner_edges.right, y2 - corner_edges.bottom, corner_edges.right, corner_edges.bottom);
+        canvas->set_image(image.get(), x2 - corner_size * 2, y2 - corner_size * 2);
+        canvas->fill();
+        canvas->rect(x1, y2 - corner_edges.bottom, corner_edges.left, corner_edges.bottom);
+        canvas->set_image(image.get(), x1, y2 - corner_size * 2);
+        canvas->fill();
+      }
+      // The edges and the center are stretchable, so they are filled. The
+      // gradients are drawn directly with the cached patterns.
+      if(style.background_gradient != nullptr || style.has_background_color) {
+        canvas->save();
+        canvas->rect(x1 + corner_edges.left, y1, center_width, rect.height);
+        canvas->rect(x1, y1 + corner_edges.top, corner_edges.left, center_height);
+        canvas->rect(x2 - corner_edges.right, y1 + corner_edges.top, corner_edges.right, center_height);
+        if(style.background_gradient != nullptr)
+          set_gradient(canvas, style.background_gradient, outer_rect);
+        else
+          canvas->set_color(style.background_color);
+        canvas->fill();
+        canvas->restore();
+      }
+      struct BorderEdge
+      {
+        int width;
+        Color color;
+        const Gradient *gradient;
+        Rectangle<int> rect;
+      };
+      BorderEdge edges[4] = {
+        { tmp_border.top, style.border_color.top, style.border_gradient.top, Rectangle<int>(x1 + corner_edges.left, y1, center_width, tmp_border.top) },
+        { tmp_border.right, style.border_color.right, style.border_gradient.right, Rectangle<int>(x2 - tmp_border.right, y1 + corner_edges.top, tmp_border.right, center_height) },
+        { tmp_border.bottom, style.border_color.bottom, style.border_gradient.bottom, Rectangle<int>(x1 + corner_edges.left, y2 - tmp_border.bottom, center_width, tmp_border.bottom) },
+        { tmp_border.left, style.border_color.left, style.border_gradient.left, Rectangle<int>(x1, y1 + corner_edges.top, tmp_border.left, center_height) }
+      };
+      for(auto &edge : edges) {
+        if(edge.width <= 0) continue;
+        canvas->save();
+        canvas->rect(edge.rect.x, edge.rect.y, edge.rect.width, edge.rect.height);
+        if(edge.gradient != nullptr)
+          set_gradient(canvas, edge.gradient, outer_rect);
+        else
+          canvas->set_color(edge.color);
+        canvas->fill();
+        canvas->restore();
+      }
+      canvas->restore();
     }
 
-    void ImplStyles::draw_background(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const
-    { throw exception(); }
+    Edges<int> ImplStyles::visual_overflow(PseudoClasses pseudo_classes) const
+    { return resolved_style(pseudo_classes).visual_overflow; }
 
     Color ImplStyles::background_color(PseudoClasses pseudo_classes) const
-    { return find_style_attr(_M_background_colors, pseudo_classes, Color(0xffffffff)); }
+    { return resolved_style(pseudo_classes).background_color; }
     
     Color ImplStyles::foreground_color(PseudoClasses pseudo_classes) const
-    { return find_style_attr(_M_foreground_colors, pseudo_classes, Color(0xff000000)); }
+    { return resolved_style(pseudo_classes).foreground_color; }
 
     bool ImplStyles::has_adjacency_to()
     { throw exception(); }
+
+    const ResolvedStyle &ImplStyles::resolved_style(PseudoClasses pseudo_classes) const
+    {
+      auto iter = _M_resolved_styles.find(pseudo_classes);
+      if(iter != _M_resolved_styles.end()) return iter->second;
+      // Widgets use few combinations of pseudo classes, so the box properties
+      // are resolved once for each combination.
+      if(_M_resolved_styles.size() >= MAX_RESOLVED_STYLE_COUNT) _M_resolved_styles.clear();
+      ResolvedStyle style;
+      style.margin.top = find_style_attr(_M_margins.top, pseudo_classes, 0);
+      style.margin.right = find_style_attr(_M_margins.right, pseudo_classes, 0);
+      style.margin.bottom = find_style_attr(_M_margins.bottom, pseudo_classes, 0);
+      style.margin.left = find_style_attr(_M_margins.left, pseudo_classes, 0);
+      style.border.top = find_style_attr(_M_borders.top, pseudo_classes, 0);
+      style.border.right = find_style_attr(_M_borders.right, pseudo_classes, 0);
+      style.border.bottom = find_style_attr(_M_borders.bottom, pseudo_classes, 0);
+      style.border.left = find_style_attr(_M_borders.left, pseudo_classes, 0);
+      style.padding.top = find_style_attr(_M_paddings.top, pseudo_classes, 0);
+      style.padding.right = find_style_attr(_M_paddings.right, pseudo_classes, 0);
+      style.padding.bottom = find_style_attr(_M_paddings.bottom, pseudo_classes, 0);
+      style.padding.left = find_style_attr(_M_paddings.left, pseudo_classes, 0);
+      style.border_radius.top_left = find_style_attr(_M_border_radiuses.top_left, pseudo_classes, 0.0);
+      style.border_radius.top_right = find_style_attr(_M_border_radiuses.top_right, pseudo_classes, 0.0);
+      style.border_radius.bottom_right = find_style_attr(_M_border_radiuses.bottom_right, pseudo_classes, 0.0);
+      style.border_radius.bottom_left = find_style_attr(_M_border_radiuses.bottom_left, pseudo_classes, 0.0);
+      style.background_color = find_style_attr(_M_background_colors, pseudo_classes, Color(0xffffffff));
+      style.foreground_color = find_style_attr(_M_foreground_colors, pseudo_classes, Color(0xff000000));
+      // The background properties are also resolved here, so drawing a
+      // background doesn't search the lists of the pseudo classes.
+      style.padding_radius.top_left = find_style_attr(_M_padding_radiuses.top_left, pseudo_classes, 0.0);
+      style.padding_radius.top_right = find_style_attr(_M_padding_radiuses.top_right, pseudo_classes, 0.0);
+      style.padding_radius.bottom_right = find_style_attr(_M_padding_radiuses.bottom_right, pseudo_classes, 0.0);
+      style.padding_radius.bottom_left = find_style_attr(_M_padding_radiuses.bottom_left, pseudo_classes, 0.0);
+      style.has_padding_radius.top_left = has_style_attr(_M_padding_radiuses.top_left, pseudo_classes);
+      style.has_padding_radius.top_right = has_style_attr(_M_padding_radiuses.top_right, pseudo_classes);
+      style.has_padding_radius.bottom_right = has_style_attr(_M_padding_radiuses.bottom_right, pseudo_classes);
+      style.has_padding_radius.bottom_left = has_style_attr(_M_padding_radiuses.bottom_left, pseudo_classes);
+      style.has_background_color = has_style_attr(_M_background_colors, pseudo_classes);
+      style.background_gradient = find_gradient(_M_background_gradients, pseudo_classes);
+      style.border_color.top = find_style_attr(_M_border_colors.top, pseudo_classes, Color(0xff000000));
+      style.border_color.right = find_style_attr(_M_border_colors.right, pseudo_classes, Color(0xff000000));
+      style.border_color.bottom = find_style_attr(_M_border_colors.bottom, pseudo_classes, Color(0xff000000));
+      style.border_color.left = find_style_attr(_M_border_colors.left, pseudo_classes, Color(0xff000000));
+      style.border_gradient.top = find_gradient(_M_border_gradients.top, pseudo_classes);
+      style.border_gradient.right = find_gradient(_M_border_gradients.right, pseudo_classes);
+      style.border_gradient.bottom = find_gradient(_M_border_gradients.bottom, pseudo_classes);
+      style.border_gradient.left = find_gradient(_M_border_gradients.left, pseudo_classes);
+      style.has_gradients = style.background_gradient != nullptr ||
+        style.border_gradient.top != nullptr || style.border_gradient.right != nullptr ||
+        style.border_gradient.bottom != nullptr || style.border_gradient.left != nullptr;
+      style.has_box_shadow = has_style_attr(_M_box_shadows, pseudo_classes);
+      style.box_shadow = find_style_attr(_M_box_shadows, pseudo_classes, BoxShadow(Point<int>(0, 0), 0, 0, Color(0)));
+      // The box shadow is the only part of the background outside the
+      // rectangle.
+      style.visual_overflow = Edges<int>(0, 0, 0, 0);
+      if(style.has_box_shadow && style.box_shadow.color.alpha() != 0) {
+        int extent = shadow_margin(style.box_shadow.blur_radius) + style.box_shadow.spread;
+        style.visual_overflow.top = max(extent - style.box_shadow.offset.y, 0);
+        style.visual_overflow.right = max(extent + style.box_shadow.offset.x, 0);
+        style.visual_overflow.bottom = max(extent + style.box_shadow.offset.y, 0);
+        style.visual_overflow.left = max(extent - style.box_shadow.offset.x, 0);
+      }
+      return _M_resolved_styles.insert(make_pair(pseudo_classes, style)).first->second;
+    }
+
+    void ImplStyles::draw_box_shadow(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const
+    {
+      const ResolvedStyle &style = resolved_style(pseudo_classes);
+      if(!style.has_box_shadow) return;
+      const BoxShadow &box_shadow = style.box_shadow;
+      Rectangle<int> shadow_rect(rect.x + box_shadow.offset.x - box_shadow.spread, rect.y + box_shadow.offset.y - box_shadow.spread,
+                                 rect.width + box_shadow.spread * 2, rect.height + box_shadow.spread * 2);
+      if(shadow_rect.width <= 0 || shadow_rect.height <= 0 || box_shadow.color.alpha() == 0) return;
+      Corners<double> radiuses = style.border_radius;
+      // The radiuses grow with the spread like in CSS.
+      radiuses.top_left = radiuses.top_left > 0.0 ? max(radiuses.top_left + box_shadow.spread, 0.0) : 0.0;
+      radiuses.top_right = radiuses.top_right > 0.0 ? max(radiuses.top_right + box_shadow.spread, 0.0) : 0.0;
+      radiuses.bottom_right = radiuses.bottom_right > 0.0 ? max(radiuses.bottom_right + box_shadow.spread, 0.0) : 0.0;
+      radiuses.bottom_left = radiuses.bottom_left > 0.0 ? max(radiuses.bottom_left + box_shadow.spread, 0.0) : 0.0;
+      radiuses = clamp_radiuses(radiuses, Rectangle<double>(0.0, 0.0, shadow_rect.width, shadow_rect.height));
+      // The blurred shadow is cached, so it is blurred once for each size.
+      shared_ptr<CanvasImage> image = shadow_cache().image(shadow_rect.size(), box_shadow.blur_radius, radiuses, box_shadow.color);
+      int margin = shadow_margin(box_shadow.blur_radius);
+      canvas->save();
+      canvas->rect(shadow_rect.x - margin, shadow_rect.y - margin, shadow_rect.width + margin * 2, shadow_rect.height + margin * 2);
+      canvas->set_image(image.get(), shadow_rect.x - margin, shadow_rect.y - margin);
+      canvas->fill();
+      canvas->restore();
+    }
+
+    void ImplStyles::draw_background_without_cache(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const
+    {
+      const ResolvedStyle &style = resolved_style(pseudo_classes);
+      Edges<int> tmp_border = style.border;
+      Rectangle<double> outer_rect(rect.x, rect.y, rect.width, rect.height);
+      Corners<double> outer_radiuses = style.border_radius;
+      outer_radiuses = clamp_radiuses(outer_radiuses, outer_rect);
+      Rectangle<double> inner_rect(outer_rect.x + tmp_border.left, outer_rect.y + tmp_border.top,
+                                   max(outer_rect.width - tmp_border.left - tmp_border.right, 0.0),
+                                   max(outer_rect.height - tmp_border.top - tmp_border.bottom, 0.0));
+      Corners<double> inner_radiuses;
+      inner_radiuses.top_left = style.has_padding_radius.top_left ? style.padding_radius.top_left : max(outer_radiuses.top_left - max(tmp_border.top, tmp_border.left), 0.0);
+      inner_radiuses.top_right = style.has_padding_radius.top_right ? style.padding_radius.top_right : max(outer_radiuses.top_right - max(tmp_border.top, tmp_border.right), 0.0);
+      inner_radiuses.bottom_right = style.has_padding_radius.bottom_right ? style.padding_radius.bottom_right : max(outer_radiuses.bottom_right - max(tmp_border.bottom, tmp_border.right), 0.0);
+      inner_radiuses.bottom_left = style.has_padding_radius.bottom_left ? style.padding_radius.bottom_left : max(outer_radiuses.bottom_left - max(tmp_border.bottom, tmp_border.left), 0.0);
+      inner_radiuses = clamp_radiuses(inner_radiuses, inner_rect);
+      if(style.background_gradient != nullptr || style.has_background_color) {
+        canvas->save();
+        rounded_rect_path(canvas, outer_rect, outer_radiuses, false);
+        if(style.background_gradient != nullptr)
+          set_gradient(canvas, style.background_gradient, outer_rect);
+        else
+          canvas->set_color(style.background_color);
+        canvas->fill();
+        canvas->restore();
+      }
+      // Each border edge is the part of the area between the border box and
+      // the padding box that is cut by the lines from the outer corners to the
+      // inner corners.
+      double x1 = outer_rect.x, y1 = outer_rect.y;
+      double x2 = outer_rect.x + outer_rect.width, y2 = outer_rect.y + outer_rect.height;
+      double ix1 = inner_rect.x, iy1 = inner_rect.y;
+      double ix2 = inner_rect.x + inner_rect.width, iy2 = inner_rect.y + inner_rect.height;
+      struct BorderEdge
+      {
+        int width;
+        Color color;
+        const Gradient *gradient;
+        Point<double> points[4];
+      };
+      BorderEdge edges[4] = {
+        { tmp_border.top, style.border_color.top, style.border_gradient.top, { Point<double>(x1, y1), Point<double>(x2, y1), Point<double>(ix2, iy1), Point<double>(ix1, iy1) } },
+        { tmp_border.right, style.border_color.right, style.border_gradient.right, { Point<double>(x2, y1), Point<double>(x2, y2), Point<double>(ix2, iy2), Point<double>(ix2, iy1) } },
+        { tmp_border.bottom, style.border_color.bottom, style.border_gradient.bottom, { Point<double>(x2, y2), Point<double>(x1, y2), Point<double>(ix1, iy2), Point<double>(ix2, iy2) } },
+        { tmp_border.left, style.border_color.left, style.border_gradient.left, { Point<double>(x1, y2), Point<double>(x1, y1), Point<double>(ix1, iy1), Point<double>(ix1, iy2) } }
+      };
+      for(auto &edge : edges) {
+        if(edge.width <= 0) continue;
+        canvas->save();
+        canvas->move_to(edge.points[0]);
+        for(int i = 1; i < 4; i++) canvas->line_to(edge.points[i]);
+        canvas->close_path();
+        canvas->clip();
+        rounded_rect_path(canvas, outer_rect, outer_radiuses, false);
+        if(inner_rect.width > 0.0 && inner_rect.height > 0.0)
+          rounded_rect_path(canvas, inner_rect, inner_radiuses, true);
+        if(edge.gradient != nullptr)
+          set_gradient(canvas, edge.gradient, outer_rect);
+        else
+          canvas->set_color(edge.color);
+        canvas->fill();
+        canvas->restore();
+      }
+    }
+
+    shared_ptr<CanvasPattern> ImplStyles::gradient_pattern(const Gradient *gradient, const Dimension<int> &size) const
+    {
+      GradientKey key { gradient, size };
+      auto iter = _M_gradient_patterns.find(key);
+      if(iter != _M_gradient_patterns.end()) return iter->second;
+      if(_M_gradient_patterns.size() >= MAX_GRADIENT_PATTERN_COUNT) _M_gradient_patterns.clear();
+      CairoPatternUniquePtr pattern(new_gradient_pattern(gradient, size));
+      shared_ptr<CanvasPattern> canvas_pattern(new ImplCanvasPattern(pattern));
+      _M_gradient_patterns.insert(make_pair(key, canvas_pattern));
+      return canvas_pattern;
+    }
+
+    void ImplStyles::set_gradient(Canvas *canvas, const Gradient *gradient, const Rectangle<double> &rect) const
+    {
+      // The pattern is locked to the user space when it is set, so the user
+      // space is moved to the rectangle. The current path must already be
+      // built.
+      Dimension<int> size(static_cast<int>(round(rect.width)), static_cast<int>(round(rect.height)));
+      shared_ptr<CanvasPattern> pattern = gradient_pattern(gradient, size);
+      canvas->translate(rect.x, rect.y);
+      canvas->set_pattern(pattern.get());
+    }
+
+    shared_ptr<CanvasImage> ImplStyles::background_image(PseudoClasses pseudo_classes, const Dimension<int> &size) const
+    {
+      BackgroundKey key { pseudo_classes, size };
+      auto iter = _M_background_images.find(key);
+      if(iter != _M_background_images.end()) return iter->second;
+      // The backgrounds of many sizes would fill the cache, so the cache is
+      // cleared when it is full.
+      if(_M_background_images.size() >= MAX_BACKGROUND_IMAGE_COUNT) _M_background_images.clear();
+      CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, size.width, size.height));
+      throw_canvas_exception_for_failure(surface.get());
+      {
+        CairoUniquePtr context(::cairo_create(surface.get()));
+        throw_canvas_exception_for_failure(::cairo_status(context.get()));
+        ImplCanvas canvas(context);
+        draw_background_without_cache(pseudo_classes, &canvas, Rectangle<int>(0, 0, size.width, size.height));
+      }
+      // The cached image isn't modifiable, so the recording canvas doesn't copy
+      // it.
+      shared_ptr<CanvasImage> image(new ImplCanvasUnmodifiableImage(surface));
+      _M_background_images.insert(make_pair(key, image));
+      return image;
+    }
+
+    shared_ptr<CanvasImage> ImplStyles::corner_image(PseudoClasses pseudo_classes, const Dimension<int> &size, int corner_size) const
+    {
+      BackgroundKey key { pseudo_classes, size };
+      auto iter = _M_corner_images.find(key);
+      if(iter != _M_corner_images.end()) return iter->second;
+      if(_M_corner_images.size() >= MAX_CORNER_IMAGE_COUNT) _M_corner_images.clear();
+      // The image has the layout of the nine-patch image, so each quarter
+      // contains the corner of the background of this size.
+      CairoSurfaceUniquePtr surface(::cairo_image_surface_create(::CAIRO_FORMAT_ARGB32, corner_size * 2, corner_size * 2));
+      throw_canvas_exception_for_failure(surface.get());
+      {
+        CairoUniquePtr context(::cairo_create(surface.get()));
+        throw_canvas_exception_for_failure(::cairo_status(context.get()));
+        ImplCanvas canvas(context);
+        Point<int> offsets[4] = {
+          Point<int>(0, 0),
+          Point<int>(corner_size * 2 - size.width, 0),
+          Point<int>(corner_size * 2 - size.width, corner_size * 2 - size.height),
+          Point<int>(0, corner_size * 2 - size.height)
+        };
+        Point<int> quarters[4] = {
+          Point<int>(0, 0),
+          Point<int>(corner_size, 0),
+          Point<int>(corner_size, corner_size),
+          Point<int>(0, corner_size)
+        };
+        for(int i = 0; i < 4; i++) {
+          canvas.save();
+          canvas.rect(Rectangle<double>(quarters[i].x, quarters[i].y, corner_size, corner_size));
+          canvas.clip();
+          draw_background_without_cache(pseudo_classes, &canvas, Rectangle<int>(offsets[i].x, offsets[i].y, size.width, size.height));
+          canvas.restore();
+        }
+      }
+      shared_ptr<CanvasImage> image(new ImplCanvasUnmodifiableImage(surface));
+      _M_corner_images.insert(make_pair(key, image));
+      return image;
+    }
+
+    //
+    // Functions.
+    //
+
+    namespace
+    {
+      atomic<unsigned> current_styles_generation(0);
+    }
+
+    void rounded_rect_path(Canvas *canvas, const Rectangle<double> &rect, const Corners<double> &radiuses, bool is_negative)
+    {
+      double x1 = rect.x, y1 = rect.y;
+      double x2 = rect.x + rect.width, y2 = rect.y + rect.height;
+      if(!is_negative) {
+        canvas->move_to(x1, y1 + radiuses.top_left);
+        canvas->arc(x1 + radiuses.top_left, y1 + radiuses.top_left, radiuses.top_left, M_PI, 1.5 * M_PI);
+        canvas->arc(x2 - radiuses.top_right, y1 + radiuses.top_right, radiuses.top_right, 1.5 * M_PI, 2.0 * M_PI);
+        canvas->arc(x2 - radiuses.bottom_right, y2 - radiuses.bottom_right, radiuses.bottom_right, 0.0, 0.5 * M_PI);
+        canvas->arc(x1 + radiuses.bottom_left, y2 - radiuses.bottom_left, radiuses.bottom_left, 0.5 * M_PI, M_PI);
+      } else {
+        canvas->move_to(x1, y2 - radiuses.bottom_left);
+        canvas->arc(x1 + radiuses.bottom_left, y2 - radiuses.bottom_left, radiuses.bottom_left, M_PI, 0.5 * M_PI, true);
+        canvas->arc(x2 - radiuses.bottom_right, y2 - radiuses.bottom_right, radiuses.bottom_right, 0.5 * M_PI, 0.0, true);
+        canvas->arc(x2 - radiuses.top_right, y1 + radiuses.top_right, radiuses.top_right, 2.0 * M_PI, 1.5 * M_PI, true);
+        canvas->arc(x1 + radiuses.top_left, y1 + radiuses.top_left, radiuses.top_left, 1.5 * M_PI, M_PI, true);
+      }
+      canvas->close_path();
+    }
+
+    unsigned styles_generation()
+    { return current_styles_generation; }
+
+    void increase_styles_generation()
+    { current_styles_generation++; }
   }
+
+  //
+  // A Styles class.
+  //
+
+  Styles::~Styles() {}
+
+  Edges<int> Styles::visual_overflow(PseudoClasses pseudo_classes) const
+  { return Edges<int>(0, 0, 0, 0); }
 }
@@ -22,7 +22,10 @@
 #ifndef _STYLES_HPP
 #define _STYLES_HPP
 
+#include <cstddef>
 #include <list>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 #include <waytk.hpp>
 
@@ -45,7 +48,11 @@ namespace waytk
     };
 
     struct Gradient
-    { std::vector<ColorStop> color_stops; };
+    {
+      std::vector<ColorStop> color_stops;
+
+      virtual ~Gradient() {}
+    };
     
     struct LinearGradient : public Gradient
     { Direction direction; };
@@ -55,6 +62,83 @@ namespace waytk
     
     typedef std::unique_ptr<Gradient> GradientUniquePtr;
 
+    struct BoxShadow
+    {
+      Point<int> offset;
+      int blur_radius;
+      int spread;
+      Color color;
+
+      BoxShadow() {}
+
+      BoxShadow(const Point<int> &offset, int blur_radius, int spread, Color color) :
+        offset(offset), blur_radius(blur_radius), spread(spread), color(color) {}
+    };
+
+    struct ResolvedStyle
+    {
+      Edges<int> margin;
+      Edges<int> border;
+      Edges<int> padding;
+      Corners<double> border_radius;
+      Color background_color;
+      Color foreground_color;
+      Edges<int> visual_overflow;
+      Corners<double> padding_radius;
+      Corners<bool> has_padding_radius;
+      bool has_background_color;
+      const Gradient *background_gradient;
+      Edges<Color> border_color;
+      Edges<const Gradient *> border_gradient;
+      bool has_gradients;
+      bool has_box_shadow;
+      BoxShadow box_shadow;
+    };
+
+    struct PseudoClassesHash
+    {
+      std::size_t operator()(PseudoClasses pseudo_classes) const
+      { return std::hash<int>()(static_cast<int>(pseudo_classes)); }
+    };
+
+    struct BackgroundKey
+    {
+      PseudoClasses pseudo_classes;
+      Dimension<int> size;
+
+      bool operator==(const BackgroundKey &key) const
+      { return pseudo_classes == key.pseudo_classes && size == key.size; }
+    };
+
+    struct BackgroundKeyHash
+    {
+      std::size_t operator()(const BackgroundKey &key) const
+      {
+        std::size_t hash = std::hash<int>()(static_cast<int>(key.pseudo_classes));
+        hash = hash * 31 + std::hash<int>()(key.size.width);
+        return hash * 31 + std::hash<int>()(key.size.height);
+      }
+    };
+
+    struct GradientKey
+    {
+      const Gradient *gradient;
+      Dimension<int> size;
+
+      bool operator==(const GradientKey &key) const
+      { return gradient == key.gradient && size == key.size; }
+    };
+
+    struct GradientKeyHash
+    {
+      std::size_t operator()(const GradientKey &key) const
+      {
+        std::size_t hash = std::hash<const Gradient *>()(key.gradient);
+        hash = hash * 31 + std::hash<int>()(key.size.width);
+        return hash * 31 + std::hash<int>()(key.size.height);
+      }
+    };
+
     class ImplStyles : public Styles
     {
       Edges<std::list<std::pair<PseudoClasses, int>>> _M_margins;
@@ -67,7 +151,17 @@ namespace waytk
       std::list<std::pair<PseudoClasses, GradientUniquePtr>> _M_background_gradients;
       Edges<std::list<std::pair<PseudoClasses, Color>>> _M_border_colors;
       Edges<std::list<std::pair<PseudoClasses, GradientUniquePtr>>> _M_border_gradients;
+      std::list<std::pair<PseudoClasses, BoxShadow>> _M_box_shadows;
+      mutable std::unordered_map<PseudoClasses, ResolvedStyle, PseudoClassesHash> _M_resolved_styles;
+      mutable std::unordered_map<BackgroundKey, std::shared_ptr<CanvasImage>, BackgroundKeyHash> _M_background_images;
+      mutable std::unordered_map<BackgroundKey, std::shared_ptr<CanvasImage>, BackgroundKeyHash> _M_corner_images;
+      mutable std::unordered_map<GradientKey, std::shared_ptr<CanvasPattern>, GradientKeyHash> _M_gradient_patterns;
     public:
+      static constexpr std::size_t MAX_RESOLVED_STYLE_COUNT = 256;
+      static constexpr std::size_t MAX_BACKGROUND_IMAGE_COUNT = 64;
+      static constexpr std::size_t MAX_CORNER_IMAGE_COUNT = 64;
+      static constexpr std::size_t MAX_GRADIENT_PATTERN_COUNT = 256;
+
       virtual ~ImplStyles();
 
       virtual Edges<int> margin(PseudoClasses pseudo_classes) const;
@@ -78,23 +172,35 @@ namespace waytk
 
       virtual void draw_background(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const;
 
+      virtual Edges<int> visual_overflow(PseudoClasses pseudo_classes) const;
+
       virtual Color background_color(PseudoClasses pseudo_classes) const;
 
       virtual Color foreground_color(PseudoClasses pseudo_classes) const;
 
       virtual bool has_adjacency_to();
 
+      const ResolvedStyle &resolved_style(PseudoClasses pseudo_classes) const;
+
+      void clear_caches()
+      {
+        _M_resolved_styles.clear();
+        _M_background_images.clear();
+        _M_corner_images.clear();
+        _M_gradient_patterns.clear();
+      }
+
       void add_margin_top(PseudoClasses pseudo_classes, int top)
-      { _M_margins.top.push_back(std::make_pair(pseudo_classes, top)); }
+      { _M_margins.top.push_back(std::make_pair(pseudo_classes, top)); clear_caches(); }
 
       void add_margin_right(PseudoClasses pseudo_classes, int right)
-      { _M_margins.right.push_back(std::make_pair(pseudo_classes, right)); }
+      { _M_margins.right.push_back(std::make_pair(pseudo_classes, right)); clear_caches(); }
 
       void add_margin_bottom(PseudoClasses pseudo_classes, int bottom)
-      { _M_margins.bottom.push_back(std::make_pair(pseudo_classes, bottom)); }
+      { _M_margins.bottom.push_back(std::make_pair(pseudo_classes, bottom)); clear_caches(); }
 
       void add_margin_left(PseudoClasses pseudo_classes, int left)
-      { _M_margins.left.push_back(std::make_pair(pseudo_classes, left)); }
+      { _M_margins.left.push_back(std::make_pair(pseudo_classes, left)); clear_caches(); }
 
       void add_margin(PseudoClasses pseudo_classes, const Edges<int> &margin)
       {
@@ -105,16 +211,16 @@ namespace waytk
       }
 
       void add_border_top(PseudoClasses pseudo_classes, int top)
-      { _M_borders.top.push_back(std::make_pair(pseudo_classes, top)); }
+      { _M_borders.top.push_back(std::make_pair(pseudo_classes, top)); clear_caches(); }
 
       void add_border_right(PseudoClasses pseudo_classes, int right)
-      { _M_borders.right.push_back(std::make_pair(pseudo_classes, right)); }
+      { _M_borders.right.push_back(std::make_pair(pseudo_classes, right)); clear_caches(); }
 
       void add_border_bottom(PseudoClasses pseudo_classes, int bottom)
-      { _M_borders.bottom.push_back(std::make_pair(pseudo_classes, bottom)); }
+      { _M_borders.bottom.push_back(std::make_pair(pseudo_classes, bottom)); clear_caches(); }
 
       void add_border_left(PseudoClasses pseudo_classes, int left)
-      { _M_borders.left.push_back(std::make_pair(pseudo_classes, left)); }
+      { _M_borders.left.push_back(std::make_pair(pseudo_classes, left)); clear_caches(); }
 
       void add_border(PseudoClasses pseudo_classes, const Edges<int> &border)
       {
@@ -125,16 +231,16 @@ namespace waytk
       }
 
       void add_padding_top(PseudoClasses pseudo_classes, int top)
-      { _M_paddings.top.push_back(std::make_pair(pseudo_classes, top)); }
+      { _M_paddings.top.push_back(std::make_pair(pseudo_classes, top)); clear_caches(); }
 
       void add_padding_right(PseudoClasses pseudo_classes, int right)
-      { _M_paddings.right.push_back(std::make_pair(pseudo_classes, right)); }
+      { _M_paddings.right.push_back(std::make_pair(pseudo_classes, right)); clear_caches(); }
 
       void add_padding_bottom(PseudoClasses pseudo_classes, int bottom)
-      { _M_paddings.bottom.push_back(std::make_pair(pseudo_classes, bottom)); }
+      { _M_paddings.bottom.push_back(std::make_pair(pseudo_classes, bottom)); clear_caches(); }
 
       void add_padding_left(PseudoClasses pseudo_classes, int left)
-      { _M_paddings.left.push_back(std::make_pair(pseudo_classes, left)); }
+      { _M_paddings.left.push_back(std::make_pair(pseudo_classes, left)); clear_caches(); }
 
       void add_padding(PseudoClasses pseudo_classes, const Edges<int> &padding)
       {
@@ -145,19 +251,19 @@ namespace waytk
       }
 
       void add_foreground_color(PseudoClasses pseudo_classes, Color color)
-      { _M_foreground_colors.push_back(std::make_pair(pseudo_classes, color)); }
+      { _M_foreground_colors.push_back(std::make_pair(pseudo_classes, color)); clear_caches(); }
 
       void add_border_radius_top_left(PseudoClasses pseudo_classes, double top_left)
-      { _M_border_radiuses.top_left.push_back(std::make_pair(pseudo_classes, top_left)); }
+      { _M_border_radiuses.top_left.push_back(std::make_pair(pseudo_classes, top_left)); clear_caches(); }
 
       void add_border_radius_top_right(PseudoClasses pseudo_classes, double top_right)
-      { _M_border_radiuses.top_right.push_back(std::make_pair(pseudo_classes, top_right)); }
+      { _M_border_radiuses.top_right.push_back(std::make_pair(pseudo_classes, top_right)); clear_caches(); }
 
       void add_border_radius_bottom_right(PseudoClasses pseudo_classes, double bottom_right)
-      { _M_border_radiuses.top_left.push_back(std::make_pair(pseudo_classes, bottom_right)); }
+      { _M_border_radiuses.bottom_right.push_back(std::make_pair(pseudo_classes, bottom_right)); clear_caches(); }
 
       void add_border_radius_bottom_left(PseudoClasses pseudo_classes, double bottom_left)
-      { _M_border_radiuses.top_left.push_back(std::make_pair(pseudo_classes, bottom_left)); }
+      { _M_border_radiuses.bottom_left.push_back(std::make_pair(pseudo_classes, bottom_left)); clear_caches(); }
 
       void add_border_radius(PseudoClasses pseudo_classes, const Corners<double> &radius)
       {
@@ -168,16 +274,16 @@ namespace waytk
       }
 
       void add_padding_radius_top_left(PseudoClasses pseudo_classes, double top_left)
-      { _M_padding_radiuses.top_left.push_back(std::make_pair(pseudo_classes, top_left)); }
+      { _M_padding_radiuses.top_left.push_back(std::make_pair(pseudo_classes, top_left)); clear_caches(); }
 
       void add_padding_radius_top_right(PseudoClasses pseudo_classes, double top_right)
-      { _M_padding_radiuses.top_right.push_back(std::make_pair(pseudo_classes, top_right)); }
+      { _M_padding_radiuses.top_right.push_back(std::make_pair(pseudo_classes, top_right)); clear_caches(); }
 
       void add_padding_radius_bottom_right(PseudoClasses pseudo_classes, double bottom_right)
-      { _M_padding_radiuses.top_left.push_back(std::make_pair(pseudo_classes, bottom_right)); }
+      { _M_padding_radiuses.bottom_right.push_back(std::make_pair(pseudo_classes, bottom_right)); clear_caches(); }
 
       void add_padding_radius_bottom_left(PseudoClasses pseudo_classes, double bottom_left)
-      { _M_padding_radiuses.top_left.push_back(std::make_pair(pseudo_classes, bottom_left)); }
+      { _M_padding_radiuses.bottom_left.push_back(std::make_pair(pseudo_classes, bottom_left)); clear_caches(); }
 
       void add_padding_radius(PseudoClasses pseudo_classes, const Corners<double> &radius)
       {
@@ -188,34 +294,54 @@ namespace waytk
       }
       
       void add_background_color(PseudoClasses pseudo_classes, Color color)
-      { _M_background_colors.push_back(std::make_pair(pseudo_classes, color)); }
+      { _M_background_colors.push_back(std::make_pair(pseudo_classes, color)); clear_caches(); }
 
       void add_background_gradient(PseudoClasses pseudo_classes, Gradient *gradient)
-      { _M_background_gradients.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(gradient))); }
+      { _M_background_gradients.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(gradient))); clear_caches(); }
 
       void add_background_gradient(PseudoClasses pseudo_classes, GradientUniquePtr &gradient)
       { add_background_gradient(pseudo_classes, gradient.release()); }
 
+      void add_border_color_top(PseudoClasses pseudo_classes, Color top)
+      { _M_border_colors.top.push_back(std::make_pair(pseudo_classes, top)); clear_caches(); }
+
+      void add_border_color_right(PseudoClasses pseudo_classes, Color right)
+      { _M_border_colors.right.push_back(std::make_pair(pseudo_classes, right)); clear_caches(); }
+
+      void add_border_color_bottom(PseudoClasses pseudo_classes, Color bottom)
+      { _M_border_colors.bottom.push_back(std::make_pair(pseudo_classes, bottom)); clear_caches(); }
+
+      void add_border_color_left(PseudoClasses pseudo_classes, Color left)
+      { _M_border_colors.left.push_back(std::make_pair(pseudo_classes, left)); clear_caches(); }
+
+      void add_border_colors(PseudoClasses pseudo_classes, const Edges<Color> &colors)
+      {
+        add_border_color_top(pseudo_classes, colors.top);
+        add_border_color_right(pseudo_classes, colors.right);
+        add_border_color_bottom(pseudo_classes, colors.bottom);
+        add_border_color_left(pseudo_classes, colors.left);
+      }
+
       void add_border_gradient_top(PseudoClasses pseudo_classes, Gradient *top)
-      { _M_border_gradients.top.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(top))); }
+      { _M_border_gradients.top.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(top))); clear_caches(); }
 
       void add_border_gradient_top(PseudoClasses pseudo_classes, GradientUniquePtr &top)
       { add_border_gradient_top(pseudo_classes, top.release()); }
       
       void add_border_gradient_right(PseudoClasses pseudo_classes, Gradient *right)
-      { _M_border_gradients.right.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(right))); }
+      { _M_border_gradients.right.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(right))); clear_caches(); }
 
       void add_border_gradient_right(PseudoClasses pseudo_classes, GradientUniquePtr &right)
       { add_border_gradient_right(pseudo_classes, right.release()); }
 
       void add_border_gradient_bottom(PseudoClasses pseudo_classes, Gradient *bottom)
-      { _M_border_gradients.bottom.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(bottom))); }
+      { _M_border_gradients.bottom.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(bottom))); clear_caches(); }
 
       void add_border_gradient_bottom(PseudoClasses pseudo_classes, GradientUniquePtr &bottom)
       { add_border_gradient_bottom(pseudo_classes, bottom.release()); }
 
       void add_border_gradient_left(PseudoClasses pseudo_classes, Gradient *left)
-      { _M_border_gradients.left.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(left))); }
+      { _M_border_gradients.left.push_back(std::make_pair(pseudo_classes, GradientUniquePtr(left))); clear_caches(); }
 
       void add_border_gradient_left(PseudoClasses pseudo_classes, GradientUniquePtr &left)
       { add_border_gradient_left(pseudo_classes, left.release()); }
@@ -235,7 +361,28 @@ namespace waytk
         add_border_gradient_bottom(pseudo_classes, gradients.bottom);
         add_border_gradient_left(pseudo_classes, gradients.left);
       }
+
+      void add_box_shadow(PseudoClasses pseudo_classes, const BoxShadow &box_shadow)
+      { _M_box_shadows.push_back(std::make_pair(pseudo_classes, box_shadow)); clear_caches(); }
+    private:
+      void draw_box_shadow(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const;
+
+      void draw_background_without_cache(PseudoClasses pseudo_classes, Canvas *canvas, const Rectangle<int> &rect) const;
+
+      std::shared_ptr<CanvasImage> background_image(PseudoClasses pseudo_classes, const Dimension<int> &size) const;
+
+      std::shared_ptr<CanvasImage> corner_image(PseudoClasses pseudo_classes, const Dimension<int> &size, int corner_size) const;
+
+      std::shared_ptr<CanvasPattern> gradient_pattern(const Gradient *gradient, const Dimension<int> &size) const;
+
+      void set_gradient(Canvas *canvas, const Gradient *gradient, const Rectangle<double> &rect) const;
     };
+
+    void rounded_rect_path(Canvas *canvas, const Rectangle<double> &rect, const Corners<double> &radiuses, bool is_negative);
+
+    unsigned styles_generation();
+
+    void increase_styles_generation();
   }
 }
 
@@ -19,6 +19,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <algorithm>
 #include <limits>
 #include "waytk_priv.hpp"
 
@@ -26,6 +27,22 @@ using namespace std;
 
 namespace waytk
 {
+  namespace
+  {
+    const size_t MAX_DAMAGED_RECT_COUNT = 16;
+
+    long long rect_area(const Rectangle<int> &rect)
+    { return static_cast<long long>(rect.width) * rect.height; }
+
+    Rectangle<int> bounding_rect_of_rects(const Rectangle<int> &rect1, const Rectangle<int> &rect2)
+    {
+      int x = min(rect1.x, rect2.x), y = min(rect1.y, rect2.y);
+      int x2 = max(rect1.x + rect1.width, rect2.x + rect2.width);
+      int y2 = max(rect1.y + rect1.height, rect2.y + rect2.height);
+      return Rectangle<int>(x, y, x2 - x, y2 - y);
+    }
+  }
+
   Surface::Surface(Widget *widget) :
     _M_root_widget(widget),
     _M_is_modal(false),
@@ -34,6 +51,7 @@ namespace waytk
     _M_is_resizable(true),
     _M_is_visible(true),
     _M_size(numeric_limits<int>::max(), numeric_limits<int>::max()),
+    _M_shadow_margin(0, 0, 0, 0),
     _M_on_size_change_callback([](const shared_ptr<Surface> &surface, const Dimension<int> &size) {}),
     _M_on_touch_cancel_callback([](const shared_ptr<Surface> &surface) {}),
     _M_focused_widget(nullptr) {}
@@ -47,6 +65,7 @@ namespace waytk
     _M_is_resizable(true),
     _M_is_visible(true),
     _M_size(numeric_limits<int>::max(), numeric_limits<int>::max()),
+    _M_shadow_margin(0, 0, 0, 0),
     _M_on_size_change_callback([](const shared_ptr<Surface> &surface, const Dimension<int> &size) {}),
     _M_on_touch_cancel_callback([](const shared_ptr<Surface> &surface) {}),
     _M_focused_widget(nullptr) {}
@@ -61,6 +80,7 @@ namespace waytk
     _M_is_resizable(true),
     _M_is_visible(true),
     _M_size(numeric_limits<int>::max(), numeric_limits<int>::max()),
+    _M_shadow_margin(0, 0, 0, 0),
     _M_on_size_change_callback([](const shared_ptr<Surface> &surface, const Dimension<int> &size) {}),
     _M_on_touch_cancel_callback([](const shared_ptr<Surface> &surface) {}),
     _M_focused_widget(nullptr) {}
@@ -74,6 +94,7 @@ namespace waytk
     _M_is_resizable(false),
     _M_is_visible(true),
     _M_size(numeric_limits<int>::max(), numeric_limits<int>::max()),
+    _M_shadow_margin(0, 0, 0, 0),
     _M_on_size_change_callback([](const shared_ptr<Surface> &surface, const Dimension<int> &size) {}),
     _M_on_touch_cancel_callback([](const shared_ptr<Surface> &surface) {}),
     _M_focused_widget(nullptr) {}
@@ -110,6 +131,73 @@ namespace waytk
     _M_is_visible = is_visible;
   }
 
+  bool Surface::is_damaged(const Rectangle<int> &rect) const
+  {
+    Rectangle<int> tmp_rect = rect;
+    Rectangle<int> result;
+    for(auto &damaged_rect : _M_damaged_rects) {
+      if(tmp_rect.intersect(damaged_rect, result)) return true;
+    }
+    return false;
+  }
+
+  void Surface::damage(const Rectangle<int> &rect)
+  {
+    if(rect.width <= 0 || rect.height <= 0) return;
+    // Two rectangles are merged into their bounding rectangle only if it
+    // doesn't add much undamaged area, so distant or diagonal rectangles
+    // aren't merged into a large rectangle.
+    Rectangle<int> tmp_rect = rect;
+    bool is_merged;
+    do {
+      is_merged = false;
+      for(auto iter = _M_damaged_rects.begin(); iter != _M_damaged_rects.end(); iter++) {
+        Rectangle<int> bounding_rect = bounding_rect_of_rects(tmp_rect, *iter);
+        if(rect_area(bounding_rect) * 4 <= (rect_area(tmp_rect) + rect_area(*iter)) * 5) {
+          tmp_rect = bounding_rect;
+          _M_damaged_rects.erase(iter);
+          is_merged = true;
+          break;
+        }
+      }
+    } while(is_merged);
+    _M_damaged_rects.push_back(tmp_rect);
+    // The number of rectangles is limited by merging the pair of rectangles
+    // which adds the least undamaged area.
+    while(_M_damaged_rects.size() > MAX_DAMAGED_RECT_COUNT) {
+      size_t best_i = 0, best_j = 1;
+      long long best_waste = numeric_limits<long long>::max();
+      for(size_t i = 0; i < _M_damaged_rects.size(); i++) {
+        for(size_t j = i + 1; j < _M_damaged_rects.size(); j++) {
+          Rectangle<int> bounding_rect = bounding_rect_of_rects(_M_damaged_rects[i], _M_damaged_rects[j]);
+          long long waste = rect_area(bounding_rect) - rect_area(_M_damaged_rects[i]) - rect_area(_M_damaged_rects[j]);
+          if(waste < best_waste) {
+            best_i = i;
+            best_j = j;
+            best_waste = waste;
+          }
+        }
+      }
+      _M_damaged_rects[best_i] = bounding_rect_of_rects(_M_damaged_rects[best_i], _M_damaged_rects[best_j]);
+      _M_damaged_rects.erase(_M_damaged_rects.begin() + best_j);
+    }
+  }
+
+  void Surface::draw(Canvas *canvas)
+  {
+    if(_M_damaged_rects.empty() || _M_root_widget.get() == nullptr) return;
+    CanvasBatch batch(canvas);
+    canvas->save();
+    for(auto &damaged_rect : _M_damaged_rects) {
+      canvas->rect(damaged_rect.x, damaged_rect.y, damaged_rect.width, damaged_rect.height);
+    }
+    canvas->clip();
+    canvas->new_path();
+    if(_M_root_widget->is_visible()) _M_root_widget->draw(canvas);
+    canvas->restore();
+    batch.end();
+  }
+
   void Surface::on_size_change(const shared_ptr<Surface> &surface, const Dimension<int> &size)
   { throw exception(); }
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "svg_cache.hpp"
+#include "task_queue.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    //
+    // A SvgRasterCache class.
+    //
+
+    CairoSurfaceSharedFuture SvgRasterCache::request(const shared_ptr<::RsvgHandle> &handle, const Point<double> &sp, bool is_async)
+    {
+      Key key(handle.get(), sp.x, sp.y);
+      shared_ptr<SurfacePromise> promise;
+      CairoSurfaceSharedFuture surface_future;
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(key);
+        if(iter != _M_entries.end()) {
+          // A pending rasterization also is shared, so concurrent requests
+          // rasterize the image once.
+          _M_lru_keys.splice(_M_lru_keys.begin(), _M_lru_keys, iter->second.lru_iter);
+          return iter->second.surface_future;
+        }
+        promise = shared_ptr<SurfacePromise>(new SurfacePromise());
+        surface_future = promise->get_future().share();
+        _M_lru_keys.push_front(key);
+        Entry &entry = _M_entries[key];
+        entry.handle = handle;
+        entry.surface_future = surface_future;
+        entry.promise = promise;
+        entry.byte_count = 0;
+        entry.lru_iter = _M_lru_keys.begin();
+      }
+      if(is_async)
+        background_task_queue().push([this, key, handle, promise]() { rasterize(key, handle, promise); });
+      else
+        rasterize(key, handle, promise);
+      return surface_future;
+    }
+
+    size_t SvgRasterCache::byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_byte_count;
+    }
+
+    size_t SvgRasterCache::max_byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_max_byte_count;
+    }
+
+    void SvgRasterCache::set_max_byte_count(size_t count)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_max_byte_count = count;
+      evict();
+    }
+
+    void SvgRasterCache::clear()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_entries.clear();
+      _M_lru_keys.clear();
+      _M_byte_count = 0;
+    }
+
+    void SvgRasterCache::rasterize(const Key &key, const shared_ptr<::RsvgHandle> &handle, const shared_ptr<SurfacePromise> &promise)
+    {
+      shared_ptr<::cairo_surface_t> surface;
+      try {
+        surface = shared_ptr<::cairo_surface_t>(new_svg_surface(handle.get(), Point<double>(key.sx, key.sy)), CairoSurfaceDelete());
+      } catch(...) {
+        promise->set_exception(current_exception());
+        // A failed rasterization isn't cached.
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(key);
+        if(iter != _M_entries.end() && iter->second.promise == promise) {
+          _M_lru_keys.erase(iter->second.lru_iter);
+          _M_entries.erase(iter);
+        }
+        return;
+      }
+      promise->set_value(surface);
+      lock_guard<mutex> guard(_M_mutex);
+      auto iter = _M_entries.find(key);
+      if(iter != _M_entries.end() && iter->second.promise == promise) {
+        iter->second.promise.reset();
+        iter->second.byte_count = static_cast<size_t>(::cairo_image_surface_get_stride(surface.get())) * ::cairo_image_surface_get_height(surface.get());
+        _M_byte_count += iter->second.byte_count;
+        evict();
+      }
+    }
+
+    void SvgRasterCache::evict()
+    {
+      auto lru_iter = _M_lru_keys.end();
+      while(_M_byte_count > _M_max_byte_count && lru_iter != _M_lru_keys.begin()) {
+        lru_iter--;
+        auto iter = _M_entries.find(*lru_iter);
+        // The pending rasterizations aren't evicted.
+        if(iter->second.promise.get() != nullptr) continue;
+        _M_byte_count -= iter->second.byte_count;
+        _M_entries.erase(iter);
+        lru_iter = _M_lru_keys.erase(lru_iter);
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    SvgRasterCache &svg_raster_cache()
+    {
+      static SvgRasterCache cache;
+      return cache;
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SVG_CACHE_HPP
+#define _SVG_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "canvas.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    class SvgRasterCache
+    {
+      struct Key
+      {
+        ::RsvgHandle *handle;
+        double sx;
+        double sy;
+
+        Key() {}
+
+        Key(::RsvgHandle *handle, double sx, double sy) :
+          handle(handle), sx(sx), sy(sy) {}
+
+        bool operator==(const Key &key) const
+        { return handle == key.handle && sx == key.sx && sy == key.sy; }
+      };
+
+      struct KeyHash
+      {
+        std::size_t operator()(const Key &key) const
+        {
+          std::size_t hash = std::hash<::RsvgHandle *>()(key.handle);
+          hash = hash * 31 + std::hash<double>()(key.sx);
+          hash = hash * 31 + std::hash<double>()(key.sy);
+          return hash;
+        }
+      };
+
+      typedef std::promise<std::shared_ptr<::cairo_surface_t>> SurfacePromise;
+
+      struct Entry
+      {
+        std::shared_ptr<::RsvgHandle> handle;
+        CairoSurfaceSharedFuture surface_future;
+        std::shared_ptr<SurfacePromise> promise;
+        std::size_t byte_count;
+        std::list<Key>::iterator lru_iter;
+      };
+
+      std::mutex _M_mutex;
+      std::unordered_map<Key, Entry, KeyHash> _M_entries;
+      std::list<Key> _M_lru_keys;
+      std::size_t _M_byte_count;
+      std::size_t _M_max_byte_count;
+    public:
+      static constexpr std::size_t DEFAULT_MAX_BYTE_COUNT = 32 * 1024 * 1024;
+
+      SvgRasterCache() :
+        _M_byte_count(0), _M_max_byte_count(DEFAULT_MAX_BYTE_COUNT) {}
+
+      CairoSurfaceSharedFuture request(const std::shared_ptr<::RsvgHandle> &handle, const Point<double> &sp, bool is_async);
+
+      std::size_t byte_count();
+
+      std::size_t max_byte_count();
+
+      void set_max_byte_count(std::size_t count);
+
+      void clear();
+    private:
+      void rasterize(const Key &key, const std::shared_ptr<::RsvgHandle> &handle, const std::shared_ptr<SurfacePromise> &promise);
+
+      void evict();
+    };
+
+    SvgRasterCache &svg_raster_cache();
+  }
+}
+
+#endif
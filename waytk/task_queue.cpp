@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include "task_queue.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    //
+    // A TaskQueue class.
+    //
+
+    TaskQueue::TaskQueue(unsigned thread_count) :
+      _M_is_stopped(false)
+    {
+      for(unsigned i = 0; i < thread_count; i++)
+        _M_threads.push_back(thread([this]() { run_worker(); }));
+    }
+
+    TaskQueue::~TaskQueue()
+    {
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        // The queued tasks are still run because they set promises that can
+        // be waited for.
+        _M_is_stopped = true;
+      }
+      _M_condition.notify_all();
+      for(auto &thread : _M_threads) thread.join();
+    }
+
+    void TaskQueue::push(const function<void ()> &task)
+    {
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        _M_tasks.push_back(task);
+      }
+      _M_condition.notify_one();
+    }
+
+    void TaskQueue::run_worker()
+    {
+      unique_lock<mutex> lock(_M_mutex);
+      while(true) {
+        _M_condition.wait(lock, [this]() { return _M_is_stopped || !_M_tasks.empty(); });
+        if(_M_tasks.empty()) break;
+        function<void ()> task(move(_M_tasks.front()));
+        _M_tasks.pop_front();
+        lock.unlock();
+        // A task should handle its exceptions.
+        try {
+          task();
+        } catch(...) {}
+        lock.lock();
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    TaskQueue &background_task_queue()
+    {
+      static TaskQueue task_queue(max(thread::hardware_concurrency(), 2U) - 1);
+      return task_queue;
+    }
+  }
+}
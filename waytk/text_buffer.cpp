@@ -72,6 +72,21 @@ namespace waytk
     size_t ImplTextBuffer::line_count() const
     { return _M_line_count; }
 
+    size_t ImplTextBuffer::char_iter_to_byte_offset(const TextCharIterator &iter) const
+    {
+      throw_runtime_exception_for_invalid_iterator(iter);
+      size_t index = char_iter_data1(iter);
+      if(index < _M_gap_begin_index) return index;
+      if(index < _M_cursor_index) return _M_gap_begin_index;
+      return index - (_M_cursor_index - _M_gap_begin_index);
+    }
+
+    TextCharIterator ImplTextBuffer::byte_offset_to_char_iter(size_t offset) const
+    {
+      if(offset < _M_gap_begin_index) return make_char_iter(offset, 0);
+      return make_char_iter(min(offset + (_M_cursor_index - _M_gap_begin_index), _M_bytes.size()), 0);
+    }
+
     TextCharIterator ImplTextBuffer::cursor_iter() const
     { return make_char_iter(_M_cursor_index, 0); }
 
@@ -300,7 +315,7 @@ namespace waytk
     {
       if(iter1.buffer() == iter2.buffer()) {
         uintptr_t index1 = byte_iter_data1(iter1) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter1);
-        uintptr_t index2 = byte_iter_data1(iter2) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter1);
+        uintptr_t index2 = byte_iter_data1(iter2) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter2);
         return index1 == index2;
       } else
         return false;
@@ -310,7 +325,7 @@ namespace waytk
     {
       if(iter1.buffer() == iter2.buffer()) {
         uintptr_t index1 = byte_iter_data1(iter1) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter1);
-        uintptr_t index2 = byte_iter_data1(iter2) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter1);
+        uintptr_t index2 = byte_iter_data1(iter2) == _M_gap_begin_index ? _M_cursor_index : byte_iter_data1(iter2);
         return index1 < index2;
       } else
         return iter1.buffer() < iter2.buffer();
@@ -457,6 +472,20 @@ namespace waytk
     return iter;
   }
   
+  size_t TextBuffer::char_iter_to_byte_offset(const TextCharIterator &iter) const
+  {
+    size_t offset = 0;
+    for(auto byte_iter = byte_begin(); byte_iter != iter.byte_iter() && byte_iter != byte_end(); byte_iter++) offset++;
+    return offset;
+  }
+
+  TextCharIterator TextBuffer::byte_offset_to_char_iter(size_t offset) const
+  {
+    auto byte_iter = byte_begin();
+    for(size_t i = 0; i < offset && byte_iter != byte_end(); i++) byte_iter++;
+    return TextCharIterator(byte_iter);
+  }
+
   void TextBuffer::validate_char_iter(TextCharIterator &iter, const TextCharIterator &old_cursor_iter) const
   {
     TextByteIterator tmp_iter = make_byte_iter(char_iter_data1(iter), char_iter_data2(iter));
@@ -70,6 +70,10 @@ namespace waytk
       virtual std::size_t char_count() const;
 
       virtual std::size_t line_count() const;
+
+      virtual std::size_t char_iter_to_byte_offset(const TextCharIterator &iter) const;
+
+      virtual TextCharIterator byte_offset_to_char_iter(std::size_t offset) const;
     
       virtual TextCharIterator cursor_iter() const;
 
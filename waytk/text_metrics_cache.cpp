@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <cmath>
+#include "text_buffer.hpp"
+#include "text_metrics_cache.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    void get_utf8(const TextCharIterator &iter, const TextCharIterator &end, char *buf)
+    {
+      auto tmp_iter = iter;
+      if(tmp_iter < end) tmp_iter++;
+      size_t i = 0;
+      for(auto tmp_iter2 = *iter; tmp_iter2 != *tmp_iter; tmp_iter2++, i++) {
+        buf[i] = *tmp_iter2;
+      }
+      buf[i] = 0;
+    }
+
+    //
+    // A TextMetricsCache class.
+    //
+
+    void TextMetricsCache::set_fixed_pitch(Canvas *canvas)
+    {
+      canvas->get_text_matrics("a", _M_fixed_text_metrics);
+      _M_has_fixed_pitch = true;
+    }
+
+    void TextMetricsCache::get_text_metrics(Canvas *canvas, const char *utf8, TextMetrics &text_metrics)
+    {
+      if(_M_has_fixed_pitch && utf8[0] != 0 && static_cast<unsigned char>(utf8[0]) < 0x80 && utf8[1] == 0) {
+        // All ASCII characters of a monospace font have same advance. Wide
+        // characters such as CJK characters and emoji are still measured.
+        text_metrics = _M_fixed_text_metrics;
+        return;
+      }
+      // A normalized UTF-8 character has at most four bytes, so its bytes
+      // can be packed into a key.
+      uint32_t key = 0;
+      for(size_t i = 0; utf8[i] != 0; i++) {
+        key = (key << 8) | static_cast<unsigned char>(utf8[i]);
+      }
+      auto iter = _M_text_metrics.find(key);
+      if(iter == _M_text_metrics.end()) {
+        canvas->get_text_matrics(utf8, text_metrics);
+        _M_text_metrics.insert(make_pair(key, text_metrics));
+      } else
+        text_metrics = iter->second;
+    }
+
+    int TextMetricsCache::word_width(Canvas *canvas, const TextCharIterator &first_iter, const TextCharIterator &end_iter, int max_width)
+    {
+      // The bytes of the word are the key of the memoized width, so a
+      // repeated word is measured by one lookup instead of a lookup for each
+      // character.
+      _M_word.clear();
+      bool is_memoizable = true;
+      for(auto iter = first_iter; iter != end_iter; iter++) {
+        char c = **iter;
+        if(c == ' ' || c == '\t' || c == '\n') break;
+        if(_M_word.length() >= MAX_MEMOIZED_WORD_LENGTH) {
+          is_memoizable = false;
+          break;
+        }
+        auto next_iter = iter;
+        next_iter++;
+        for(auto byte_iter = *iter; byte_iter != *next_iter; byte_iter++) _M_word += *byte_iter;
+      }
+      if(is_memoizable) {
+        auto iter = _M_word_widths.find(_M_word);
+        if(iter != _M_word_widths.end()) return iter->second;
+      }
+      // A long word isn't memoized and is only measured until it exceeds
+      // the maximal width.
+      int width = 0;
+      for(auto iter = first_iter; iter != end_iter; iter++) {
+        char buf[MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
+        get_utf8(iter, end_iter, buf);
+        if(*buf == ' ' || *buf == '\t' || *buf == '\n') break;
+        TextMetrics text_metrics;
+        get_text_metrics(canvas, buf, text_metrics);
+        width += ceil(text_metrics.x_advance);
+        if(!is_memoizable && width > max_width) break;
+      }
+      if(is_memoizable) _M_word_widths.insert(make_pair(_M_word, width));
+      return width;
+    }
+  }
+}
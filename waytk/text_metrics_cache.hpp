@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _TEXT_METRICS_CACHE_HPP
+#define _TEXT_METRICS_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <waytk.hpp>
+
+namespace waytk
+{
+  namespace priv
+  {
+    const std::size_t MAX_MEMOIZED_WORD_LENGTH = 64;
+
+    void get_utf8(const TextCharIterator &iter, const TextCharIterator &end, char *buf);
+
+    //
+    // A TextMetricsCache class.
+    //
+
+    class TextMetricsCache
+    {
+      bool _M_has_fixed_pitch;
+      TextMetrics _M_fixed_text_metrics;
+      std::unordered_map<std::uint32_t, TextMetrics> _M_text_metrics;
+      std::unordered_map<std::string, int> _M_word_widths;
+      std::string _M_word;
+    public:
+      TextMetricsCache() :
+        _M_has_fixed_pitch(false) {}
+
+      void set_fixed_pitch(Canvas *canvas);
+
+      void get_text_metrics(Canvas *canvas, const char *utf8, TextMetrics &text_metrics);
+
+      int word_width(Canvas *canvas, const TextCharIterator &first_iter, const TextCharIterator &end_iter, int max_width);
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,1021 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <unistd.h>
+#include <yaml.h>
+#include "shadow_cache.hpp"
+#include "theme.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    namespace
+    {
+      const char theme_magic[8] = { 'W', 'T', 'K', 'T', 'H', 'E', 'M', 'E' };
+
+      enum class AttributeType : uint32_t
+      {
+        MARGIN_TOP,
+        MARGIN_RIGHT,
+        MARGIN_BOTTOM,
+        MARGIN_LEFT,
+        BORDER_TOP,
+        BORDER_RIGHT,
+        BORDER_BOTTOM,
+        BORDER_LEFT,
+        PADDING_TOP,
+        PADDING_RIGHT,
+        PADDING_BOTTOM,
+        PADDING_LEFT,
+        FOREGROUND_COLOR,
+        BORDER_RADIUS_TOP_LEFT,
+        BORDER_RADIUS_TOP_RIGHT,
+        BORDER_RADIUS_BOTTOM_RIGHT,
+        BORDER_RADIUS_BOTTOM_LEFT,
+        PADDING_RADIUS_TOP_LEFT,
+        PADDING_RADIUS_TOP_RIGHT,
+        PADDING_RADIUS_BOTTOM_RIGHT,
+        PADDING_RADIUS_BOTTOM_LEFT,
+        BACKGROUND_COLOR,
+        BACKGROUND_GRADIENT,
+        BORDER_COLOR_TOP,
+        BORDER_COLOR_RIGHT,
+        BORDER_COLOR_BOTTOM,
+        BORDER_COLOR_LEFT,
+        BORDER_GRADIENT_TOP,
+        BORDER_GRADIENT_RIGHT,
+        BORDER_GRADIENT_BOTTOM,
+        BORDER_GRADIENT_LEFT,
+        BOX_SHADOW,
+        COUNT
+      };
+
+      enum class GradientType : int32_t
+      {
+        LINEAR,
+        RADIAL
+      };
+
+      struct PseudoClassName
+      {
+        const char *name;
+        PseudoClasses pseudo_classes;
+      };
+
+      const PseudoClassName pseudo_class_names[] = {
+        { "active", PseudoClasses::ACTIVE },
+        { "backdrop", PseudoClasses::BACKDROP },
+        { "checked", PseudoClasses::CHECKED },
+        { "disabled", PseudoClasses::DISABLED },
+        { "focus", PseudoClasses::FOCUS },
+        { "hover", PseudoClasses::HOVER },
+        { "selected", PseudoClasses::SELECTED },
+        { "adjacent_to_top", PseudoClasses::ADJACENT_TO_TOP },
+        { "adjacent_to_right", PseudoClasses::ADJACENT_TO_RIGHT },
+        { "adjacent_to_bottom", PseudoClasses::ADJACENT_TO_BOTTOM },
+        { "adjacent_to_left", PseudoClasses::ADJACENT_TO_LEFT },
+        { "first", PseudoClasses::FIRST },
+        { "last", PseudoClasses::LAST },
+        { "even", PseudoClasses::EVEN },
+        { "odd", PseudoClasses::ODD },
+        { "top_active", PseudoClasses::TOP_ACTIVE },
+        { "right_active", PseudoClasses::RIGHT_ACTIVE },
+        { "bottom_active", PseudoClasses::BOTTOM_ACTIVE },
+        { "left_active", PseudoClasses::LEFT_ACTIVE }
+      };
+
+      struct FileDelete
+      {
+        void operator()(FILE *file) const
+        { fclose(file); }
+      };
+
+      bool source_file_stat(const string &file_name, int64_t &mtime, int64_t &size)
+      {
+        struct stat file_stat;
+        if(stat(file_name.c_str(), &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) return false;
+        mtime = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+        size = file_stat.st_size;
+        return true;
+      }
+
+      template<typename _T>
+      void append_to_buffer(vector<uint8_t> &buffer, const _T &object)
+      {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&object);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(_T));
+      }
+
+      // Expands one to four values to four values in the order of the edges
+      // or the corners like CSS.
+      template<typename _T>
+      void expand_four_values(const vector<_T> &values, _T (&four_values)[4])
+      {
+        switch(values.size()) {
+          case 1:
+            fill(four_values, four_values + 4, values[0]);
+            break;
+          case 2:
+            four_values[0] = four_values[2] = values[0];
+            four_values[1] = four_values[3] = values[1];
+            break;
+          case 3:
+            four_values[0] = values[0];
+            four_values[1] = four_values[3] = values[1];
+            four_values[2] = values[2];
+            break;
+          case 4:
+            copy(values.begin(), values.end(), four_values);
+            break;
+          default:
+            throw FileFormatException("invalid number of theme values");
+        }
+      }
+
+      string theme_cache_file_name(const string &file_name)
+      {
+        char hash_str[17];
+        snprintf(hash_str, sizeof(hash_str), "%016llx", static_cast<unsigned long long>(hash<string>()(file_name)));
+        return cache_file_name(string("theme-") + hash_str);
+      }
+
+      bool find_default_theme_file_name(string &file_name)
+      {
+        const char *env_file_name = getenv("WAYTK_THEME");
+        if(env_file_name != nullptr && env_file_name[0] != 0) {
+          file_name = env_file_name;
+          return true;
+        }
+        vector<string> data_dirs;
+        get_data_dirs(data_dirs);
+        for(auto &data_dir : data_dirs) {
+          string tmp_file_name = data_dir + "/waytk/theme.yaml";
+          if(access(tmp_file_name.c_str(), R_OK) == 0) {
+            file_name = tmp_file_name;
+            return true;
+          }
+        }
+        return false;
+      }
+    }
+
+    //
+    // A CompiledTheme class.
+    //
+
+    struct CompiledTheme::Header
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t style_count;
+      uint32_t attribute_count;
+      uint32_t color_stop_count;
+      int64_t source_mtime;
+      int64_t source_size;
+      uint32_t source_name_offset;
+      uint32_t styles_offset;
+      uint32_t attributes_offset;
+      uint32_t color_stops_offset;
+      uint32_t strings_offset;
+      uint32_t strings_size;
+    };
+
+    struct CompiledTheme::Style
+    {
+      uint32_t name_offset;
+      uint32_t first_attribute;
+      uint32_t attribute_count;
+      uint32_t pad;
+    };
+
+    struct CompiledTheme::Attribute
+    {
+      uint32_t type;
+      uint32_t pseudo_classes;
+      int32_t values[4];
+      uint32_t color;
+      uint32_t pad;
+      double real_value;
+    };
+
+    struct CompiledTheme::ColorStopEntry
+    {
+      double offset;
+      uint32_t color;
+      uint32_t pad;
+    };
+
+    class CompiledTheme::Builder
+    {
+      yaml_document_t _M_document;
+      bool _M_has_document;
+      string _M_strings;
+      vector<Style> _M_styles;
+      vector<Attribute> _M_attributes;
+      vector<ColorStopEntry> _M_color_stops;
+    public:
+      Builder() :
+        _M_has_document(false) {}
+
+      ~Builder()
+      { if(_M_has_document) yaml_document_delete(&_M_document); }
+
+      void parse(const string &file_name);
+
+      void write(vector<uint8_t> &buffer, const string &source_file_name, int64_t source_mtime, int64_t source_size);
+    private:
+      void add_style(const char *name, yaml_node_t *node);
+
+      void add_rule(yaml_node_t *node);
+
+      void add_property(PseudoClasses pseudo_classes, const char *name, yaml_node_t *node);
+
+      void add_int_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      void add_real_corners(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      void add_color_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      void add_gradient_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      Attribute new_color_attribute(AttributeType type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      Attribute new_gradient_attribute(AttributeType type, PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      Attribute new_box_shadow_attribute(PseudoClasses pseudo_classes, yaml_node_t *node);
+
+      PseudoClasses parse_pseudo_classes(yaml_node_t *node);
+
+      uint32_t add_string(const char *str);
+
+      yaml_node_t *node(int index);
+
+      void node_items(yaml_node_t *node, vector<yaml_node_t *> &items);
+
+      const char *scalar(yaml_node_t *node);
+
+      int32_t int_scalar(yaml_node_t *node);
+
+      double real_scalar(yaml_node_t *node);
+
+      uint32_t color_scalar(yaml_node_t *node);
+    };
+
+    void CompiledTheme::Builder::parse(const string &file_name)
+    {
+      unique_ptr<FILE, FileDelete> file(fopen(file_name.c_str(), "rb"));
+      if(file.get() == nullptr) throw IOException("can't open theme file");
+      yaml_parser_t parser;
+      if(yaml_parser_initialize(&parser) == 0) throw RuntimeException("can't initialize YAML parser");
+      yaml_parser_set_input_file(&parser, file.get());
+      _M_has_document = (yaml_parser_load(&parser, &_M_document) != 0);
+      yaml_parser_delete(&parser);
+      if(!_M_has_document) throw FileFormatException("invalid YAML theme file");
+      yaml_node_t *root_node = yaml_document_get_root_node(&_M_document);
+      if(root_node == nullptr) return;
+      if(root_node->type != YAML_MAPPING_NODE) throw FileFormatException("theme isn't YAML mapping");
+      for(yaml_node_pair_t *pair = root_node->data.mapping.pairs.start; pair != root_node->data.mapping.pairs.top; pair++)
+        add_style(scalar(node(pair->key)), node(pair->value));
+      // The styles are sorted by their names, so the same theme always has
+      // the same image.
+      sort(_M_styles.begin(), _M_styles.end(), [this](const Style &style1, const Style &style2) {
+        return strcmp(_M_strings.c_str() + style1.name_offset, _M_strings.c_str() + style2.name_offset) < 0;
+      });
+      auto iter = adjacent_find(_M_styles.begin(), _M_styles.end(), [this](const Style &style1, const Style &style2) {
+        return strcmp(_M_strings.c_str() + style1.name_offset, _M_strings.c_str() + style2.name_offset) == 0;
+      });
+      if(iter != _M_styles.end()) throw FileFormatException("duplicate styles in theme");
+    }
+
+    void CompiledTheme::Builder::write(vector<uint8_t> &buffer, const string &source_file_name, int64_t source_mtime, int64_t source_size)
+    {
+      uint32_t source_name_offset = add_string(source_file_name.c_str());
+      Header header;
+      copy(theme_magic, theme_magic + 8, header.magic);
+      header.version = VERSION;
+      header.style_count = _M_styles.size();
+      header.attribute_count = _M_attributes.size();
+      header.color_stop_count = _M_color_stops.size();
+      header.source_mtime = source_mtime;
+      header.source_size = source_size;
+      header.source_name_offset = source_name_offset;
+      header.styles_offset = sizeof(Header);
+      header.attributes_offset = header.styles_offset + _M_styles.size() * sizeof(Style);
+      header.color_stops_offset = header.attributes_offset + _M_attributes.size() * sizeof(Attribute);
+      header.strings_offset = header.color_stops_offset + _M_color_stops.size() * sizeof(ColorStopEntry);
+      header.strings_size = _M_strings.size();
+      buffer.clear();
+      append_to_buffer(buffer, header);
+      for(auto &style : _M_styles) append_to_buffer(buffer, style);
+      for(auto &attribute : _M_attributes) append_to_buffer(buffer, attribute);
+      for(auto &color_stop : _M_color_stops) append_to_buffer(buffer, color_stop);
+      buffer.insert(buffer.end(), _M_strings.begin(), _M_strings.end());
+    }
+
+    void CompiledTheme::Builder::add_style(const char *name, yaml_node_t *node)
+    {
+      Style style;
+      style.name_offset = add_string(name);
+      style.first_attribute = _M_attributes.size();
+      style.pad = 0;
+      vector<yaml_node_t *> rule_nodes;
+      node_items(node, rule_nodes);
+      for(auto rule_node : rule_nodes) add_rule(rule_node);
+      style.attribute_count = _M_attributes.size() - style.first_attribute;
+      _M_styles.push_back(style);
+    }
+
+    void CompiledTheme::Builder::add_rule(yaml_node_t *node)
+    {
+      if(node->type != YAML_MAPPING_NODE) throw FileFormatException("theme rule isn't YAML mapping");
+      PseudoClasses pseudo_classes = PseudoClasses::NONE;
+      for(yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair != node->data.mapping.pairs.top; pair++) {
+        if(strcmp(scalar(this->node(pair->key)), "pseudo_classes") == 0)
+          pseudo_classes = parse_pseudo_classes(this->node(pair->value));
+      }
+      for(yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair != node->data.mapping.pairs.top; pair++) {
+        const char *name = scalar(this->node(pair->key));
+        if(strcmp(name, "pseudo_classes") != 0) add_property(pseudo_classes, name, this->node(pair->value));
+      }
+    }
+
+    void CompiledTheme::Builder::add_property(PseudoClasses pseudo_classes, const char *name, yaml_node_t *node)
+    {
+      if(strcmp(name, "margin") == 0)
+        add_int_edges(AttributeType::MARGIN_TOP, pseudo_classes, node);
+      else if(strcmp(name, "border") == 0)
+        add_int_edges(AttributeType::BORDER_TOP, pseudo_classes, node);
+      else if(strcmp(name, "padding") == 0)
+        add_int_edges(AttributeType::PADDING_TOP, pseudo_classes, node);
+      else if(strcmp(name, "foreground_color") == 0)
+        _M_attributes.push_back(new_color_attribute(AttributeType::FOREGROUND_COLOR, pseudo_classes, node));
+      else if(strcmp(name, "border_radius") == 0)
+        add_real_corners(AttributeType::BORDER_RADIUS_TOP_LEFT, pseudo_classes, node);
+      else if(strcmp(name, "padding_radius") == 0)
+        add_real_corners(AttributeType::PADDING_RADIUS_TOP_LEFT, pseudo_classes, node);
+      else if(strcmp(name, "background_color") == 0)
+        _M_attributes.push_back(new_color_attribute(AttributeType::BACKGROUND_COLOR, pseudo_classes, node));
+      else if(strcmp(name, "background_gradient") == 0)
+        _M_attributes.push_back(new_gradient_attribute(AttributeType::BACKGROUND_GRADIENT, pseudo_classes, node));
+      else if(strcmp(name, "border_color") == 0)
+        add_color_edges(AttributeType::BORDER_COLOR_TOP, pseudo_classes, node);
+      else if(strcmp(name, "border_gradient") == 0)
+        add_gradient_edges(AttributeType::BORDER_GRADIENT_TOP, pseudo_classes, node);
+      else if(strcmp(name, "box_shadow") == 0)
+        _M_attributes.push_back(new_box_shadow_attribute(pseudo_classes, node));
+      else
+        throw FileFormatException("unknown theme property");
+    }
+
+    void CompiledTheme::Builder::add_int_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      vector<yaml_node_t *> value_nodes;
+      node_items(node, value_nodes);
+      vector<int32_t> values;
+      for(auto value_node : value_nodes) values.push_back(int_scalar(value_node));
+      int32_t edges[4];
+      expand_four_values(values, edges);
+      for(uint32_t i = 0; i < 4; i++) {
+        Attribute attribute = Attribute();
+        attribute.type = static_cast<uint32_t>(first_type) + i;
+        attribute.pseudo_classes = static_cast<uint32_t>(pseudo_classes);
+        attribute.values[0] = edges[i];
+        _M_attributes.push_back(attribute);
+      }
+    }
+
+    void CompiledTheme::Builder::add_real_corners(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      vector<yaml_node_t *> value_nodes;
+      node_items(node, value_nodes);
+      vector<double> values;
+      for(auto value_node : value_nodes) values.push_back(real_scalar(value_node));
+      double corners[4];
+      expand_four_values(values, corners);
+      for(uint32_t i = 0; i < 4; i++) {
+        Attribute attribute = Attribute();
+        attribute.type = static_cast<uint32_t>(first_type) + i;
+        attribute.pseudo_classes = static_cast<uint32_t>(pseudo_classes);
+        attribute.real_value = corners[i];
+        _M_attributes.push_back(attribute);
+      }
+    }
+
+    void CompiledTheme::Builder::add_color_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      vector<yaml_node_t *> value_nodes;
+      node_items(node, value_nodes);
+      yaml_node_t *edge_nodes[4];
+      expand_four_values(value_nodes, edge_nodes);
+      for(uint32_t i = 0; i < 4; i++) {
+        AttributeType type = static_cast<AttributeType>(static_cast<uint32_t>(first_type) + i);
+        _M_attributes.push_back(new_color_attribute(type, pseudo_classes, edge_nodes[i]));
+      }
+    }
+
+    void CompiledTheme::Builder::add_gradient_edges(AttributeType first_type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      vector<yaml_node_t *> value_nodes;
+      node_items(node, value_nodes);
+      yaml_node_t *edge_nodes[4];
+      expand_four_values(value_nodes, edge_nodes);
+      for(uint32_t i = 0; i < 4; i++) {
+        AttributeType type = static_cast<AttributeType>(static_cast<uint32_t>(first_type) + i);
+        _M_attributes.push_back(new_gradient_attribute(type, pseudo_classes, edge_nodes[i]));
+      }
+    }
+
+    CompiledTheme::Attribute CompiledTheme::Builder::new_color_attribute(AttributeType type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      Attribute attribute = Attribute();
+      attribute.type = static_cast<uint32_t>(type);
+      attribute.pseudo_classes = static_cast<uint32_t>(pseudo_classes);
+      attribute.color = color_scalar(node);
+      return attribute;
+    }
+
+    CompiledTheme::Attribute CompiledTheme::Builder::new_gradient_attribute(AttributeType type, PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      if(node->type != YAML_MAPPING_NODE) throw FileFormatException("theme gradient isn't YAML mapping");
+      Attribute attribute = Attribute();
+      attribute.type = static_cast<uint32_t>(type);
+      attribute.pseudo_classes = static_cast<uint32_t>(pseudo_classes);
+      attribute.values[0] = static_cast<int32_t>(GradientType::LINEAR);
+      attribute.values[1] = static_cast<int32_t>(Direction::TOP_TO_BOTTOM);
+      attribute.values[2] = _M_color_stops.size();
+      for(yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair != node->data.mapping.pairs.top; pair++) {
+        const char *name = scalar(this->node(pair->key));
+        yaml_node_t *value_node = this->node(pair->value);
+        if(strcmp(name, "type") == 0) {
+          const char *value = scalar(value_node);
+          if(strcmp(value, "linear") == 0)
+            attribute.values[0] = static_cast<int32_t>(GradientType::LINEAR);
+          else if(strcmp(value, "radial") == 0)
+            attribute.values[0] = static_cast<int32_t>(GradientType::RADIAL);
+          else
+            throw FileFormatException("unknown theme gradient type");
+        } else if(strcmp(name, "direction") == 0) {
+          const char *value = scalar(value_node);
+          if(strcmp(value, "top_to_bottom") == 0)
+            attribute.values[1] = static_cast<int32_t>(Direction::TOP_TO_BOTTOM);
+          else if(strcmp(value, "left_to_right") == 0)
+            attribute.values[1] = static_cast<int32_t>(Direction::LEFT_TO_RIGHT);
+          else if(strcmp(value, "top_left_to_bottom_right") == 0)
+            attribute.values[1] = static_cast<int32_t>(Direction::TOP_LEFT_TO_BOTTOM_RIGHT);
+          else if(strcmp(value, "top_right_to_bottom_left") == 0)
+            attribute.values[1] = static_cast<int32_t>(Direction::TOP_RIGHT_TO_BOTTOM_LEFT);
+          else
+            throw FileFormatException("unknown theme gradient direction");
+        } else if(strcmp(name, "shape") == 0) {
+          const char *value = scalar(value_node);
+          if(strcmp(value, "ellipse") == 0)
+            attribute.values[1] = static_cast<int32_t>(Shape::ELIPSE);
+          else if(strcmp(value, "circle") == 0)
+            attribute.values[1] = static_cast<int32_t>(Shape::CIRCLE);
+          else
+            throw FileFormatException("unknown theme gradient shape");
+        } else if(strcmp(name, "color_stops") == 0) {
+          if(value_node->type != YAML_SEQUENCE_NODE) throw FileFormatException("theme color stops aren't YAML sequence");
+          for(yaml_node_item_t *item = value_node->data.sequence.items.start; item != value_node->data.sequence.items.top; item++) {
+            yaml_node_t *stop_node = this->node(*item);
+            if(stop_node->type != YAML_SEQUENCE_NODE || stop_node->data.sequence.items.top - stop_node->data.sequence.items.start != 2)
+              throw FileFormatException("invalid theme color stop");
+            ColorStopEntry color_stop;
+            color_stop.offset = real_scalar(this->node(stop_node->data.sequence.items.start[0]));
+            color_stop.color = color_scalar(this->node(stop_node->data.sequence.items.start[1]));
+            color_stop.pad = 0;
+            _M_color_stops.push_back(color_stop);
+          }
+        } else
+          throw FileFormatException("unknown theme gradient property");
+      }
+      attribute.values[3] = _M_color_stops.size() - attribute.values[2];
+      // A radial gradient has the elliptical shape by default.
+      if(attribute.values[0] == static_cast<int32_t>(GradientType::RADIAL) && attribute.values[1] == static_cast<int32_t>(Direction::TOP_TO_BOTTOM))
+        attribute.values[1] = static_cast<int32_t>(Shape::ELIPSE);
+      return attribute;
+    }
+
+    CompiledTheme::Attribute CompiledTheme::Builder::new_box_shadow_attribute(PseudoClasses pseudo_classes, yaml_node_t *node)
+    {
+      if(node->type != YAML_MAPPING_NODE) throw FileFormatException("theme box shadow isn't YAML mapping");
+      Attribute attribute = Attribute();
+      attribute.type = static_cast<uint32_t>(AttributeType::BOX_SHADOW);
+      attribute.pseudo_classes = static_cast<uint32_t>(pseudo_classes);
+      attribute.color = 0xff000000;
+      for(yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair != node->data.mapping.pairs.top; pair++) {
+        const char *name = scalar(this->node(pair->key));
+        yaml_node_t *value_node = this->node(pair->value);
+        if(strcmp(name, "offset") == 0) {
+          if(value_node->type != YAML_SEQUENCE_NODE || value_node->data.sequence.items.top - value_node->data.sequence.items.start != 2)
+            throw FileFormatException("invalid theme box shadow offset");
+          attribute.values[0] = int_scalar(this->node(value_node->data.sequence.items.start[0]));
+          attribute.values[1] = int_scalar(this->node(value_node->data.sequence.items.start[1]));
+        } else if(strcmp(name, "blur_radius") == 0)
+          attribute.values[2] = int_scalar(value_node);
+        else if(strcmp(name, "spread") == 0)
+          attribute.values[3] = int_scalar(value_node);
+        else if(strcmp(name, "color") == 0)
+          attribute.color = color_scalar(value_node);
+        else
+          throw FileFormatException("unknown theme box shadow property");
+      }
+      if(attribute.values[2] < 0) throw FileFormatException("negative theme box shadow blur radius");
+      return attribute;
+    }
+
+    PseudoClasses CompiledTheme::Builder::parse_pseudo_classes(yaml_node_t *node)
+    {
+      vector<yaml_node_t *> name_nodes;
+      node_items(node, name_nodes);
+      PseudoClasses pseudo_classes = PseudoClasses::NONE;
+      for(auto name_node : name_nodes) {
+        const char *name = scalar(name_node);
+        auto iter = find_if(begin(pseudo_class_names), end(pseudo_class_names), [name](const PseudoClassName &pseudo_class_name) {
+          return strcmp(pseudo_class_name.name, name) == 0;
+        });
+        if(iter == end(pseudo_class_names)) throw FileFormatException("unknown theme pseudo class");
+        pseudo_classes |= iter->pseudo_classes;
+      }
+      return pseudo_classes;
+    }
+
+    uint32_t CompiledTheme::Builder::add_string(const char *str)
+    {
+      uint32_t offset = _M_strings.size();
+      _M_strings.append(str, strlen(str) + 1);
+      return offset;
+    }
+
+    yaml_node_t *CompiledTheme::Builder::node(int index)
+    {
+      yaml_node_t *node = yaml_document_get_node(&_M_document, index);
+      if(node == nullptr) throw FileFormatException("invalid YAML theme file");
+      return node;
+    }
+
+    void CompiledTheme::Builder::node_items(yaml_node_t *node, vector<yaml_node_t *> &items)
+    {
+      if(node->type == YAML_SEQUENCE_NODE) {
+        for(yaml_node_item_t *item = node->data.sequence.items.start; item != node->data.sequence.items.top; item++)
+          items.push_back(this->node(*item));
+      } else
+        items.push_back(node);
+    }
+
+    const char *CompiledTheme::Builder::scalar(yaml_node_t *node)
+    {
+      if(node->type != YAML_SCALAR_NODE) throw FileFormatException("theme value isn't YAML scalar");
+      return reinterpret_cast<const char *>(node->data.scalar.value);
+    }
+
+    int32_t CompiledTheme::Builder::int_scalar(yaml_node_t *node)
+    {
+      const char *str = scalar(node);
+      char *end;
+      errno = 0;
+      long value = strtol(str, &end, 10);
+      if(end == str || *end != 0) throw FileFormatException("theme value isn't integer number");
+      if(errno == ERANGE || value < numeric_limits<int32_t>::min() || value > numeric_limits<int32_t>::max())
+        throw FileFormatException("theme integer number is out of range");
+      return value;
+    }
+
+    double CompiledTheme::Builder::real_scalar(yaml_node_t *node)
+    {
+      const char *str = scalar(node);
+      char *end;
+      double value = strtod(str, &end);
+      if(end == str || *end != 0) throw FileFormatException("theme value isn't real number");
+      return value;
+    }
+
+    uint32_t CompiledTheme::Builder::color_scalar(yaml_node_t *node)
+    {
+      // The colors are written as #RRGGBB or #RRGGBBAA like CSS.
+      const char *str = scalar(node);
+      if(strcmp(str, "transparent") == 0) return 0;
+      size_t length = strlen(str);
+      if(str[0] != '#' || (length != 7 && length != 9)) throw FileFormatException("invalid theme color");
+      char *end;
+      unsigned long value = strtoul(str + 1, &end, 16);
+      if(*end != 0) throw FileFormatException("invalid theme color");
+      if(length == 7) return 0xff000000 | value;
+      return ((value & 0xff) << 24) | (value >> 8);
+    }
+
+    bool CompiledTheme::load(const string &file_name, const string &source_file_name)
+    {
+      _M_buffer.clear();
+      if(file_name.empty() || !_M_file.map(file_name)) return false;
+      _M_data = _M_file.data();
+      _M_size = _M_file.size();
+      if(!check(source_file_name)) {
+        _M_file.unmap();
+        _M_data = nullptr;
+        _M_size = 0;
+        return false;
+      }
+      return true;
+    }
+
+    void CompiledTheme::build(const string &source_file_name)
+    {
+      int64_t source_mtime, source_size;
+      if(!source_file_stat(source_file_name, source_mtime, source_size)) throw IOException("can't stat theme file");
+      Builder builder;
+      builder.parse(source_file_name);
+      _M_file.unmap();
+      builder.write(_M_buffer, source_file_name, source_mtime, source_size);
+      _M_data = _M_buffer.data();
+      _M_size = _M_buffer.size();
+    }
+
+    bool CompiledTheme::save(const string &file_name) const
+    {
+      if(file_name.empty() || _M_data == nullptr) return false;
+      // The compiled theme is written to a temporary file and it is renamed,
+      // so other processes never map a partial compiled theme.
+      string tmp_file_name = file_name + ".tmp";
+      FILE *file = fopen(tmp_file_name.c_str(), "wb");
+      if(file == nullptr) return false;
+      bool is_written = (fwrite(_M_data, 1, _M_size, file) == _M_size);
+      if(fclose(file) != 0) is_written = false;
+      if(!is_written || rename(tmp_file_name.c_str(), file_name.c_str()) == -1) {
+        remove(tmp_file_name.c_str());
+        return false;
+      }
+      return true;
+    }
+
+    ImplStyles *CompiledTheme::new_styles(const char *name) const
+    {
+      if(_M_data == nullptr) return nullptr;
+      // The styles are sorted by their names, so the style is found by the
+      // binary search in the mapped file and only its attributes are added.
+      const Style *style_begin = styles();
+      const Style *style_end = style_begin + header()->style_count;
+      const Style *style = lower_bound(style_begin, style_end, name, [this](const Style &style, const char *name) {
+        return strcmp(theme_string(style.name_offset), name) < 0;
+      });
+      if(style == style_end || strcmp(theme_string(style->name_offset), name) != 0) return nullptr;
+      unique_ptr<ImplStyles> impl_styles(new ImplStyles());
+      const Attribute *attribute_end = attributes() + style->first_attribute + style->attribute_count;
+      for(const Attribute *attribute = attributes() + style->first_attribute; attribute != attribute_end; attribute++)
+        add_attribute(impl_styles.get(), *attribute);
+      return impl_styles.release();
+    }
+
+    bool CompiledTheme::check(const string &source_file_name) const
+    {
+      if(_M_size < sizeof(Header)) return false;
+      const Header *tmp_header = header();
+      if(!equal(theme_magic, theme_magic + 8, tmp_header->magic)) return false;
+      if(tmp_header->version != VERSION) return false;
+      if(tmp_header->styles_offset != sizeof(Header)) return false;
+      if(tmp_header->attributes_offset != tmp_header->styles_offset + static_cast<size_t>(tmp_header->style_count) * sizeof(Style)) return false;
+      if(tmp_header->color_stops_offset != tmp_header->attributes_offset + static_cast<size_t>(tmp_header->attribute_count) * sizeof(Attribute)) return false;
+      if(tmp_header->strings_offset != tmp_header->color_stops_offset + static_cast<size_t>(tmp_header->color_stop_count) * sizeof(ColorStopEntry)) return false;
+      if(static_cast<size_t>(tmp_header->strings_offset) + tmp_header->strings_size != _M_size) return false;
+      if(tmp_header->strings_size == 0 || _M_data[_M_size - 1] != 0) return false;
+      if(tmp_header->source_name_offset >= tmp_header->strings_size) return false;
+      if(source_file_name != theme_string(tmp_header->source_name_offset)) return false;
+      // The theme is compiled again if the source file is changed.
+      int64_t source_mtime, source_size;
+      if(!source_file_stat(source_file_name, source_mtime, source_size)) return false;
+      if(tmp_header->source_mtime != source_mtime || tmp_header->source_size != source_size) return false;
+      const Style *tmp_styles = styles();
+      for(size_t i = 0; i < tmp_header->style_count; i++) {
+        if(tmp_styles[i].name_offset >= tmp_header->strings_size) return false;
+        if(tmp_styles[i].first_attribute > tmp_header->attribute_count) return false;
+        if(tmp_styles[i].attribute_count > tmp_header->attribute_count - tmp_styles[i].first_attribute) return false;
+        // The binary search requires the sorted unique names.
+        if(i > 0 && strcmp(theme_string(tmp_styles[i - 1].name_offset), theme_string(tmp_styles[i].name_offset)) >= 0) return false;
+      }
+      const Attribute *tmp_attributes = attributes();
+      for(size_t i = 0; i < tmp_header->attribute_count; i++) {
+        if(tmp_attributes[i].type >= static_cast<uint32_t>(AttributeType::COUNT)) return false;
+        AttributeType type = static_cast<AttributeType>(tmp_attributes[i].type);
+        if(type == AttributeType::BACKGROUND_GRADIENT || (type >= AttributeType::BORDER_GRADIENT_TOP && type <= AttributeType::BORDER_GRADIENT_LEFT)) {
+          if(tmp_attributes[i].values[2] < 0 || tmp_attributes[i].values[3] < 0) return false;
+          if(static_cast<size_t>(tmp_attributes[i].values[2]) + tmp_attributes[i].values[3] > tmp_header->color_stop_count) return false;
+        }
+      }
+      return true;
+    }
+
+    void CompiledTheme::add_attribute(ImplStyles *styles, const Attribute &attribute) const
+    {
+      PseudoClasses pseudo_classes = static_cast<PseudoClasses>(attribute.pseudo_classes);
+      switch(static_cast<AttributeType>(attribute.type)) {
+        case AttributeType::MARGIN_TOP:
+          styles->add_margin_top(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::MARGIN_RIGHT:
+          styles->add_margin_right(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::MARGIN_BOTTOM:
+          styles->add_margin_bottom(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::MARGIN_LEFT:
+          styles->add_margin_left(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::BORDER_TOP:
+          styles->add_border_top(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::BORDER_RIGHT:
+          styles->add_border_right(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::BORDER_BOTTOM:
+          styles->add_border_bottom(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::BORDER_LEFT:
+          styles->add_border_left(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::PADDING_TOP:
+          styles->add_padding_top(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::PADDING_RIGHT:
+          styles->add_padding_right(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::PADDING_BOTTOM:
+          styles->add_padding_bottom(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::PADDING_LEFT:
+          styles->add_padding_left(pseudo_classes, attribute.values[0]);
+          break;
+        case AttributeType::FOREGROUND_COLOR:
+          styles->add_foreground_color(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BORDER_RADIUS_TOP_LEFT:
+          styles->add_border_radius_top_left(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::BORDER_RADIUS_TOP_RIGHT:
+          styles->add_border_radius_top_right(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::BORDER_RADIUS_BOTTOM_RIGHT:
+          styles->add_border_radius_bottom_right(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::BORDER_RADIUS_BOTTOM_LEFT:
+          styles->add_border_radius_bottom_left(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::PADDING_RADIUS_TOP_LEFT:
+          styles->add_padding_radius_top_left(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::PADDING_RADIUS_TOP_RIGHT:
+          styles->add_padding_radius_top_right(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::PADDING_RADIUS_BOTTOM_RIGHT:
+          styles->add_padding_radius_bottom_right(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::PADDING_RADIUS_BOTTOM_LEFT:
+          styles->add_padding_radius_bottom_left(pseudo_classes, attribute.real_value);
+          break;
+        case AttributeType::BACKGROUND_COLOR:
+          styles->add_background_color(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BACKGROUND_GRADIENT:
+          styles->add_background_gradient(pseudo_classes, new_gradient(attribute));
+          break;
+        case AttributeType::BORDER_COLOR_TOP:
+          styles->add_border_color_top(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BORDER_COLOR_RIGHT:
+          styles->add_border_color_right(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BORDER_COLOR_BOTTOM:
+          styles->add_border_color_bottom(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BORDER_COLOR_LEFT:
+          styles->add_border_color_left(pseudo_classes, Color(attribute.color));
+          break;
+        case AttributeType::BORDER_GRADIENT_TOP:
+          styles->add_border_gradient_top(pseudo_classes, new_gradient(attribute));
+          break;
+        case AttributeType::BORDER_GRADIENT_RIGHT:
+          styles->add_border_gradient_right(pseudo_classes, new_gradient(attribute));
+          break;
+        case AttributeType::BORDER_GRADIENT_BOTTOM:
+          styles->add_border_gradient_bottom(pseudo_classes, new_gradient(attribute));
+          break;
+        case AttributeType::BORDER_GRADIENT_LEFT:
+          styles->add_border_gradient_left(pseudo_classes, new_gradient(attribute));
+          break;
+        case AttributeType::BOX_SHADOW:
+          styles->add_box_shadow(pseudo_classes, BoxShadow(Point<int>(attribute.values[0], attribute.values[1]), attribute.values[2], attribute.values[3], Color(attribute.color)));
+          break;
+        case AttributeType::COUNT:
+          break;
+      }
+    }
+
+    Gradient *CompiledTheme::new_gradient(const Attribute &attribute) const
+    {
+      GradientUniquePtr gradient;
+      if(attribute.values[0] == static_cast<int32_t>(GradientType::RADIAL)) {
+        RadialGradient *radial_gradient = new RadialGradient();
+        gradient = GradientUniquePtr(radial_gradient);
+        radial_gradient->shape = static_cast<Shape>(attribute.values[1]);
+      } else {
+        LinearGradient *linear_gradient = new LinearGradient();
+        gradient = GradientUniquePtr(linear_gradient);
+        linear_gradient->direction = static_cast<Direction>(attribute.values[1]);
+      }
+      const ColorStopEntry *color_stop_end = color_stops() + attribute.values[2] + attribute.values[3];
+      for(const ColorStopEntry *color_stop = color_stops() + attribute.values[2]; color_stop != color_stop_end; color_stop++)
+        gradient->color_stops.push_back(ColorStop(color_stop->offset, Color(color_stop->color)));
+      return gradient.release();
+    }
+
+    const CompiledTheme::Header *CompiledTheme::header() const
+    { return reinterpret_cast<const Header *>(_M_data); }
+
+    const CompiledTheme::Style *CompiledTheme::styles() const
+    { return reinterpret_cast<const Style *>(_M_data + header()->styles_offset); }
+
+    const CompiledTheme::Attribute *CompiledTheme::attributes() const
+    { return reinterpret_cast<const Attribute *>(_M_data + header()->attributes_offset); }
+
+    const CompiledTheme::ColorStopEntry *CompiledTheme::color_stops() const
+    { return reinterpret_cast<const ColorStopEntry *>(_M_data + header()->color_stops_offset); }
+
+    const char *CompiledTheme::theme_string(uint32_t offset) const
+    { return reinterpret_cast<const char *>(_M_data + header()->strings_offset + offset); }
+
+    //
+    // A Theme class.
+    //
+
+    constexpr size_t Theme::NAME_ID_CHUNK_SIZE;
+    constexpr size_t Theme::MAX_NAME_ID_CHUNK_COUNT;
+
+    Theme::Theme() :
+      _M_name_id_count(0), _M_is_loaded(false)
+    {
+      for(auto &chunk : _M_name_id_chunks) chunk.store(nullptr, memory_order_relaxed);
+    }
+
+    Theme::~Theme()
+    {
+      for(auto &chunk : _M_name_id_chunks) delete [] chunk.load(memory_order_relaxed);
+    }
+
+    void Theme::load(const string &file_name)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_is_loaded.store(true, memory_order_release);
+      unlocked_load(file_name);
+    }
+
+    size_t Theme::intern_name(const char *name)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      if(!_M_is_loaded.load(memory_order_relaxed)) load_default_theme();
+      auto iter = _M_name_ids.find(name);
+      if(iter != _M_name_ids.end()) return iter->second;
+      size_t name_id = _M_name_ids.size();
+      if(name_id >= NAME_ID_CHUNK_SIZE * MAX_NAME_ID_CHUNK_COUNT) throw RuntimeException("too many style names");
+      // The chunks of the table are never moved, so the readers can use them
+      // while new chunks are added.
+      if(_M_name_id_chunks[name_id / NAME_ID_CHUNK_SIZE].load(memory_order_relaxed) == nullptr) {
+        atomic<Styles *> *chunk = new atomic<Styles *>[NAME_ID_CHUNK_SIZE];
+        for(size_t i = 0; i < NAME_ID_CHUNK_SIZE; i++) chunk[i].store(&_M_default_styles, memory_order_relaxed);
+        _M_name_id_chunks[name_id / NAME_ID_CHUNK_SIZE].store(chunk, memory_order_release);
+      }
+      _M_name_ids.insert(make_pair(string(name), name_id));
+      unlocked_set_name_id_styles(name_id, unlocked_find_styles_by_name(name));
+      _M_name_id_count.store(name_id + 1, memory_order_release);
+      return name_id;
+    }
+
+    Styles *Theme::find_styles_by_name_id(size_t name_id)
+    {
+      if(!_M_is_loaded.load(memory_order_acquire)) {
+        lock_guard<mutex> guard(_M_mutex);
+        if(!_M_is_loaded.load(memory_order_relaxed)) load_default_theme();
+      }
+      // The styles for the interned names are published by the release stores,
+      // so they are found without locking.
+      if(name_id >= _M_name_id_count.load(memory_order_acquire)) return &_M_default_styles;
+      atomic<Styles *> *chunk = _M_name_id_chunks[name_id / NAME_ID_CHUNK_SIZE].load(memory_order_acquire);
+      return chunk[name_id % NAME_ID_CHUNK_SIZE].load(memory_order_acquire);
+    }
+
+    void Theme::unlocked_set_name_id_styles(size_t name_id, Styles *styles)
+    {
+      atomic<Styles *> *chunk = _M_name_id_chunks[name_id / NAME_ID_CHUNK_SIZE].load(memory_order_relaxed);
+      chunk[name_id % NAME_ID_CHUNK_SIZE].store(styles, memory_order_release);
+    }
+
+    void Theme::unlocked_load(const string &file_name)
+    {
+      // The compiled theme is mapped if it is up to date; otherwise, the YAML
+      // theme is parsed and it is compiled again.
+      string compiled_file_name = theme_cache_file_name(file_name);
+      unique_ptr<CompiledTheme> compiled_theme(new CompiledTheme());
+      if(!compiled_theme->load(compiled_file_name, file_name)) {
+        compiled_theme->build(file_name);
+        compiled_theme->save(compiled_file_name);
+      }
+      // The compiled theme stays mapped and the styles are only created from
+      // it when they are found, so loading doesn't depend on the theme size.
+      // The readers find the styles without locking and the widgets keep them
+      // until the styles generation changes, so the old styles are retired
+      // instead of deleted. The styles don't refer to the compiled theme, so
+      // the old compiled theme is unmapped.
+      StylesMap styles;
+      _M_styles.swap(styles);
+      _M_retired_styles.push_back(move(styles));
+      _M_compiled_theme = move(compiled_theme);
+      // The styles of the new theme are new objects with empty caches, but the
+      // default styles and the shadows outlive the theme, so their caches are
+      // cleared.
+      _M_default_styles.clear_caches();
+      shadow_cache().clear();
+      // The interned names keep their identifiers for the new theme.
+      for(auto &pair : _M_name_ids)
+        unlocked_set_name_id_styles(pair.second, unlocked_find_styles_by_name(pair.first));
+      increase_styles_generation();
+    }
+
+    Styles *Theme::unlocked_find_styles_by_name(const string &name)
+    {
+      auto iter = _M_styles.find(name);
+      if(iter != _M_styles.end()) return iter->second.get();
+      if(_M_compiled_theme.get() == nullptr) return &_M_default_styles;
+      unique_ptr<ImplStyles> styles(_M_compiled_theme->new_styles(name.c_str()));
+      if(styles.get() == nullptr) return &_M_default_styles;
+      return _M_styles.insert(make_pair(name, move(styles))).first->second.get();
+    }
+
+    void Theme::load_default_theme()
+    {
+      _M_is_loaded.store(true, memory_order_release);
+      string file_name;
+      if(!find_default_theme_file_name(file_name)) return;
+      // The widgets are drawn with the default styles if the default theme
+      // can't be loaded, so the error is only reported.
+      try {
+        unlocked_load(file_name);
+      } catch(Exception &e) {
+        fprintf(stderr, "waytk: can't load theme %s: %s\n", file_name.c_str(), e.what());
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    Theme &theme()
+    {
+      static Theme theme;
+      return theme;
+    }
+  }
+
+  //
+  // Functions.
+  //
+
+  void load_theme(const string &file_name)
+  { priv::theme().load(file_name); }
+
+  size_t intern_style_name(const char *name)
+  { return priv::theme().intern_name(name); }
+
+  Styles *find_styles_by_name_id(size_t name_id)
+  { return priv::theme().find_styles_by_name_id(name_id); }
+
+  Styles *find_styles(const char *name)
+  { return find_styles_by_name_id(intern_style_name(name)); }
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _THEME_HPP
+#define _THEME_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <waytk.hpp>
+#include "icon_theme.hpp"
+#include "styles.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    typedef std::unordered_map<std::string, std::unique_ptr<ImplStyles>> StylesMap;
+
+    class CompiledTheme
+    {
+      struct Header;
+      struct Style;
+      struct Attribute;
+      struct ColorStopEntry;
+      class Builder;
+
+      MappedFile _M_file;
+      std::vector<std::uint8_t> _M_buffer;
+      const std::uint8_t *_M_data;
+      std::size_t _M_size;
+    public:
+      static constexpr std::uint32_t VERSION = 2;
+
+      CompiledTheme() :
+        _M_data(nullptr), _M_size(0) {}
+
+      bool load(const std::string &file_name, const std::string &source_file_name);
+
+      void build(const std::string &source_file_name);
+
+      bool save(const std::string &file_name) const;
+
+      ImplStyles *new_styles(const char *name) const;
+    private:
+      bool check(const std::string &source_file_name) const;
+
+      void add_attribute(ImplStyles *styles, const Attribute &attribute) const;
+
+      Gradient *new_gradient(const Attribute &attribute) const;
+
+      const Header *header() const;
+
+      const Style *styles() const;
+
+      const Attribute *attributes() const;
+
+      const ColorStopEntry *color_stops() const;
+
+      const char *theme_string(std::uint32_t offset) const;
+    };
+
+    class Theme
+    {
+    public:
+      static constexpr std::size_t NAME_ID_CHUNK_SIZE = 256;
+      static constexpr std::size_t MAX_NAME_ID_CHUNK_COUNT = 1024;
+    private:
+      std::mutex _M_mutex;
+      std::unique_ptr<CompiledTheme> _M_compiled_theme;
+      StylesMap _M_styles;
+      std::vector<StylesMap> _M_retired_styles;
+      ImplStyles _M_default_styles;
+      std::unordered_map<std::string, std::size_t> _M_name_ids;
+      std::atomic<std::atomic<Styles *> *> _M_name_id_chunks[MAX_NAME_ID_CHUNK_COUNT];
+      std::atomic<std::size_t> _M_name_id_count;
+      std::atomic<bool> _M_is_loaded;
+    public:
+      Theme();
+
+      ~Theme();
+
+      void load(const std::string &file_name);
+
+      std::size_t intern_name(const char *name);
+
+      Styles *find_styles_by_name_id(std::size_t name_id);
+    private:
+      void unlocked_load(const std::string &file_name);
+
+      void unlocked_set_name_id_styles(std::size_t name_id, Styles *styles);
+
+      Styles *unlocked_find_styles_by_name(const std::string &name);
+
+      void load_default_theme();
+    };
+
+    Theme &theme();
+  }
+}
+
+#endif
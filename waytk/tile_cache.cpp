@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <sstream>
+#include <vector>
+#include "task_queue.hpp"
+#include "tile_cache.hpp"
+
+using namespace std;
+
+namespace waytk
+{
+  namespace priv
+  {
+    //
+    // A DirectoryTiledImageSource class.
+    //
+
+    DirectoryTiledImageSource::DirectoryTiledImageSource(const string &dir_name) :
+      _M_dir_name(dir_name)
+    {
+      vector<uint8_t> data;
+      read_file(dir_name + "/info", data);
+      istringstream iss(string(data.begin(), data.end()));
+      if(!(iss >> _M_size.width >> _M_size.height >> _M_tile_size.width))
+        throw FileFormatException("invalid tiled image info file");
+      _M_tile_size.height = _M_tile_size.width;
+      if(_M_size.width <= 0 || _M_size.height <= 0 || _M_tile_size.width <= 0)
+        throw FileFormatException("invalid tiled image info file");
+      _M_level_count = 1;
+      while(tiled_image_level_size(this, _M_level_count - 1).width > _M_tile_size.width ||
+        tiled_image_level_size(this, _M_level_count - 1).height > _M_tile_size.height)
+        _M_level_count++;
+    }
+
+    DirectoryTiledImageSource::~DirectoryTiledImageSource() {}
+
+    Dimension<int> DirectoryTiledImageSource::size()
+    { return _M_size; }
+
+    Dimension<int> DirectoryTiledImageSource::tile_size()
+    { return _M_tile_size; }
+
+    int DirectoryTiledImageSource::level_count()
+    { return _M_level_count; }
+
+    CanvasImage *DirectoryTiledImageSource::load_tile(int level, const Point<int> &tile_point)
+    {
+      ostringstream oss;
+      oss << _M_dir_name << "/" << level << "/" << tile_point.x << "_" << tile_point.y << ".png";
+      vector<uint8_t> data;
+      read_file(oss.str(), data);
+      return new_canvas_image_from_data(data, false);
+    }
+
+    //
+    // A TileCache class.
+    //
+
+    CanvasImageSharedFuture TileCache::request(const shared_ptr<TiledImageSource> &source, int level, const Point<int> &tile_point, const function<void ()> &listener)
+    {
+      Key key { source.get(), level, tile_point };
+      shared_ptr<ImagePromise> promise;
+      CanvasImageSharedFuture image_future;
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(key);
+        if(iter != _M_entries.end()) {
+          // The listener of a pending load is notified by the loading.
+          if(listener && iter->second.promise.get() != nullptr) iter->second.listeners.push_back(listener);
+          _M_lru_keys.splice(_M_lru_keys.begin(), _M_lru_keys, iter->second.lru_iter);
+          return iter->second.image_future;
+        }
+        promise = shared_ptr<ImagePromise>(new ImagePromise());
+        image_future = promise->get_future().share();
+        _M_lru_keys.push_front(key);
+        Entry &entry = _M_entries[key];
+        entry.source = source;
+        entry.image_future = image_future;
+        entry.promise = promise;
+        if(listener) entry.listeners.push_back(listener);
+        entry.byte_count = 0;
+        entry.lru_iter = _M_lru_keys.begin();
+      }
+      background_task_queue().push([this, key, source, promise]() { load(key, source, promise); });
+      return image_future;
+    }
+
+    shared_ptr<CanvasImage> TileCache::find(TiledImageSource *source, int level, const Point<int> &tile_point)
+    {
+      Key key { source, level, tile_point };
+      lock_guard<mutex> guard(_M_mutex);
+      auto iter = _M_entries.find(key);
+      if(iter == _M_entries.end() || iter->second.promise.get() != nullptr) return shared_ptr<CanvasImage>();
+      _M_lru_keys.splice(_M_lru_keys.begin(), _M_lru_keys, iter->second.lru_iter);
+      try {
+        return iter->second.image_future.get();
+      } catch(...) {
+        // The tile failed to load.
+        return shared_ptr<CanvasImage>();
+      }
+    }
+
+    size_t TileCache::byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_byte_count;
+    }
+
+    size_t TileCache::max_byte_count()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      return _M_max_byte_count;
+    }
+
+    void TileCache::set_max_byte_count(size_t count)
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_max_byte_count = count;
+      evict();
+    }
+
+    void TileCache::clear()
+    {
+      lock_guard<mutex> guard(_M_mutex);
+      _M_entries.clear();
+      _M_lru_keys.clear();
+      _M_byte_count = 0;
+    }
+
+    void TileCache::load(const Key &key, const shared_ptr<TiledImageSource> &source, const shared_ptr<ImagePromise> &promise)
+    {
+      shared_ptr<CanvasImage> image;
+      size_t byte_count;
+      try {
+        image = shared_ptr<CanvasImage>(source->load_tile(key.level, key.tile_point));
+        Dimension<int> size = image->size();
+        byte_count = static_cast<size_t>(size.width) * size.height * 4;
+      } catch(...) {
+        // A failed load is cached, so a missing tile isn't loaded again for
+        // each drawing. It is evicted like a small tile.
+        promise->set_exception(current_exception());
+        notify_listeners(key, promise, FAILED_TILE_BYTE_COUNT);
+        return;
+      }
+      promise->set_value(image);
+      notify_listeners(key, promise, byte_count);
+    }
+
+    void TileCache::notify_listeners(const Key &key, const shared_ptr<ImagePromise> &promise, size_t byte_count)
+    {
+      vector<function<void ()>> listeners;
+      {
+        lock_guard<mutex> guard(_M_mutex);
+        auto iter = _M_entries.find(key);
+        if(iter != _M_entries.end() && iter->second.promise == promise) {
+          listeners.swap(iter->second.listeners);
+          iter->second.promise.reset();
+          iter->second.byte_count = byte_count;
+          _M_byte_count += byte_count;
+          evict();
+        }
+      }
+      for(auto &listener : listeners) listener();
+    }
+
+    void TileCache::evict()
+    {
+      auto lru_iter = _M_lru_keys.end();
+      while(_M_byte_count > _M_max_byte_count && lru_iter != _M_lru_keys.begin()) {
+        lru_iter--;
+        auto iter = _M_entries.find(*lru_iter);
+        // The pending loads aren't evicted.
+        if(iter->second.promise.get() != nullptr) continue;
+        _M_byte_count -= iter->second.byte_count;
+        _M_entries.erase(iter);
+        lru_iter = _M_lru_keys.erase(lru_iter);
+      }
+    }
+
+    //
+    // Functions.
+    //
+
+    TileCache &tile_cache()
+    {
+      static TileCache cache;
+      return cache;
+    }
+
+    Dimension<int> tiled_image_level_size(TiledImageSource *source, int level)
+    {
+      Dimension<int> size = source->size();
+      int divisor = 1 << level;
+      return Dimension<int>((size.width + divisor - 1) / divisor, (size.height + divisor - 1) / divisor);
+    }
+  }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016 Łukasz Szpakowski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _TILE_CACHE_HPP
+#define _TILE_CACHE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "image_loader.hpp"
+
+namespace waytk
+{
+  namespace priv
+  {
+    class DirectoryTiledImageSource : public TiledImageSource
+    {
+      std::string _M_dir_name;
+      Dimension<int> _M_size;
+      Dimension<int> _M_tile_size;
+      int _M_level_count;
+    public:
+      explicit DirectoryTiledImageSource(const std::string &dir_name);
+
+      virtual ~DirectoryTiledImageSource();
+
+      virtual Dimension<int> size();
+
+      virtual Dimension<int> tile_size();
+
+      virtual int level_count();
+
+      virtual CanvasImage *load_tile(int level, const Point<int> &tile_point);
+    };
+
+    class TileCache
+    {
+      typedef std::promise<std::shared_ptr<CanvasImage>> ImagePromise;
+
+      struct Key
+      {
+        TiledImageSource *source;
+        int level;
+        Point<int> tile_point;
+
+        bool operator==(const Key &key) const
+        { return source == key.source && level == key.level && tile_point == key.tile_point; }
+      };
+
+      struct KeyHash
+      {
+        std::size_t operator()(const Key &key) const
+        {
+          std::size_t hash = std::hash<TiledImageSource *>()(key.source);
+          hash = hash * 31 + std::hash<int>()(key.level);
+          hash = hash * 31 + std::hash<int>()(key.tile_point.x);
+          return hash * 31 + std::hash<int>()(key.tile_point.y);
+        }
+      };
+
+      struct Entry
+      {
+        std::shared_ptr<TiledImageSource> source;
+        CanvasImageSharedFuture image_future;
+        std::shared_ptr<ImagePromise> promise;
+        std::vector<std::function<void ()>> listeners;
+        std::size_t byte_count;
+        std::list<Key>::iterator lru_iter;
+      };
+
+      std::mutex _M_mutex;
+      std::unordered_map<Key, Entry, KeyHash> _M_entries;
+      std::list<Key> _M_lru_keys;
+      std::size_t _M_byte_count;
+      std::size_t _M_max_byte_count;
+    public:
+      static constexpr std::size_t DEFAULT_MAX_BYTE_COUNT = 128 * 1024 * 1024;
+      static constexpr std::size_t FAILED_TILE_BYTE_COUNT = 256;
+
+      TileCache() :
+        _M_byte_count(0), _M_max_byte_count(DEFAULT_MAX_BYTE_COUNT) {}
+
+      CanvasImageSharedFuture request(const std::shared_ptr<TiledImageSource> &source, int level, const Point<int> &tile_point)
+      { return request(source, level, tile_point, std::function<void ()>()); }
+
+      CanvasImageSharedFuture request(const std::shared_ptr<TiledImageSource> &source, int level, const Point<int> &tile_point, const std::function<void ()> &listener);
+
+      std::shared_ptr<CanvasImage> find(TiledImageSource *source, int level, const Point<int> &tile_point);
+
+      std::size_t byte_count();
+
+      std::size_t max_byte_count();
+
+      void set_max_byte_count(std::size_t count);
+
+      void clear();
+    private:
+      void load(const Key &key, const std::shared_ptr<TiledImageSource> &source, const std::shared_ptr<ImagePromise> &promise);
+
+      void notify_listeners(const Key &key, const std::shared_ptr<ImagePromise> &promise, std::size_t byte_count);
+
+      void evict();
+    };
+
+    TileCache &tile_cache();
+
+    Dimension<int> tiled_image_level_size(TiledImageSource *source, int level);
+  }
+}
+
+#endif
@@ -19,7 +19,13 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
 #include "waytk_priv.hpp"
 
 using namespace std;
@@ -29,7 +35,14 @@ namespace waytk
   namespace priv
   {
     namespace
-    { list<Surface *> visible_modal_surface_stack; }
+    {
+      list<Surface *> visible_modal_surface_stack;
+
+      // The tasks are posted by other threads and they are run by the main
+      // loop after it is woken up by the event file descriptor.
+      mutex main_loop_task_mutex;
+      deque<function<void ()>> main_loop_tasks;
+    }
 
     Surface *top_visible_modal_surface()
     { return visible_modal_surface_stack.empty() ? visible_modal_surface_stack.back() : nullptr; }
@@ -49,5 +62,46 @@ namespace waytk
       }
       return false;
     }
+
+    void post_main_loop_task(const function<void ()> &task)
+    {
+      {
+        lock_guard<mutex> guard(main_loop_task_mutex);
+        main_loop_tasks.push_back(task);
+      }
+      uint64_t value = 1;
+      if(write(main_loop_wakeup_fd(), &value, sizeof(value)) == -1) {
+        // The counter of the event file descriptor can't overflow because
+        // the main loop resets it, so the main loop is already woken up.
+      }
+    }
+
+    int main_loop_wakeup_fd()
+    {
+      static int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      if(fd == -1) throw IOException("can't create event file descriptor");
+      return fd;
+    }
+
+    void run_main_loop_tasks()
+    {
+      uint64_t value;
+      if(read(main_loop_wakeup_fd(), &value, sizeof(value)) == -1) {
+        // The event file descriptor wasn't signaled.
+      }
+      deque<function<void ()>> tasks;
+      {
+        lock_guard<mutex> guard(main_loop_task_mutex);
+        tasks.swap(main_loop_tasks);
+      }
+      // A failed task doesn't prevent the other tasks from running.
+      for(auto &task : tasks) {
+        try {
+          task();
+        } catch(exception &e) {
+          fprintf(stderr, "waytk: main loop task failed: %s\n", e.what());
+        }
+      }
+    }
   }
 }
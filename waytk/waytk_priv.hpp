@@ -22,6 +22,7 @@
 #ifndef _WAYTK_PRIV_HPP
 #define _WAYTK_PRIV_HPP
 
+#include <functional>
 #include <waytk.hpp>
 
 namespace waytk
@@ -33,6 +34,12 @@ namespace waytk
     void push_visible_modal_surface(Surface *surface);
 
     bool delete_visible_modal_surface(Surface *surface);
+
+    void post_main_loop_task(const std::function<void ()> &task);
+
+    int main_loop_wakeup_fd();
+
+    void run_main_loop_tasks();
   }
 }
 
@@ -20,9 +20,10 @@
  * THE SOFTWARE.
  */
 #include <algorithm>
-#include <cstring>
 #include <limits>
 #include <utility>
+#include "icon_theme.hpp"
+#include "styles.hpp"
 #include "widget_viewport.hpp"
 
 using namespace std;
@@ -174,12 +175,21 @@ namespace waytk
     void WidgetViewport::update_widget_size(Canvas *canvas, const Dimension<int> &area_size) {}
   }
 
+  namespace
+  {
+    Rectangle<int> extend_rect(const Rectangle<int> &rect, const Edges<int> &edges)
+    {
+      return Rectangle<int>(rect.x - edges.left, rect.y - edges.top,
+                            rect.width + edges.left + edges.right, rect.height + edges.top + edges.bottom);
+    }
+  }
+
   //
   // An Icon class.
   //
 
   shared_ptr<CanvasImage> Icon::image(IconSize size) const
-  { throw exception(); }
+  { return priv::icon_theme().image(_M_name, size); }
 
   //
   // A Viewport class.
@@ -206,8 +216,14 @@ namespace waytk
     _M_bounds(0, 0, 0, 0),
     _M_parent(nullptr),
     _M_style_name(nullptr),
+    _M_style_name_id(0),
     _M_styles(nullptr),
+    _M_styles_generation(0),
+    _M_has_resolved_styles(false),
+    _M_resolved_pseudo_classes(PseudoClasses::NONE),
     _M_content_size(0, 0),
+    _M_has_layer(false),
+    _M_is_layer_valid(false),
     _M_on_touch_callback([](Widget *widget, const Pointer &pointer, const Point<double> &point, TouchState state) {}),
     _M_on_pointer_motion_callback([](Widget *widget, const Point<double> &point) {}),
     _M_on_pointer_leave_callback([](Widget *widget) {}),
@@ -221,9 +237,9 @@ namespace waytk
   {
     _M_is_enabled = is_enabled;
     if(_M_is_enabled)
-      _M_pseudo_classes &= ~PseudoClasses::DISABLED;
+      set_pseudo_classes(_M_pseudo_classes & ~PseudoClasses::DISABLED);
     else
-      _M_pseudo_classes |= PseudoClasses::DISABLED;
+      set_pseudo_classes(_M_pseudo_classes | PseudoClasses::DISABLED);
   }
 
   bool Widget::set_focus(bool has_focus)
@@ -233,7 +249,7 @@ namespace waytk
     if(has_focus) {
       if(tmp_surface->_M_focused_widget != nullptr) {
         tmp_surface->_M_focused_widget->_M_has_focus = false;
-        tmp_surface->_M_focused_widget->_M_pseudo_classes &= ~PseudoClasses::FOCUS;
+        tmp_surface->_M_focused_widget->set_pseudo_classes(tmp_surface->_M_focused_widget->_M_pseudo_classes & ~PseudoClasses::FOCUS);
       }
       tmp_surface->_M_focused_widget = this;
     } else {
@@ -242,12 +258,44 @@ namespace waytk
     }
     _M_has_focus = has_focus;
     if(_M_has_focus)
-      _M_pseudo_classes |= PseudoClasses::FOCUS;
+      set_pseudo_classes(_M_pseudo_classes | PseudoClasses::FOCUS);
     else
-      _M_pseudo_classes &= ~PseudoClasses::FOCUS;
+      set_pseudo_classes(_M_pseudo_classes & ~PseudoClasses::FOCUS);
     return true;
   }
 
+  void Widget::set_layer(bool has_layer)
+  {
+    _M_has_layer = has_layer;
+    if(!_M_has_layer) _M_layer_image.reset();
+    invalidate();
+  }
+
+  void Widget::set_pseudo_classes(PseudoClasses pseudo_classes)
+  {
+    if(_M_pseudo_classes == pseudo_classes) return;
+    damage(visual_bounds());
+    _M_pseudo_classes = pseudo_classes;
+    invalidate();
+  }
+
+  Rectangle<int> Widget::visual_bounds()
+  { return extend_rect(_M_bounds, visual_overflow()); }
+
+  void Widget::invalidate()
+  {
+    for(Widget *widget = this; widget != nullptr; widget = widget->_M_parent) {
+      widget->_M_is_layer_valid = false;
+    }
+    damage(visual_bounds());
+  }
+
+  void Widget::damage(const Rectangle<int> &rect)
+  {
+    shared_ptr<Surface> tmp_surface = surface().lock();
+    if(tmp_surface.get() != nullptr) tmp_surface->damage(rect);
+  }
+
   const weak_ptr<Surface> &Widget::surface()
   {
     Widget *root;
@@ -329,12 +377,34 @@ namespace waytk
 
   Styles *Widget::styles()
   {
-    if(_M_style_name != name() && strcmp(_M_style_name, name()) != 0) {
+    if(_M_style_name != name()) {
       _M_style_name = name();
-      _M_styles = find_styles(_M_style_name);
+      _M_style_name_id = intern_style_name(_M_style_name);
+      _M_styles = nullptr;
+    }
+    if(_M_styles == nullptr || _M_styles_generation != priv::styles_generation()) {
+      _M_styles = find_styles_by_name_id(_M_style_name_id);
+      _M_styles_generation = priv::styles_generation();
+      _M_has_resolved_styles = false;
     }
     return _M_styles;
   }
+
+  void Widget::resolve_styles()
+  {
+    Styles *tmp_styles = styles();
+    if(_M_has_resolved_styles && _M_resolved_pseudo_classes == _M_pseudo_classes) return;
+    // The box properties only are resolved again after a change of the
+    // pseudo classes or the styles.
+    _M_resolved_margin = tmp_styles->margin(_M_pseudo_classes);
+    _M_resolved_border = tmp_styles->border(_M_pseudo_classes);
+    _M_resolved_padding = tmp_styles->padding(_M_pseudo_classes);
+    _M_resolved_foreground_color = tmp_styles->foreground_color(_M_pseudo_classes);
+    _M_resolved_background_color = tmp_styles->background_color(_M_pseudo_classes);
+    _M_resolved_visual_overflow = tmp_styles->visual_overflow(_M_pseudo_classes);
+    _M_resolved_pseudo_classes = _M_pseudo_classes;
+    _M_has_resolved_styles = true;
+  }
   
   const char *Widget::name() const
   { return "widget"; }
@@ -342,13 +412,14 @@ namespace waytk
   void Widget::update_pseudo_classes()
   {
     if(surface().lock()->is_active())
-      _M_pseudo_classes |= PseudoClasses::BACKDROP;
+      set_pseudo_classes(_M_pseudo_classes | PseudoClasses::BACKDROP);
     else
-      _M_pseudo_classes &= ~PseudoClasses::BACKDROP;
+      set_pseudo_classes(_M_pseudo_classes & ~PseudoClasses::BACKDROP);
   }
 
   void Widget::update_point(const Rectangle<int> &area_bounds, const HAlignment *h_align, const VAlignment *v_align)
   {
+    Point<int> old_point = _M_bounds.point();
     if(h_align == nullptr) h_align = &_M_h_align;
     if(v_align == nullptr) v_align = &_M_v_align;
     switch(*h_align) {
@@ -391,6 +462,10 @@ namespace waytk
         _M_bounds.y = area_bounds.y;
         break;
     }
+    if(_M_bounds.point() != old_point) {
+      damage(extend_rect(Rectangle<int>(old_point, _M_bounds.size()), visual_overflow()));
+      invalidate();
+    }
     update_child_points();
   }
 
@@ -398,10 +473,10 @@ namespace waytk
 
   void Widget::update_size(Canvas *canvas, const Dimension<int> &area_size, const HAlignment *h_align, const VAlignment *v_align)
   {
-    Styles *styles = find_styles(name());
-    Edges<int> border = styles->border(_M_pseudo_classes);
-    Edges<int> padding = styles->padding(_M_pseudo_classes);
+    Edges<int> border = this->border();
+    Edges<int> padding = this->padding();
     Dimension<int> tmp_area_size = area_size;
+    Dimension<int> old_size = _M_bounds.size();
     if(h_align == nullptr) h_align = &_M_h_align;
     if(v_align == nullptr) v_align = &_M_v_align;
     tmp_area_size.width = min(tmp_area_size.width, _M_max_width);
@@ -418,6 +493,10 @@ namespace waytk
       _M_bounds.height = min(max(_M_bounds.height, _M_min_height), tmp_area_size.height);
     } else
       _M_bounds.height = tmp_area_size.height;
+    if(_M_bounds.size() != old_size) {
+      damage(extend_rect(Rectangle<int>(_M_bounds.point(), old_size), visual_overflow()));
+      invalidate();
+    }
   }
 
   void Widget::update_child_sizes(Canvas *canvas, const Dimension<int> &area_size) {}
@@ -432,10 +511,52 @@ namespace waytk
   { return _M_v_align == VAlignment::FILL; }
 
   void Widget::draw(Canvas *canvas)
+  {
+    // The widget is drawn on the layer of an ascendant if the ascendant has
+    // the layer, so the widget is always drawn in this case.
+    bool has_layer_ascendant = false;
+    for(Widget *widget = _M_parent; widget != nullptr; widget = widget->_M_parent) {
+      if(widget->_M_has_layer) {
+        has_layer_ascendant = true;
+        break;
+      }
+    }
+    // The box shadow of the widget is drawn outside the widget bounds, so the
+    // visual bounds are used for the damage test and the layer.
+    Rectangle<int> tmp_visual_bounds = visual_bounds();
+    if(!has_layer_ascendant) {
+      shared_ptr<Surface> tmp_surface = surface().lock();
+      if(tmp_surface.get() != nullptr && !tmp_surface->is_damaged(tmp_visual_bounds)) return;
+    }
+    if(_M_has_layer) {
+      if(_M_bounds.width <= 0 || _M_bounds.height <= 0) return;
+      if(_M_layer_image.get() == nullptr || _M_layer_image->size() != tmp_visual_bounds.size()) {
+        _M_layer_image = unique_ptr<CanvasModifiableImage>(new_canvas_modifiable_image(tmp_visual_bounds.size()));
+        _M_is_layer_valid = false;
+      }
+      if(!_M_is_layer_valid) {
+        unique_ptr<Canvas> layer_canvas(_M_layer_image->canvas());
+        layer_canvas->set_op(Operator::CLEAR);
+        layer_canvas->paint();
+        layer_canvas->set_op(Operator::OVER);
+        layer_canvas->translate(-tmp_visual_bounds.x, -tmp_visual_bounds.y);
+        draw_without_layer(layer_canvas.get());
+        _M_is_layer_valid = true;
+      }
+      canvas->save();
+      canvas->set_image(_M_layer_image.get(), tmp_visual_bounds.x, tmp_visual_bounds.y);
+      canvas->rect(tmp_visual_bounds.x, tmp_visual_bounds.y, tmp_visual_bounds.width, tmp_visual_bounds.height);
+      canvas->fill();
+      canvas->restore();
+    } else
+      draw_without_layer(canvas);
+  }
+
+  void Widget::draw_without_layer(Canvas *canvas)
   {
     styles()->draw_background(_M_pseudo_classes, canvas, _M_bounds);
-    Edges<int> border = styles()->border(_M_pseudo_classes);
-    Edges<int> padding = styles()->padding(_M_pseudo_classes);
+    Edges<int> border = this->border();
+    Edges<int> padding = this->padding();
     Rectangle<int> inner_bounds = _M_bounds;
     inner_bounds.x += border.left + padding.left;
     inner_bounds.y += border.top + padding.top;
@@ -475,28 +596,28 @@ namespace waytk
       default:
         break;
     }
-    if(pointer.is_touch()) _M_pseudo_classes |= PseudoClasses::HOVER;
+    if(pointer.is_touch()) set_pseudo_classes(_M_pseudo_classes | PseudoClasses::HOVER);
     _M_on_touch_callback(this, pointer, point, state);
     return false;
   }
 
   void Widget::on_touch_leave(const Pointer &pointer)
   {
-    _M_pseudo_classes &= ~PseudoClasses::HOVER;
+    set_pseudo_classes(_M_pseudo_classes & ~PseudoClasses::HOVER);
     delete_pointer_from_any_block(pointer);
     _M_on_touch_leave_callback(this, pointer);
   }
 
   bool Widget::on_pointer_motion(const Point<double> &point)
   {
-    _M_pseudo_classes |= PseudoClasses::HOVER;
+    set_pseudo_classes(_M_pseudo_classes | PseudoClasses::HOVER);
     _M_on_pointer_motion_callback(this, point);
     return false;
   }
 
   void Widget::on_pointer_leave()
   {
-    _M_pseudo_classes &= ~PseudoClasses::HOVER;
+    set_pseudo_classes(_M_pseudo_classes & ~PseudoClasses::HOVER);
     _M_on_pointer_leave_callback(this);
   }
 
@@ -509,12 +630,23 @@ namespace waytk
   void Widget::on_scroll(Viewport *viewport)
   { _M_on_scroll_callback(this, viewport); }
 
+  size_t Widget::block_style_name_id(const char *name)
+  {
+    // A widget has few blocks, so the block names are compared by pointers.
+    for(auto &pair : _M_block_style_name_ids) {
+      if(pair.first == name) return pair.second;
+    }
+    size_t name_id = intern_style_name(name);
+    _M_block_style_name_ids.push_back(make_pair(name, name_id));
+    return name_id;
+  }
+
   Dimension<int> Widget::block_margin_box_size(const char *name, PseudoClasses pseudo_classes, const Dimension<int> &content_size)
   {
     PseudoClasses tmp_pseudo_classes = _M_pseudo_classes;
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    Styles *styles = find_styles(name);
+    Styles *styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -529,7 +661,7 @@ namespace waytk
     PseudoClasses tmp_pseudo_classes = _M_pseudo_classes;
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    styles = find_styles(name);
+    styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -552,8 +684,8 @@ namespace waytk
 
   Dimension<int> Widget::area_size_to_inner_area_size(const Dimension<int> &size)
   {
-    Edges<int> border = styles()->border(_M_pseudo_classes);
-    Edges<int> padding = styles()->padding(_M_pseudo_classes);
+    Edges<int> border = this->border();
+    Edges<int> padding = this->padding();
     Dimension<int> tmp_size = size;
     if(size.width != numeric_limits<int>::max())
       tmp_size.width -= border.left + border.right + padding.left + padding.right;
@@ -566,8 +698,8 @@ namespace waytk
 
   Rectangle<int> Widget::bounds_to_inner_bounds(const Rectangle<int> &bounds)
   {
-    Edges<int> border = styles()->border(_M_pseudo_classes);
-    Edges<int> padding = styles()->padding(_M_pseudo_classes);
+    Edges<int> border = this->border();
+    Edges<int> padding = this->padding();
     Rectangle<int> tmp_bounds = bounds;
     tmp_bounds.x += border.left + padding.left;
     tmp_bounds.y += border.top + padding.top;
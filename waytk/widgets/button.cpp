@@ -42,7 +42,10 @@ namespace waytk
   }
 
   void Button::set_label(const string &label)
-  { normalize_utf8(label, _M_label); }
+  {
+    normalize_utf8(label, _M_label);
+    invalidate();
+  }
 
   const char *Button::name() const
   { return "button"; }
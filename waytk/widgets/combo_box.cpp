@@ -85,7 +85,10 @@ namespace waytk
     if(pos < _M_fields->_M_adapter->item_count()) {
       size_t old_pos = _M_fields->_M_selected_pos;
       _M_fields->_M_selected_pos = pos;
-      if(_M_fields->_M_selected_pos != old_pos) on_selection(_M_fields->_M_selected_pos);
+      if(_M_fields->_M_selected_pos != old_pos) {
+        invalidate();
+        on_selection(_M_fields->_M_selected_pos);
+      }
     }
   }
 
@@ -97,7 +100,11 @@ namespace waytk
 
   void ComboBox::on_click()
   {
-    Point<int> point(bounds().x, bounds().y - _M_fields->_M_selected_item_y);
+    // The popup surface has the margin for the shadow of the drop-down list,
+    // so the surface is moved by this margin.
+    Edges<int> shadow_margin = _M_fields->_M_popup_surface->root_widget()->visual_overflow();
+    Point<int> point(bounds().x - shadow_margin.left, bounds().y - _M_fields->_M_selected_item_y - shadow_margin.top);
+    _M_fields->_M_popup_surface->set_shadow_margin(shadow_margin);
     _M_fields->_M_popup_surface->set_popup(surface().lock(), point);
     _M_fields->_M_popup_surface->set_visible(true);
   }
@@ -19,29 +19,248 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-#include <waytk.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "image_loader.hpp"
+#include "image_viewport.hpp"
+#include "tile_cache.hpp"
+#include "waytk_priv.hpp"
 
 using namespace std;
 
 namespace waytk
 {
-  Image::~Image() {}
+  namespace priv
+  {
+    //
+    // An ImageViewport class.
+    //
+
+    ImageViewport::~ImageViewport() {}
+
+    void ImageViewport::update_client_point(const Point<int> &viewport_point)
+    {
+      this->WidgetViewport::update_client_point(viewport_point);
+      Dimension<int> viewport_size = size();
+      _M_image->_M_view_bounds = Rectangle<int>(viewport_point.x, viewport_point.y, viewport_size.width, viewport_size.height);
+      _M_image->_M_has_view_bounds = true;
+    }
+  }
+
+  //
+  // An Image class.
+  //
+
+  Image::~Image()
+  {
+    // The pending load doesn't update the destroyed image widget.
+    if(_M_load_owner.get() != nullptr) *_M_load_owner = nullptr;
+  }
 
   void Image::initialize(const shared_ptr<CanvasImage> &image)
-  { _M_image = image; }
+  {
+    _M_image = image;
+    _M_is_scaled = false;
+    _M_has_view_bounds = false;
+  }
+
+  void Image::set_image(const shared_ptr<CanvasImage> &image)
+  {
+    _M_image = image;
+    _M_image_future = shared_future<shared_ptr<CanvasImage>>();
+    _M_tiled_image_source.reset();
+    _M_tile_futures.clear();
+    invalidate();
+  }
+
+  void Image::set_tiled_image_source(const shared_ptr<TiledImageSource> &source)
+  {
+    _M_image.reset();
+    _M_image_future = shared_future<shared_ptr<CanvasImage>>();
+    _M_tiled_image_source = source;
+    _M_tile_futures.clear();
+    invalidate();
+  }
+
+  void Image::load_async(const string &file_name)
+  {
+    _M_image_future = priv::image_loader().load(file_name, update_listener());
+    _M_image_file_name = file_name;
+    take_loaded_image();
+    invalidate();
+  }
+
+  bool Image::update_image()
+  {
+    bool is_updated = take_loaded_image();
+    for(auto &tile_future : _M_tile_futures) {
+      if(tile_future.wait_for(chrono::seconds(0)) == future_status::ready) {
+        is_updated = true;
+        break;
+      }
+    }
+    if(!is_updated) return false;
+    invalidate();
+    return true;
+  }
 
   const char *Image::name() const
   { return "image"; }
 
   void Image::update_content_size(Canvas *canvas, const Dimension<int> &area_size)
-  { set_content_size(_M_image->size()); }
+  {
+    take_loaded_image();
+    if(_M_tiled_image_source.get() != nullptr)
+      set_content_size(_M_tiled_image_source->size());
+    else
+      set_content_size(_M_image.get() != nullptr ? _M_image->size() : Dimension<int>(0, 0));
+  }
+
+  Viewport *Image::viewport()
+  { return new priv::ImageViewport(this); }
 
   void Image::draw_content(Canvas *canvas, const Rectangle<int> &inner_bounds)
   {
+    take_loaded_image();
+    if(_M_tiled_image_source.get() != nullptr) {
+      draw_tiles(canvas, inner_bounds);
+      return;
+    }
+    if(_M_image.get() == nullptr) return;
     canvas->save();
     canvas->rect(inner_bounds.x, inner_bounds.y, inner_bounds.width, inner_bounds.height);
-    canvas->set_image(_M_image.get(), inner_bounds.x, inner_bounds.y);
+    Dimension<int> image_size = _M_image->size();
+    if(_M_is_scaled && image_size.width > 0 && image_size.height > 0 &&
+      inner_bounds.width > 0 && inner_bounds.height > 0) {
+      double sx = static_cast<double>(inner_bounds.width) / image_size.width;
+      double sy = static_cast<double>(inner_bounds.height) / image_size.height;
+      // A downscaled image is drawn from the mip level that is closest to the
+      // inner bounds, so it is resampled from about as many pixels as are
+      // displayed.
+      int level = max(static_cast<int>(floor(log2(1.0 / max(sx, sy)))), 0);
+      while(level > 0 && ((image_size.width >> level) == 0 || (image_size.height >> level) == 0)) level--;
+      CanvasImage *image = _M_image->mip_level(level);
+      // The size of the mip level is rounded up, so the level is scaled by its
+      // exact factor and its edge pixels are partially covered by the inner
+      // bounds.
+      double level_scale = static_cast<double>(1 << level);
+      canvas->translate(inner_bounds.x, inner_bounds.y);
+      canvas->scale(sx * level_scale, sy * level_scale);
+      canvas->set_image(image, 0.0, 0.0);
+    } else
+      canvas->set_image(_M_image.get(), inner_bounds.x, inner_bounds.y);
     canvas->fill();
     canvas->restore();
   }
+
+  bool Image::take_loaded_image()
+  {
+    if(!_M_image_future.valid()) return false;
+    if(_M_image_future.wait_for(chrono::seconds(0)) != future_status::ready) return false;
+    shared_future<shared_ptr<CanvasImage>> image_future = _M_image_future;
+    _M_image_future = shared_future<shared_ptr<CanvasImage>>();
+    // This method is invoked while drawing and from the main loop, so a
+    // loading error is only reported.
+    try {
+      _M_image = image_future.get();
+    } catch(exception &e) {
+      _M_image.reset();
+      fprintf(stderr, "waytk: can't load image %s: %s\n", _M_image_file_name.c_str(), e.what());
+    }
+    return true;
+  }
+
+  function<void ()> Image::update_listener()
+  {
+    if(_M_load_owner.get() == nullptr) _M_load_owner = shared_ptr<Image *>(new Image *(this));
+    shared_ptr<Image *> owner = _M_load_owner;
+    // The loading thread wakes up the main loop that updates the image
+    // widget.
+    return [owner]() {
+      priv::post_main_loop_task([owner]() {
+        if(*owner != nullptr) (*owner)->update_image();
+      });
+    };
+  }
+
+  void Image::draw_tiles(Canvas *canvas, const Rectangle<int> &inner_bounds)
+  {
+    TiledImageSource *source = _M_tiled_image_source.get();
+    Dimension<int> image_size = source->size();
+    Dimension<int> tile_size = source->tile_size();
+    _M_tile_futures.clear();
+    if(image_size.width <= 0 || image_size.height <= 0 || inner_bounds.width <= 0 || inner_bounds.height <= 0)
+      return;
+    Rectangle<int> visible_bounds = inner_bounds;
+    if(_M_has_view_bounds && !visible_bounds.intersect(_M_view_bounds, visible_bounds)) return;
+    // The tiles outside the clip aren't requested also when the image widget
+    // isn't in a viewport.
+    priv::ImplCanvas *impl_canvas = dynamic_cast<priv::ImplCanvas *>(canvas);
+    if(impl_canvas != nullptr) {
+      Rectangle<double> clip_rect;
+      impl_canvas->get_clip_extents(clip_rect);
+      Rectangle<double> tmp_rect(visible_bounds.x, visible_bounds.y, visible_bounds.width, visible_bounds.height);
+      if(!tmp_rect.intersect(clip_rect, tmp_rect)) return;
+      int x1 = floor(tmp_rect.x), y1 = floor(tmp_rect.y);
+      int x2 = ceil(tmp_rect.x + tmp_rect.width), y2 = ceil(tmp_rect.y + tmp_rect.height);
+      visible_bounds = Rectangle<int>(x1, y1, x2 - x1, y2 - y1);
+    }
+    double sx = 1.0, sy = 1.0;
+    if(_M_is_scaled) {
+      sx = static_cast<double>(inner_bounds.width) / image_size.width;
+      sy = static_cast<double>(inner_bounds.height) / image_size.height;
+    }
+    int level = max(static_cast<int>(floor(log2(1.0 / max(sx, sy)))), 0);
+    level = min(level, source->level_count() - 1);
+    // Only the tiles that intersect the visible bounds are requested.
+    double level_scale = static_cast<double>(1 << level);
+    double tile_width = tile_size.width * level_scale * sx;
+    double tile_height = tile_size.height * level_scale * sy;
+    Dimension<int> level_size = priv::tiled_image_level_size(source, level);
+    int column_count = (level_size.width + tile_size.width - 1) / tile_size.width;
+    int row_count = (level_size.height + tile_size.height - 1) / tile_size.height;
+    int column1 = max(static_cast<int>(floor((visible_bounds.x - inner_bounds.x) / tile_width)), 0);
+    int row1 = max(static_cast<int>(floor((visible_bounds.y - inner_bounds.y) / tile_height)), 0);
+    int column2 = min(static_cast<int>(ceil((visible_bounds.x + visible_bounds.width - inner_bounds.x) / tile_width)), column_count);
+    int row2 = min(static_cast<int>(ceil((visible_bounds.y + visible_bounds.height - inner_bounds.y) / tile_height)), row_count);
+    for(int row = row1; row < row2; row++) {
+      for(int column = column1; column < column2; column++) {
+        shared_future<shared_ptr<CanvasImage>> tile_future = priv::tile_cache().request(_M_tiled_image_source, level, Point<int>(column, row), update_listener());
+        shared_ptr<CanvasImage> tile;
+        int tile_level = level;
+        if(tile_future.wait_for(chrono::seconds(0)) == future_status::ready) {
+          try {
+            tile = tile_future.get();
+          } catch(...) {
+            // A tile that failed to load is replaced by a coarser tile.
+          }
+        } else
+          _M_tile_futures.push_back(tile_future);
+        if(tile.get() == nullptr) {
+          // A tile of a coarser level is displayed until the tile is loaded.
+          for(tile_level = level + 1; tile_level < source->level_count(); tile_level++) {
+            int shift = tile_level - level;
+            tile = priv::tile_cache().find(source, tile_level, Point<int>(column >> shift, row >> shift));
+            if(tile.get() != nullptr) break;
+          }
+        }
+        if(tile.get() == nullptr) continue;
+        double x = inner_bounds.x + column * tile_width;
+        double y = inner_bounds.y + row * tile_height;
+        double width = min(tile_width, inner_bounds.x + image_size.width * sx - x);
+        double height = min(tile_height, inner_bounds.y + image_size.height * sy - y);
+        int shift = tile_level - level;
+        double tile_level_scale = static_cast<double>(1 << tile_level);
+        canvas->save();
+        canvas->rect(x, y, width, height);
+        canvas->translate(inner_bounds.x, inner_bounds.y);
+        canvas->scale(tile_level_scale * sx, tile_level_scale * sy);
+        canvas->set_image(tile.get(), (column >> shift) * tile_size.width, (row >> shift) * tile_size.height);
+        canvas->fill();
+        canvas->restore();
+      }
+    }
+  }
 }
@@ -32,7 +32,10 @@ namespace waytk
   { normalize_utf8(text, _M_text); }
 
   void Label::set_text(const string &text)
-  { normalize_utf8(text, _M_text); }
+  {
+    normalize_utf8(text, _M_text);
+    invalidate();
+  }
 
   const char *Label::name() const
   { return "label"; }
@@ -54,7 +57,7 @@ namespace waytk
     FontMetrics font_metrics;
     canvas->get_font_matrics(font_metrics);
     canvas->move_to(inner_bounds.x, inner_bounds.y + (inner_bounds.height - content_size().height) / 2 + font_metrics.ascent);
-    canvas->set_color(styles()->foreground_color(pseudo_classes()));
+    canvas->set_color(foreground_color());
     canvas->show_text(_M_text);
   }
 }
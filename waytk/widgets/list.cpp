@@ -45,6 +45,7 @@ namespace waytk
     copy_if(poses.begin(), poses.end(), tmp_inserter, [this](size_t pos) {
       return pos < _M_adapter->item_count();
     });
+    invalidate();
     on_list_selection(_M_selected_poses);
   }
 
@@ -58,7 +59,10 @@ namespace waytk
         _M_selected_poses.insert(pos);
       }
     }
-    if(!were_all_selected) on_list_selection(_M_selected_poses);
+    if(!were_all_selected) {
+      invalidate();
+      on_list_selection(_M_selected_poses);
+    }
   }
 
   void List::change_selection(const Range<size_t> &range)
@@ -71,6 +75,7 @@ namespace waytk
         else
           _M_selected_poses.erase(pos);
       }
+      invalidate();
       on_list_selection(_M_selected_poses);
     }
   }
@@ -79,7 +84,10 @@ namespace waytk
   {
     bool was_empty = _M_selected_poses.empty();
     _M_selected_poses.clear();
-    if(!was_empty) on_list_selection(_M_selected_poses);
+    if(!was_empty) {
+      invalidate();
+      on_list_selection(_M_selected_poses);
+    }
   }
 
   const char *List::name() const
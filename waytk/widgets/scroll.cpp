@@ -200,26 +200,26 @@ namespace waytk
     _M_has_enabled_h_scroll_bar = _M_viewport->width_is_less_than_clien_width();
     _M_has_enabled_v_scroll_bar = _M_viewport->height_is_less_than_clien_height();
     if(_M_has_enabled_h_scroll_bar) {
-      _M_h_scroll_bar_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_left_button_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_h_slider_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_right_button_pseudo_classes &= ~PseudoClasses::DISABLED;
+      set_h_scroll_bar_pseudo_classes(_M_h_scroll_bar_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_left_button_pseudo_classes(_M_left_button_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_right_button_pseudo_classes(_M_right_button_pseudo_classes & ~PseudoClasses::DISABLED);
     } else {
-      _M_h_scroll_bar_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_left_button_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_h_slider_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_right_button_pseudo_classes |= PseudoClasses::DISABLED;
+      set_h_scroll_bar_pseudo_classes(_M_h_scroll_bar_pseudo_classes | PseudoClasses::DISABLED);
+      set_left_button_pseudo_classes(_M_left_button_pseudo_classes | PseudoClasses::DISABLED);
+      set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes | PseudoClasses::DISABLED);
+      set_right_button_pseudo_classes(_M_right_button_pseudo_classes | PseudoClasses::DISABLED);
     }
     if(_M_has_enabled_v_scroll_bar) {
-      _M_v_scroll_bar_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_top_button_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_v_slider_pseudo_classes &= ~PseudoClasses::DISABLED;
-      _M_bottom_button_pseudo_classes &= ~PseudoClasses::DISABLED;
+      set_v_scroll_bar_pseudo_classes(_M_v_scroll_bar_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_top_button_pseudo_classes(_M_top_button_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes & ~PseudoClasses::DISABLED);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::DISABLED);
     } else {
-      _M_h_scroll_bar_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_top_button_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_v_slider_pseudo_classes |= PseudoClasses::DISABLED;
-      _M_bottom_button_pseudo_classes |= PseudoClasses::DISABLED;
+      set_h_scroll_bar_pseudo_classes(_M_h_scroll_bar_pseudo_classes | PseudoClasses::DISABLED);
+      set_top_button_pseudo_classes(_M_top_button_pseudo_classes | PseudoClasses::DISABLED);
+      set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes | PseudoClasses::DISABLED);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes | PseudoClasses::DISABLED);
     }
     Dimension<int> widget_area_size = inner_area_size;
     widget_area_size.width -= _M_v_scroll_bar_margin_box_size.width;
@@ -278,7 +278,7 @@ namespace waytk
           case TouchState::DOWN:
             if(!had_pointer) {
               if(_M_left_button_touch_count == 0)
-                _M_left_button_pseudo_classes |= PseudoClasses::ACTIVE;
+                set_left_button_pseudo_classes(_M_left_button_pseudo_classes | PseudoClasses::ACTIVE);
               _M_left_button_touch_count++;
               _M_viewport->h_move_view(-1);
             }
@@ -293,7 +293,7 @@ namespace waytk
               if(_M_left_button_touch_count > 0) {
                 _M_left_button_touch_count--;
                 if(_M_left_button_touch_count == 0) {
-                  _M_left_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+                  set_left_button_pseudo_classes(_M_left_button_pseudo_classes & ~PseudoClasses::ACTIVE);
                   _M_viewport->h_move_view(-1);
                 }
               }
@@ -307,7 +307,7 @@ namespace waytk
         on_touch_for_block(H_SLIDER, pointer, point, state);
         if(state == TouchState::DOWN && !_M_has_h_slider_pointer) {
           lock_touch_leaving(pointer);
-          _M_h_slider_pseudo_classes |= PseudoClasses::ACTIVE;
+          set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes | PseudoClasses::ACTIVE);
           _M_has_h_slider_pointer = true;
           _M_h_slider_pointer = pointer;
           _M_old_h_slider_pointer_point = int_point;
@@ -320,7 +320,7 @@ namespace waytk
           case TouchState::DOWN:
             if(!had_pointer) {
               if(_M_right_button_touch_count == 0)
-                _M_right_button_pseudo_classes |= PseudoClasses::ACTIVE;
+                set_right_button_pseudo_classes(_M_right_button_pseudo_classes | PseudoClasses::ACTIVE);
               _M_right_button_touch_count++;
               _M_viewport->h_move_view(1);
             }
@@ -334,7 +334,7 @@ namespace waytk
               if(_M_right_button_touch_count > 0) {
                 _M_right_button_touch_count--;
                 if(_M_right_button_touch_count == 0) {
-                  _M_right_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+                  set_right_button_pseudo_classes(_M_right_button_pseudo_classes & ~PseudoClasses::ACTIVE);
                   _M_viewport->h_move_view(1);
                 }
               }
@@ -362,7 +362,7 @@ namespace waytk
           case TouchState::DOWN:
             if(!had_pointer) {
               if(_M_top_button_touch_count == 0)
-                _M_top_button_pseudo_classes |= PseudoClasses::ACTIVE;
+                set_top_button_pseudo_classes(_M_top_button_pseudo_classes | PseudoClasses::ACTIVE);
               _M_top_button_touch_count++;
               _M_viewport->v_move_view(1);
             }
@@ -377,7 +377,7 @@ namespace waytk
               if(_M_top_button_touch_count > 0) {
                 _M_top_button_touch_count--;
                 if(_M_top_button_touch_count == 0) {
-                  _M_top_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+                  set_top_button_pseudo_classes(_M_top_button_pseudo_classes & ~PseudoClasses::ACTIVE);
                   _M_viewport->v_move_view(-1);
                 }
               }
@@ -391,7 +391,7 @@ namespace waytk
         on_touch_for_block(V_SLIDER, pointer, point, state);
         if(state == TouchState::DOWN && !_M_has_v_slider_pointer) {
           lock_touch_leaving(pointer);
-          _M_v_slider_pseudo_classes |= PseudoClasses::ACTIVE;
+          set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes | PseudoClasses::ACTIVE);
           _M_has_v_slider_pointer = true;
           _M_v_slider_pointer = pointer;
           _M_old_v_slider_pointer_point = int_point;
@@ -404,7 +404,7 @@ namespace waytk
           case TouchState::DOWN:
             if(!had_pointer) {
               if(_M_bottom_button_touch_count == 0)
-                _M_bottom_button_pseudo_classes |= PseudoClasses::ACTIVE;
+                set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes | PseudoClasses::ACTIVE);
               _M_bottom_button_touch_count++;
               _M_viewport->v_move_view(1);
             }
@@ -418,7 +418,7 @@ namespace waytk
               if(_M_bottom_button_touch_count > 0) {
                 _M_bottom_button_touch_count--;
                 if(_M_bottom_button_touch_count == 0) {
-                  _M_bottom_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+                  set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::ACTIVE);
                   _M_viewport->v_move_view(1);
                 }
               }
@@ -443,7 +443,7 @@ namespace waytk
       if(state == TouchState::MOTION || state == TouchState::UP) {
         if(state == TouchState::UP) {
           _M_has_h_slider_pointer = false;
-          _M_h_slider_pseudo_classes &= ~PseudoClasses::ACTIVE;
+          set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes & ~PseudoClasses::ACTIVE);
           unlock_touch_leaving(pointer);
         }
         if(_M_old_h_slider_pointer_point.x != point.x) {
@@ -460,7 +460,7 @@ namespace waytk
       if(state == TouchState::MOTION || state == TouchState::UP) {
         if(state == TouchState::UP) {
           _M_has_v_slider_pointer = false;
-          _M_v_slider_pseudo_classes &= ~PseudoClasses::ACTIVE;
+          set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes & ~PseudoClasses::ACTIVE);
           unlock_touch_leaving(pointer);
         }
         if(_M_old_v_slider_pointer_point.x != point.x) {
@@ -475,14 +475,14 @@ namespace waytk
     delete_pointer_from_any_block(pointer);
     this->Widget::on_touch(pointer, point, state);
     if(_M_has_visible_h_scroll_bar) {
-      _M_left_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_h_slider_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_bottom_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+      set_left_button_pseudo_classes(_M_left_button_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::ACTIVE);
     }
     if(_M_has_visible_v_scroll_bar) {
-      _M_top_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_v_slider_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_bottom_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+      set_top_button_pseudo_classes(_M_top_button_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::ACTIVE);
     }
     return false;
   }
@@ -491,14 +491,14 @@ namespace waytk
   {
     this->Widget::on_touch_leave(pointer);
     if(_M_has_visible_h_scroll_bar) {
-      _M_left_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_h_slider_pseudo_classes |= PseudoClasses::ACTIVE;
-      _M_bottom_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+      set_left_button_pseudo_classes(_M_left_button_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_h_slider_pseudo_classes(_M_h_slider_pseudo_classes | PseudoClasses::ACTIVE);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::ACTIVE);
     }
     if(_M_has_visible_v_scroll_bar) {
-      _M_top_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_v_slider_pseudo_classes &= ~PseudoClasses::ACTIVE;
-      _M_bottom_button_pseudo_classes &= ~PseudoClasses::ACTIVE;
+      set_top_button_pseudo_classes(_M_top_button_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_v_slider_pseudo_classes(_M_v_slider_pseudo_classes & ~PseudoClasses::ACTIVE);
+      set_bottom_button_pseudo_classes(_M_bottom_button_pseudo_classes & ~PseudoClasses::ACTIVE);
     }
   }
 
@@ -785,7 +785,7 @@ namespace waytk
     PseudoClasses tmp_pseudo_classes = this->pseudo_classes();
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    Styles *styles = find_styles(name);
+    Styles *styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -797,7 +797,7 @@ namespace waytk
     PseudoClasses tmp_pseudo_classes = this->pseudo_classes();
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    Styles *styles = find_styles(name);
+    Styles *styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -813,7 +813,7 @@ namespace waytk
     PseudoClasses tmp_pseudo_classes = this->pseudo_classes();
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    Styles *styles = find_styles(name);
+    Styles *styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -825,7 +825,7 @@ namespace waytk
     PseudoClasses tmp_pseudo_classes = this->pseudo_classes();
     tmp_pseudo_classes &= ~(PseudoClasses::ACTIVE | PseudoClasses::CHECKED | PseudoClasses::FOCUS | PseudoClasses::HOVER | PseudoClasses::SELECTED);
     tmp_pseudo_classes |= pseudo_classes;
-    Styles *styles = find_styles(name);
+    Styles *styles = find_styles_by_name_id(block_style_name_id(name));
     Edges<int> margin = styles->margin(tmp_pseudo_classes);
     Edges<int> border = styles->border(tmp_pseudo_classes);
     Edges<int> padding = styles->padding(tmp_pseudo_classes);
@@ -45,6 +45,7 @@ namespace waytk
     copy_if(poses.begin(), poses.end(), tmp_inserter, [this](const TablePosition &pos) {
       return pos.row < _M_adapter->row_count() && pos.column < _M_adapter->column_count();
     });
+    invalidate();
     on_table_selection(_M_selected_poses);
   }
 
@@ -61,7 +62,10 @@ namespace waytk
         }
       }
     }
-    if(!were_all_selected) on_table_selection(_M_selected_poses);
+    if(!were_all_selected) {
+      invalidate();
+      on_table_selection(_M_selected_poses);
+    }
   }
 
   void Table::change_selection(const Range<size_t> &row_range, const Range<size_t> &column_range)
@@ -78,6 +82,7 @@ namespace waytk
             _M_selected_poses.erase(pos);
         }
       }
+      invalidate();
       on_table_selection(_M_selected_poses);
     }
   }
@@ -86,7 +91,10 @@ namespace waytk
   {
     bool was_empty = _M_selected_poses.empty();
     _M_selected_poses.clear();
-    if(!was_empty) on_table_selection(_M_selected_poses);
+    if(!was_empty) {
+      invalidate();
+      on_table_selection(_M_selected_poses);
+    }
   }
 
   const char *Table::name() const
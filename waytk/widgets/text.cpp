@@ -25,6 +25,8 @@
 #include <cstring>
 #include <limits>
 #include "text_buffer.hpp"
+#include "text_metrics_cache.hpp"
+#include "text_viewport.hpp"
 #include "util.hpp"
 
 using namespace std;
@@ -33,15 +35,229 @@ namespace waytk
 {
   namespace
   {
-    void get_utf8(const TextCharIterator &iter, const TextCharIterator &end, char *buf)
+    // The numbers of display lines of the text lines are stored in a binary
+    // indexed tree so that a display line is found in a logarithmic time.
+
+    void add_onto_tree_elem(vector<long> &tree, size_t i, long x)
+    {
+      for(i++; i < tree.size(); i += i & (~i + 1)) tree[i] += x;
+    }
+
+    long tree_sum(const vector<long> &tree, size_t count)
+    {
+      long sum = 0;
+      for(size_t i = count; i > 0; i -= i & (~i + 1)) sum += tree[i];
+      return sum;
+    }
+
+    size_t find_in_tree(const vector<long> &tree, long x, long &sum)
     {
-      auto tmp_iter = iter;
-      if(tmp_iter < end) tmp_iter++;
+      size_t count = tree.size() - 1;
+      size_t step = 1;
+      while(step * 2 <= count) step *= 2;
       size_t i = 0;
-      for(auto tmp_iter2 = *iter; tmp_iter2 != *tmp_iter; tmp_iter2++, i++) {
-        buf[i] = *tmp_iter2;
+      sum = 0;
+      for(; step > 0; step /= 2) {
+        if(i + step <= count && sum + tree[i + step] <= x) {
+          i += step;
+          sum += tree[i];
+        }
+      }
+      if(i >= count && count > 0) {
+        i = count - 1;
+        sum = tree_sum(tree, i);
       }
-      buf[i] = 0;
+      return i;
+    }
+  }
+
+  namespace priv
+  {
+    //
+    // A TextViewport class.
+    //
+
+    TextViewport::~TextViewport() {}
+
+    Edges<int> TextViewport::margin() const
+    { return Edges<int>(0, 0, 0, 0); }
+
+    Point<int> TextViewport::point() const
+    { return _M_bounds.point(); }
+
+    Dimension<int> TextViewport::size() const
+    { return _M_bounds.size(); }
+
+    void TextViewport::set_size(const Dimension<int> &size)
+    {
+      _M_bounds.width = size.width;
+      _M_bounds.height = size.height;
+    }
+
+    void TextViewport::update_point(Canvas *canvas)
+    { _M_bounds.x = _M_bounds.y = 0; }
+
+    void TextViewport::move_view_to_top()
+    { set_view_y(0); }
+
+    void TextViewport::move_view_to_bottom()
+    { set_view_y(client_size().height - _M_bounds.height); }
+
+    void TextViewport::h_move_view(int x)
+    { set_view_x(view_x() + x); }
+
+    void TextViewport::v_move_view(int y)
+    { set_view_y(view_y() + y); }
+
+    int TextViewport::h_scroll_slider_x(int width) const
+    {
+      int client_width = client_size().width;
+      return static_cast<int64_t>(view_x()) * width / client_width;
+    }
+
+    void TextViewport::set_h_scroll_slider_x(int x, int width)
+    {
+      int client_width = client_size().width;
+      set_view_x(static_cast<int64_t>(x) * client_width / width);
+    }
+
+    void TextViewport::add_onto_h_scroll_slider_x(int x, int width)
+    {
+      int client_width = client_size().width;
+      set_view_x(view_x() + static_cast<int64_t>(x) * client_width / width);
+    }
+
+    int TextViewport::h_scroll_slider_width(int width) const
+    {
+      int client_width = client_size().width;
+      int64_t x1 = client_width - _M_bounds.width;
+      int64_t x2 = client_width;
+      return x2 * width / client_width - x1 * width / client_width;
+    }
+
+    int TextViewport::v_scroll_slider_y(int height) const
+    {
+      int client_height = client_size().height;
+      return static_cast<int64_t>(view_y()) * height / client_height;
+    }
+
+    void TextViewport::set_v_scroll_slider_y(int y, int height)
+    {
+      int client_height = client_size().height;
+      set_view_y(static_cast<int64_t>(y) * client_height / height);
+    }
+
+    void TextViewport::add_onto_v_scroll_slider_y(int y, int height)
+    {
+      int client_height = client_size().height;
+      set_view_y(view_y() + static_cast<int64_t>(y) * client_height / height);
+    }
+
+    int TextViewport::v_scroll_slider_height(int height) const
+    {
+      int client_height = client_size().height;
+      int64_t y1 = client_height - _M_bounds.height;
+      int64_t y2 = client_height;
+      return y2 * height / client_height - y1 * height / client_height;
+    }
+
+    bool TextViewport::width_is_less_than_clien_width() const
+    { return _M_bounds.width < client_size().width; }
+
+    bool TextViewport::height_is_less_than_clien_height() const
+    { return _M_bounds.height < client_size().height; }
+
+    int TextViewport::max_width() const
+    { return client_size().width; }
+
+    int TextViewport::max_height() const
+    { return client_size().height; }
+
+    void TextViewport::update_client_point(const Point<int> &viewport_point) {}
+
+    void TextViewport::update_client_size(Canvas *canvas)
+    { _M_text->update_line_index(canvas); }
+
+    Edges<int> TextViewport::widget_margin() const
+    { return _M_text->margin(); }
+
+    void TextViewport::update_widget_point(const Rectangle<int> &area_bounds)
+    {
+      HAlignment h_align = HAlignment::LEFT;
+      VAlignment v_align = VAlignment::TOP;
+      _M_text->update_point(area_bounds, &h_align, &v_align);
+    }
+
+    void TextViewport::update_widget_size(Canvas *canvas, const Dimension<int> &area_size)
+    {
+      // The text widget fills the viewport and displays the visible lines of
+      // its text.
+      HAlignment h_align = HAlignment::FILL;
+      VAlignment v_align = VAlignment::FILL;
+      Edges<int> margin = _M_text->margin();
+      Dimension<int> tmp_area_size = area_size;
+      tmp_area_size.width -= margin.left + margin.right;
+      tmp_area_size.height -= margin.top + margin.bottom;
+      tmp_area_size.width = max(tmp_area_size.width, 0);
+      tmp_area_size.height = max(tmp_area_size.height, 0);
+      _M_text->update_size(canvas, tmp_area_size, &h_align, &v_align);
+      Edges<int> border = _M_text->border();
+      Edges<int> padding = _M_text->padding();
+      Dimension<int> content_size = _M_text->bounds().size();
+      content_size.width -= border.left + border.right + padding.left + padding.right;
+      content_size.height -= border.top + border.bottom + padding.top + padding.bottom;
+      content_size.width = max(content_size.width, 0);
+      content_size.height = max(content_size.height, 0);
+      _M_text->set_content_size(content_size);
+    }
+
+    Dimension<int> TextViewport::client_size() const
+    {
+      Dimension<int> tmp_size = text_extra_size();
+      int64_t height = static_cast<int64_t>(_M_text->_M_client_size.height_line) * _M_text->_M_line_height;
+      tmp_size.width += _M_text->_M_client_size.width;
+      tmp_size.height += min(height, static_cast<int64_t>(numeric_limits<int>::max() - tmp_size.height));
+      return tmp_size;
+    }
+
+    Dimension<int> TextViewport::text_extra_size() const
+    {
+      Edges<int> margin = _M_text->margin();
+      Dimension<int> tmp_size = _M_text->bounds().size();
+      tmp_size.width -= _M_text->content_size().width;
+      tmp_size.height -= _M_text->content_size().height;
+      tmp_size.width += margin.left + margin.right;
+      tmp_size.height += margin.top + margin.bottom;
+      return tmp_size;
+    }
+
+    int TextViewport::view_x() const
+    { return _M_text->_M_view_point.x; }
+
+    void TextViewport::set_view_x(int x)
+    {
+      x = min(max(x, 0), max(client_size().width - _M_bounds.width, 0));
+      _M_text->_M_view_point.x = x;
+      _M_text->_M_visible_point.x = -x;
+      _M_text->invalidate();
+    }
+
+    int TextViewport::view_y() const
+    {
+      int64_t y = static_cast<int64_t>(_M_text->_M_view_point.y_line) * _M_text->_M_line_height;
+      return y + _M_text->_M_view_point.y_offset;
+    }
+
+    void TextViewport::set_view_y(int y)
+    {
+      y = min(max(y, 0), max(client_size().height - _M_bounds.height, 0));
+      // The first visible iterator is found by the text widget before drawing
+      // because the wrapped lines are measured by the canvas.
+      int line_height = max(_M_text->_M_line_height, 1);
+      _M_text->_M_view_point.y_line = y / line_height;
+      _M_text->_M_view_point.y_offset = y % line_height;
+      _M_text->_M_has_view_point_change = true;
+      _M_text->invalidate();
     }
   }
 
@@ -65,7 +281,25 @@ namespace waytk
     _M_font_weight = FontWeight::NORMAL;
     _M_has_font_size = false;
     _M_font_size = 0;
+    _M_has_monospace_font = false;
+    _M_has_checked_font_pitch = false;
+    _M_has_fixed_font_pitch = false;
+    _M_has_char_advances = false;
+    _M_char_advance = 0;
+    _M_password_char_advance = 0;
     _M_is_editable = true;
+    _M_client_size = TextDimension(0, 0, 0);
+    _M_view_point = TextPoint(0, 0, 0);
+    _M_first_visible_iter = _M_buffer->char_begin();
+    _M_visible_point = Point<int>(0, 0);
+    _M_first_visible_color_index = 0;
+    _M_max_line_columns = 0;
+    _M_line_index_byte_count = 0;
+    _M_line_index_tab_spaces = 0;
+    _M_has_line_index = false;
+    _M_has_cached_column = false;
+    _M_has_view_point_change = false;
+    _M_line_height = 0;
     _M_on_text_change_callback.set_listener([](Widget *widget, const Range<TextCharIterator> &range) {});
     _M_on_cursor_change_callback.set_listener([](Widget *widget, const TextCharIterator &iter, const TextPosition &pos) {});
     _M_on_text_selection_callback.set_listener([](Widget *widget, const Range<TextCharIterator> &range) {});
@@ -74,6 +308,9 @@ namespace waytk
   void Text::set_text(const string &text)
   {
     _M_buffer->set_text(text);
+    _M_has_line_index = false;
+    _M_has_cached_column = false;
+    invalidate();
     Range<TextCharIterator> range(_M_buffer->char_begin(), _M_buffer->char_end());
     on_text_change(range);
   }
@@ -82,20 +319,30 @@ namespace waytk
   {
     TextCharIterator old_iter = cursor_iter();
     _M_buffer->set_cursor_iter(iter);
-    if(cursor_iter() != old_iter) on_cursor_change(cursor_iter(), cursor_pos());
+    if(cursor_iter() != old_iter) {
+      invalidate();
+      on_cursor_change(cursor_iter(), cursor_pos());
+    }
   }
 
   void Text::set_selection_range(const Range<TextCharIterator> &range)
   {
     Range<TextCharIterator> old_range = selection_range();
     _M_buffer->set_selection_range(range);
-    if(selection_range() != old_range) on_text_selection(selection_range());
+    if(selection_range() != old_range) {
+      invalidate();
+      on_text_selection(selection_range());
+    }
   }
 
   void Text::insert_string(const string &str)
   {
+    size_t offset = _M_buffer->char_iter_to_byte_offset(cursor_iter());
     _M_buffer->insert_string(str);
     if(!str.empty()) {
+      update_line_index_for_change(offset, 0, _M_buffer->char_iter_to_byte_offset(cursor_iter()) - offset);
+      _M_has_cached_column = false;
+      invalidate();
       Range<TextCharIterator> range(_M_buffer->char_begin(), _M_buffer->char_end());
       on_text_change(range);
     }
@@ -103,9 +350,15 @@ namespace waytk
 
   void Text::replace_string(size_t count, const string &str)
   {
+    size_t offset = _M_buffer->char_iter_to_byte_offset(cursor_iter());
+    size_t old_byte_count = _M_buffer->byte_count();
     _M_buffer->delete_chars(count);
     _M_buffer->insert_string(str);
     if(count > 0 || !str.empty()) {
+      size_t inserted_byte_count = _M_buffer->char_iter_to_byte_offset(cursor_iter()) - offset;
+      update_line_index_for_change(offset, inserted_byte_count + old_byte_count - _M_buffer->byte_count(), inserted_byte_count);
+      _M_has_cached_column = false;
+      invalidate();
       Range<TextCharIterator> range(_M_buffer->char_begin(), _M_buffer->char_end());
       on_text_change(range);
     }
@@ -113,8 +366,13 @@ namespace waytk
 
   void Text::delete_chars(size_t count)
   { 
+    size_t offset = _M_buffer->char_iter_to_byte_offset(cursor_iter());
+    size_t old_byte_count = _M_buffer->byte_count();
     _M_buffer->delete_chars(count);
     if(count > 0) {
+      update_line_index_for_change(offset, old_byte_count - _M_buffer->byte_count(), 0);
+      _M_has_cached_column = false;
+      invalidate();
       Range<TextCharIterator> range(_M_buffer->char_begin(), _M_buffer->char_end());
       on_text_change(range);
     }
@@ -122,8 +380,12 @@ namespace waytk
 
   void Text::append_string(const string &str)
   { 
+    size_t old_byte_count = _M_buffer->byte_count();
     _M_buffer->append_string(str);
     if(!str.empty()) {
+      update_line_index_for_change(old_byte_count, 0, _M_buffer->byte_count() - old_byte_count);
+      _M_has_cached_column = false;
+      invalidate();
       Range<TextCharIterator> range(_M_buffer->char_begin(), _M_buffer->char_end());
       on_text_change(range);
     }
@@ -141,6 +403,9 @@ namespace waytk
     _M_font_name = name;
     _M_font_slant = slant;
     _M_font_weight = weight;
+    _M_has_checked_font_pitch = false;
+    _M_has_char_advances = false;
+    invalidate();
   }
 
   void Text::unset_font()
@@ -149,18 +414,27 @@ namespace waytk
     _M_font_name.clear();
     _M_font_slant = FontSlant::NORMAL;
     _M_font_weight = FontWeight::NORMAL;
+    _M_has_checked_font_pitch = false;
+    _M_has_char_advances = false;
+    invalidate();
   }
   
   void Text::set_font_size(int size)
   {
     _M_has_font_size = true;
     _M_font_size = size;
+    _M_has_checked_font_pitch = false;
+    _M_has_char_advances = false;
+    invalidate();
   }
 
   void Text::unset_font_size()
   {
     _M_has_font_size = false;
     _M_font_size = 0;
+    _M_has_checked_font_pitch = false;
+    _M_has_char_advances = false;
+    invalidate();
   }
 
   const char *Text::name() const
@@ -173,10 +447,21 @@ namespace waytk
     content_point.y += (inner_bounds.height - content_size().height) / 2;
     Color selected_background_color = styles()->background_color(pseudo_classes() | PseudoClasses::SELECTED);
     Color selected_foreground_color = styles()->foreground_color(pseudo_classes() | PseudoClasses::SELECTED);
+    if(_M_has_view_point_change) update_first_visible_iter_for_view_point(canvas);
     TextPoint old_point(0, 0, 0);
     size_t old_column = 0;
     bool was_line_break = false;
     size_t color_index = _M_first_visible_color_index;
+    // The numbers of display lines of the drawn text lines are stored for the
+    // viewport.
+    bool can_set_line_height_lines = _M_has_line_index && _M_has_line_wrap && _M_input_type == InputType::MULTI_LINE;
+    size_t line = 0;
+    long line_begin_y_line = 0;
+    bool is_whole_line = false;
+    if(can_set_line_height_lines) {
+      line = iter_line(_M_first_visible_iter);
+      is_whole_line = (_M_line_offsets[line] == _M_buffer->char_iter_to_byte_offset(_M_first_visible_iter));
+    }
     canvas->save();
     canvas->rect(content_point.x, content_point.y, content_size().width, content_size().height);
     canvas->clip();
@@ -184,6 +469,8 @@ namespace waytk
     for_text(canvas, _M_first_visible_iter,
     [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
       if(iter == _M_buffer->char_end()) {
+        // The last text line doesn't end with a newline character.
+        if(can_set_line_height_lines && is_whole_line) set_line_height_line(line, point.y_line - line_begin_y_line + 1);
         if(_M_is_editable && iter == cursor_iter()) {
           int font_height = ceil(font_metrics.height);
           int y = point.y_line * font_height + point.y_offset + _M_visible_point.y;
@@ -205,7 +492,7 @@ namespace waytk
       if(_M_input_type == InputType::PASSWORD)
         strcpy(buf, "\342\227\217"); // Black circle.
       else
-        get_utf8(iter, _M_buffer->char_end(), buf);
+        priv::get_utf8(iter, _M_buffer->char_end(), buf);
       Color color;
       Point<int> tmp_point;
       int font_height = ceil(font_metrics.height);
@@ -217,7 +504,7 @@ namespace waytk
         if(iter <= _M_buffer->char_begin()) tmp_iter--;
         if(tmp_iter >= selection_range().begin && tmp_iter < selection_range().end) {
           char buf2[priv::MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
-          get_utf8(tmp_iter, _M_buffer->char_end(), buf2);
+          priv::get_utf8(tmp_iter, _M_buffer->char_end(), buf2);
           if(*buf2 == '\n' || was_line_break || (iter >= selection_range().begin && iter < selection_range().end)) {
             Point<int> tmp_point2;
             tmp_point2.x = content_point.x + old_point.x + _M_visible_point.x;
@@ -256,7 +543,7 @@ namespace waytk
           color = selected_foreground_color;
         } else {
           if(_M_input_type == InputType::PASSWORD)
-            color = styles()->foreground_color(pseudo_classes());
+            color = foreground_color();
           else
             color = foreground_color(color_index);
         }
@@ -276,6 +563,12 @@ namespace waytk
         Rectangle<int> rect(tmp_point.x, tmp_point.y, width, font_height);
         draw_cursor(canvas, rect);
       }
+      if(can_set_line_height_lines && *buf == '\n') {
+        if(is_whole_line) set_line_height_line(line, point.y_line - line_begin_y_line + 1);
+        line++;
+        line_begin_y_line = point.y_line + 1;
+        is_whole_line = true;
+      }
       old_point = point;
       old_column = column;
       was_line_break = is_line_break;
@@ -285,7 +578,7 @@ namespace waytk
   }
 
   Viewport *Text::viewport()
-  { throw exception(); }
+  { return new priv::TextViewport(this); }
 
   bool Text::on_touch(const Pointer &pointer, const Point<double> &point, TouchState state)
   { throw exception(); }
@@ -456,7 +749,7 @@ namespace waytk
   Color Text::foreground_color(size_t pos)
   {
     if(!_M_has_foreground_color) {
-      _M_foreground_color = styles()->foreground_color(pseudo_classes());
+      _M_foreground_color = foreground_color();
       _M_has_foreground_color = true;
     }
     return _M_foreground_color;
@@ -480,19 +773,21 @@ namespace waytk
     int max_line_width = 0;
     size_t column = 0;
     pair<bool, bool> tmp_pair;
+    priv::TextMetricsCache text_metrics_cache;
+    if(has_fixed_font_pitch(canvas)) text_metrics_cache.set_fixed_pitch(canvas);
     if(_M_input_type == InputType::MULTI_LINE) {
       for(auto iter = first_iter; true; iter++) {
         char buf[priv::MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
-        get_utf8(iter, _M_buffer->char_end(), buf);
+        priv::get_utf8(iter, _M_buffer->char_end(), buf);
         TextMetrics text_metrics;
         if(_M_has_line_wrap && _M_has_word_wrap) {
           if(*buf != '\n') {
             int width;
             if(*buf == '\t') {
-              canvas->get_text_matrics(" ", text_metrics);
+              text_metrics_cache.get_text_metrics(canvas, " ", text_metrics);
               width = ceil(text_metrics.x_advance) * (tab_spaces() - column % tab_spaces());
             } else {
-              canvas->get_text_matrics(buf, text_metrics);
+              text_metrics_cache.get_text_metrics(canvas, buf, text_metrics);
               width = ceil(text_metrics.x_advance);
             }
             if(content_size().width < point.x + width && column >= 1) {
@@ -508,34 +803,29 @@ namespace waytk
           if(*buf == ' ' || *buf == '\t') {
             int width;
             if(*buf == '\t') {
-              canvas->get_text_matrics(" ", text_metrics);
+              text_metrics_cache.get_text_metrics(canvas, " ", text_metrics);
               width = ceil(text_metrics.x_advance) * (tab_spaces() - column % tab_spaces());
             } else {
-              canvas->get_text_matrics(buf, text_metrics);
+              text_metrics_cache.get_text_metrics(canvas, buf, text_metrics);
               width = ceil(text_metrics.x_advance);
             }
+            // The width of the next word is memoized, so the look-ahead
+            // costs one lookup for a repeated word.
             auto iter2 = iter;
-            for(iter2++; iter2 != _M_buffer->char_end(); iter2++) {
-              char buf2[priv::MAX_NORMALIZED_UTF8_CHAR_LENGTH + 1];
-              get_utf8(iter2, _M_buffer->char_end(), buf2);
-              if(*buf2 == ' ' || *buf2 == '\t' || *buf2 == '\n') break;
-              TextMetrics text_metrics;
-              canvas->get_text_matrics(buf, text_metrics);
-              width += ceil(text_metrics.x_advance);
-              if(content_size().width < point.x + width) {
-                is_line_break = true;
-                break;
-              }
+            iter2++;
+            if(iter2 != _M_buffer->char_end() && **iter2 != ' ' && **iter2 != '\t' && **iter2 != '\n') {
+              width += text_metrics_cache.word_width(canvas, iter2, _M_buffer->char_end(), content_size().width - point.x - width);
+              is_line_break = (content_size().width < point.x + width);
             }
           }
         }
         if(iter != _M_buffer->char_end() && *buf != '\n') {
           if(*buf == '\t')
-            canvas->get_text_matrics(" ", text_metrics);
+            text_metrics_cache.get_text_metrics(canvas, " ", text_metrics);
           else
-            canvas->get_text_matrics(buf, text_metrics);
+            text_metrics_cache.get_text_metrics(canvas, buf, text_metrics);
         } else
-          canvas->get_text_matrics("a", text_metrics);
+          text_metrics_cache.get_text_metrics(canvas, "a", text_metrics);
         // Condition.
         tmp_pair = cond_fun(font_metrics, text_metrics, iter, point, column, is_line_break);
         if(!tmp_pair.first) break;
@@ -543,7 +833,7 @@ namespace waytk
         iter_fun(font_metrics, text_metrics, iter, point, column, is_line_break);
         if(*buf =='\n' || is_line_break) {
           TextMetrics text_metrics2;
-          canvas->get_text_matrics("a", text_metrics2);
+          text_metrics_cache.get_text_metrics(canvas, "a", text_metrics2);
           int tmp_width = ceil(text_metrics2.x_advance);
           max_line_width = max(max_line_width, point.x + tmp_width);
           point.y_line++;
@@ -566,13 +856,13 @@ namespace waytk
           else
             *buf = 0;
         } else
-          get_utf8(iter, _M_buffer->char_end(), buf);
+          priv::get_utf8(iter, _M_buffer->char_end(), buf);
         TextMetrics text_metrics;
         if(iter != _M_buffer->char_end()) {
           if(*buf == '\t')
-            canvas->get_text_matrics(" ", text_metrics);
+            text_metrics_cache.get_text_metrics(canvas, " ", text_metrics);
           else
-            canvas->get_text_matrics(buf, text_metrics);
+            text_metrics_cache.get_text_metrics(canvas, buf, text_metrics);
         }
         // Condition.
         tmp_pair = cond_fun(font_metrics, text_metrics, iter, point, column, false);
@@ -590,7 +880,7 @@ namespace waytk
     }
     if(tmp_pair.second) {
       TextMetrics text_metrics2;
-      canvas->get_text_matrics("a", text_metrics2);
+      text_metrics_cache.get_text_metrics(canvas, "a", text_metrics2);
       int tmp_width = ceil(text_metrics2.x_advance);
       max_line_width = max(max_line_width, point.x + tmp_width);
       point.y_line++;
@@ -662,11 +952,123 @@ namespace waytk
       return TextDimension(0, 0, 0);
   }
   
+  bool Text::has_fixed_font_pitch(Canvas *canvas)
+  {
+    if(_M_has_monospace_font) return true;
+    if(!_M_has_checked_font_pitch) {
+      // The font pitch is fixed if the narrowest character and the widest
+      // character have same advance.
+      TextMetrics text_metrics1, text_metrics2;
+      canvas->get_text_matrics("i", text_metrics1);
+      canvas->get_text_matrics("W", text_metrics2);
+      _M_has_fixed_font_pitch = (ceil(text_metrics1.x_advance) == ceil(text_metrics2.x_advance));
+      _M_has_checked_font_pitch = true;
+    }
+    return _M_has_fixed_font_pitch;
+  }
+
+  bool Text::find_column_from_cached_column(const TextCharIterator &iter, size_t &column)
+  {
+    if(!_M_has_cached_column || _M_cached_column_tab_spaces != tab_spaces()) return false;
+    // The column is found by walking from the cached column to the iterator
+    // in the same line so that moving the cursor doesn't walk the whole line.
+    column = _M_cached_column;
+    if(_M_cached_column_iter <= iter) {
+      for(auto tmp_iter = _M_cached_column_iter; tmp_iter != iter; tmp_iter++) {
+        if(tmp_iter == _M_buffer->char_end() || **tmp_iter == '\n') return false;
+        if(**tmp_iter == '\t')
+          column += tab_spaces() - column % tab_spaces();
+        else
+          column++;
+      }
+    } else {
+      // A tab column depends on the previous characters, so a walk back
+      // stops at a tab.
+      for(auto tmp_iter = _M_cached_column_iter; tmp_iter != iter;) {
+        tmp_iter--;
+        if(**tmp_iter == '\n' || **tmp_iter == '\t') return false;
+        column--;
+      }
+    }
+    return true;
+  }
+
   size_t Text::cursor_column(Canvas *canvas)
   { return iter_column(canvas, _M_buffer->cursor_iter()); }
 
+  bool Text::find_fixed_column(const TextCharIterator &iter, size_t &column) const
+  {
+    if(!has_valid_line_index()) return false;
+    size_t offset = _M_buffer->char_iter_to_byte_offset(iter);
+    size_t line = offset_line(offset);
+    if(!_M_line_fixed_column_flags[line]) return false;
+    column = offset - _M_line_offsets[line];
+    if(_M_input_type == InputType::MULTI_LINE && _M_has_line_wrap) {
+      // A text line which is broken before any character has display lines
+      // of equal number of columns for a monospace font. A text line which
+      // is broken between words is still walked.
+      if(!_M_has_word_wrap || !_M_has_char_advances || _M_char_advance <= 0) return false;
+      if(!_M_has_monospace_font && !(_M_has_checked_font_pitch && _M_has_fixed_font_pitch)) return false;
+      size_t column_count = max(content_size().width / _M_char_advance, 1);
+      if(column > 0 && column == _M_line_columns[line])
+        column -= ((column - 1) / column_count) * column_count;
+      else
+        column %= column_count;
+    }
+    return true;
+  }
+
+  bool Text::find_fixed_column_iter(const TextCharIterator &line_iter, size_t column, TextCharIterator &iter) const
+  {
+    if(!has_valid_line_index() || (_M_input_type == InputType::MULTI_LINE && _M_has_line_wrap)) return false;
+    size_t offset = _M_buffer->char_iter_to_byte_offset(line_iter);
+    size_t line = offset_line(offset);
+    if(offset != _M_line_offsets[line] || !_M_line_fixed_column_flags[line]) return false;
+    iter = _M_buffer->byte_offset_to_char_iter(offset + min(column, _M_line_columns[line]));
+    return true;
+  }
+
+  bool Text::find_fixed_pitch_x(const TextCharIterator &iter, int &x) const
+  {
+    if(!_M_has_char_advances) return false;
+    size_t column;
+    if(!find_fixed_column(iter, column)) return false;
+    // Each character of a password has the advance of the black circle.
+    if(_M_input_type == InputType::PASSWORD) {
+      x = column * _M_password_char_advance;
+      return true;
+    }
+    if(!_M_has_monospace_font && !(_M_has_checked_font_pitch && _M_has_fixed_font_pitch)) return false;
+    x = column * _M_char_advance;
+    return true;
+  }
+
   size_t Text::iter_column(Canvas *canvas, TextCharIterator iter)
   {
+    size_t column;
+    if(find_fixed_column(iter, column)) return column;
+    if(_M_input_type != InputType::MULTI_LINE || !_M_has_line_wrap) {
+      // Columns of a text without line wrap don't depend on the font, so
+      // they are counted without the canvas. A password character always
+      // takes one column.
+      bool is_password = (_M_input_type == InputType::PASSWORD);
+      if(is_password || !find_column_from_cached_column(iter, column)) {
+        column = 0;
+        for(auto tmp_iter = TextLineIterator(iter).char_iter(); tmp_iter != iter && tmp_iter != _M_buffer->char_end(); tmp_iter++) {
+          if(**tmp_iter == '\t' && !is_password)
+            column += tab_spaces() - column % tab_spaces();
+          else
+            column++;
+        }
+      }
+      if(!is_password) {
+        _M_has_cached_column = true;
+        _M_cached_column_iter = iter;
+        _M_cached_column = column;
+        _M_cached_column_tab_spaces = tab_spaces();
+      }
+      return column;
+    }
     TextLineIterator line_iter(iter);
     size_t tmp_iter_column;
     for_text(canvas, line_iter.char_iter(),
@@ -693,7 +1095,13 @@ namespace waytk
   void Text::update_cursor_iter_for_move_up_down(Canvas *canvas, long y_line)
   {
     TextCharIterator new_cursor_iter;
-    if(y_line < 0) {
+    if(y_line != 0 && _M_input_type == InputType::MULTI_LINE && !_M_has_line_wrap && has_valid_line_index()) {
+      // Each text line is one display line without line wrap, so the new
+      // line is found in the line index.
+      long line = static_cast<long>(iter_line(_M_buffer->cursor_iter())) + y_line;
+      line = min(max(line, 0L), static_cast<long>(_M_line_offsets.size()) - 1);
+      new_cursor_iter = _M_buffer->byte_offset_to_char_iter(_M_line_offsets[line]);
+    } else if(y_line < 0) {
       TextLineIterator line_iter(_M_buffer->cursor_iter());
       long tmp_y_line = 0;
       TextDimension size = for_text(canvas, line_iter.char_iter(),
@@ -725,7 +1133,7 @@ namespace waytk
       [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
         if(iter == _M_buffer->cursor_iter()) {
           tmp_y_line = point.y_line;
-          make_pair(false, false);
+          return make_pair(false, false);
         }
         return make_pair(true, false);
       },
@@ -753,28 +1161,33 @@ namespace waytk
       else
         tmp_cursor_column = cursor_column(canvas);
       _M_buffer->set_saved_column(tmp_cursor_column);
-      TextPoint old_point;
-      TextCharIterator old_iter;
-      for_text(canvas, new_cursor_iter,
-      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
-        if(column == tmp_cursor_column) {
-          new_cursor_iter = iter;
-          return make_pair(false, false);
-        }
-        if(**iter == '\n' || is_line_break) {
-          new_cursor_iter = iter;
-          return make_pair(false, false);
-        }
-        if(old_point.y_line != point.y_line) {
-          new_cursor_iter = old_iter;
-          return make_pair(false, false);
-        }
-        return make_pair(true, false);
-      },
-      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
-        old_point = point;
-        old_iter = iter;
-      });
+      TextCharIterator tmp_iter;
+      if(find_fixed_column_iter(new_cursor_iter, tmp_cursor_column, tmp_iter)) {
+        new_cursor_iter = tmp_iter;
+      } else {
+        TextPoint old_point;
+        TextCharIterator old_iter;
+        for_text(canvas, new_cursor_iter,
+        [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+          if(column == tmp_cursor_column) {
+            new_cursor_iter = iter;
+            return make_pair(false, false);
+          }
+          if(**iter == '\n' || is_line_break) {
+            new_cursor_iter = iter;
+            return make_pair(false, false);
+          }
+          if(old_point.y_line != point.y_line) {
+            new_cursor_iter = old_iter;
+            return make_pair(false, false);
+          }
+          return make_pair(true, false);
+        },
+        [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+          old_point = point;
+          old_iter = iter;
+        });
+      }
     } else
       new_cursor_iter = _M_buffer->cursor_iter();
     size_t tmp_saved_column = _M_buffer->saved_column();
@@ -884,14 +1297,14 @@ namespace waytk
 
   void Text::draw_cursor(Canvas *canvas, const Rectangle<int> &rect)
   {
-    canvas->set_color(styles()->foreground_color(pseudo_classes()));
+    canvas->set_color(foreground_color());
     if(_M_has_insert_mode) {
-      Color color = styles()->foreground_color(pseudo_classes());
+      Color color = foreground_color();
       Color tmp_color(color.red(), color.green(), color.blue(), color.alpha() / 2);
       canvas->set_color(tmp_color);
       canvas->rect(rect.x, rect.y, rect.width, rect.height);
     } else {
-      canvas->set_color(styles()->foreground_color(pseudo_classes()));
+      canvas->set_color(foreground_color());
       canvas->rect(rect.x, rect.y, 2, rect.height);
     }
     canvas->fill();
@@ -980,6 +1393,7 @@ namespace waytk
       _M_view_point.y_offset = 0;
       _M_visible_point.y = 0;
     }
+    update_view_point_for_first_visible_iter(canvas);
   }
 
   void Text::update_first_visible_iter_for_move_down(Canvas *canvas)
@@ -1080,6 +1494,7 @@ namespace waytk
       _M_visible_point.y = -_M_view_point.y_offset;
       canvas->restore();
     }
+    update_view_point_for_first_visible_iter(canvas);
   }
 
   long Text::cursor_y_line(Canvas *canvas)
@@ -1205,10 +1620,22 @@ namespace waytk
         canvas->restore();
       }
     }
+    update_view_point_for_first_visible_iter(canvas);
   }
 
   void Text::update_visible_point_for_move_left(Canvas *canvas)
   {
+    int cursor_x;
+    if(find_fixed_pitch_x(cursor_iter(), cursor_x)) {
+      // The cursor position of a monospace text is computed from its column.
+      if(cursor_x + _M_visible_point.x >= 0 && cursor_x + _M_visible_point.x < content_size().width) return;
+      if(cursor_x + content_size().width >= _M_client_size.width)
+        _M_view_point.x = max(_M_client_size.width - content_size().width, 0);
+      else
+        _M_view_point.x = cursor_x;
+      _M_visible_point.x = -_M_view_point.x;
+      return;
+    }
     auto cursor_line_iter = align_to_line(canvas, cursor_iter());
     TextPoint old_point(0, 0, 0);
     bool is_cursor = false;
@@ -1265,6 +1692,17 @@ namespace waytk
 
   void Text::update_visible_point_for_move_right(Canvas *canvas)
   {
+    int cursor_x;
+    if(find_fixed_pitch_x(cursor_iter(), cursor_x)) {
+      // The cursor position of a monospace text is computed from its column.
+      if(cursor_x + _M_visible_point.x >= 0 && cursor_x + _M_visible_point.x < content_size().width) return;
+      if(cursor_x + _M_char_advance >= _M_client_size.width)
+        _M_view_point.x = max(_M_client_size.width - content_size().width, 0);
+      else
+        _M_view_point.x = max(cursor_x - (content_size().width - _M_char_advance), 0);
+      _M_visible_point.x = -_M_view_point.x;
+      return;
+    }
     auto cursor_line_iter = align_to_line(canvas, cursor_iter());
     TextPoint old_point(0, 0, 0);
     bool is_cursor = false;
@@ -1323,4 +1761,239 @@ namespace waytk
       });
     }
   }
+
+  bool Text::has_valid_line_index() const
+  { return _M_has_line_index && _M_line_offsets.size() == _M_buffer->line_count() + 1 && _M_line_index_byte_count == _M_buffer->byte_count() && _M_line_index_tab_spaces == tab_spaces(); }
+
+  void Text::update_line_index(Canvas *canvas)
+  {
+    if(!has_valid_line_index()) {
+      _M_line_offsets.clear();
+      _M_line_char_indices.clear();
+      _M_line_columns.clear();
+      _M_line_fixed_column_flags.clear();
+      scan_lines(0, _M_buffer->byte_count(), 0, _M_line_offsets, _M_line_char_indices, _M_line_columns, _M_line_fixed_column_flags);
+      _M_max_line_columns = *max_element(_M_line_columns.begin(), _M_line_columns.end());
+      // Each text line initially has one display line.
+      _M_line_height_lines.assign(_M_line_offsets.size(), 1);
+      build_line_height_line_tree();
+      _M_line_index_byte_count = _M_buffer->byte_count();
+      _M_line_index_tab_spaces = tab_spaces();
+      _M_has_line_index = true;
+    }
+    canvas->save();
+    if(_M_has_font) canvas->set_font_face(_M_font_name, _M_font_slant, _M_font_weight);
+    if(_M_has_font_size) canvas->set_font_size(_M_font_size);
+    FontMetrics font_metrics;
+    canvas->get_font_matrics(font_metrics);
+    TextMetrics text_metrics;
+    canvas->get_text_matrics("a", text_metrics);
+    if(!_M_has_char_advances) {
+      // The advances and the font pitch are kept, so the columns and the
+      // positions of a monospace text are computed without the canvas.
+      TextMetrics text_metrics2;
+      canvas->get_text_matrics("\342\227\217", text_metrics2); // Black circle.
+      has_fixed_font_pitch(canvas);
+      _M_char_advance = ceil(text_metrics.x_advance);
+      _M_password_char_advance = ceil(text_metrics2.x_advance);
+      _M_has_char_advances = true;
+    }
+    canvas->restore();
+    _M_line_height = ceil(font_metrics.height);
+    if(_M_input_type == InputType::MULTI_LINE) {
+      _M_client_size.height_line = tree_sum(_M_line_height_line_tree, _M_line_offsets.size());
+      if(_M_has_line_wrap)
+        _M_client_size.width = content_size().width;
+      else
+        _M_client_size.width = _M_max_line_columns * ceil(text_metrics.x_advance);
+    } else {
+      _M_client_size.height_line = 1;
+      _M_client_size.width = _M_max_line_columns * ceil(text_metrics.x_advance);
+    }
+    _M_client_size.height_offset = 0;
+  }
+
+  void Text::update_line_index_for_change(size_t offset, size_t deleted_byte_count, size_t inserted_byte_count)
+  {
+    if(!_M_has_line_index) return;
+    if(_M_line_index_byte_count + inserted_byte_count - deleted_byte_count != _M_buffer->byte_count()) {
+      _M_has_line_index = false;
+      return;
+    }
+    // Only the changed text lines are scanned again, and the offsets of the
+    // following text lines are shifted.
+    size_t line = offset_line(offset);
+    size_t end_line = upper_bound(_M_line_offsets.begin() + line + 1, _M_line_offsets.end(), offset + deleted_byte_count) - _M_line_offsets.begin();
+    size_t end_offset;
+    if(end_line < _M_line_offsets.size()) {
+      end_offset = _M_line_offsets[end_line] + inserted_byte_count;
+      end_offset -= deleted_byte_count;
+    } else
+      end_offset = _M_buffer->byte_count();
+    vector<size_t> line_offsets, line_char_indices, line_columns;
+    vector<bool> line_fixed_column_flags;
+    scan_lines(_M_line_offsets[line], end_offset, _M_line_char_indices[line], line_offsets, line_char_indices, line_columns, line_fixed_column_flags);
+    if(end_line < _M_line_offsets.size()) {
+      // The last scanned line is the first following line.
+      size_t end_char_index = line_char_indices.back();
+      size_t old_end_char_index = _M_line_char_indices[end_line];
+      for(size_t i = end_line; i < _M_line_offsets.size(); i++) {
+        _M_line_offsets[i] += inserted_byte_count;
+        _M_line_offsets[i] -= deleted_byte_count;
+        _M_line_char_indices[i] += end_char_index;
+        _M_line_char_indices[i] -= old_end_char_index;
+      }
+      line_offsets.pop_back();
+      line_char_indices.pop_back();
+      line_columns.pop_back();
+      line_fixed_column_flags.pop_back();
+    }
+    bool has_max_line_columns = false;
+    for(size_t i = line; i < end_line; i++) {
+      if(_M_line_columns[i] == _M_max_line_columns) has_max_line_columns = true;
+    }
+    size_t max_line_columns = *max_element(line_columns.begin(), line_columns.end());
+    // The first changed line keeps its number of display lines until it is
+    // drawn again.
+    long first_height_line = _M_line_height_lines[line];
+    if(line_offsets.size() == end_line - line) {
+      std::copy(line_offsets.begin(), line_offsets.end(), _M_line_offsets.begin() + line);
+      std::copy(line_char_indices.begin(), line_char_indices.end(), _M_line_char_indices.begin() + line);
+      std::copy(line_columns.begin(), line_columns.end(), _M_line_columns.begin() + line);
+      std::copy(line_fixed_column_flags.begin(), line_fixed_column_flags.end(), _M_line_fixed_column_flags.begin() + line);
+      for(size_t i = line + 1; i < end_line; i++) set_line_height_line(i, 1);
+    } else {
+      _M_line_offsets.erase(_M_line_offsets.begin() + line, _M_line_offsets.begin() + end_line);
+      _M_line_offsets.insert(_M_line_offsets.begin() + line, line_offsets.begin(), line_offsets.end());
+      _M_line_char_indices.erase(_M_line_char_indices.begin() + line, _M_line_char_indices.begin() + end_line);
+      _M_line_char_indices.insert(_M_line_char_indices.begin() + line, line_char_indices.begin(), line_char_indices.end());
+      _M_line_columns.erase(_M_line_columns.begin() + line, _M_line_columns.begin() + end_line);
+      _M_line_columns.insert(_M_line_columns.begin() + line, line_columns.begin(), line_columns.end());
+      _M_line_fixed_column_flags.erase(_M_line_fixed_column_flags.begin() + line, _M_line_fixed_column_flags.begin() + end_line);
+      _M_line_fixed_column_flags.insert(_M_line_fixed_column_flags.begin() + line, line_fixed_column_flags.begin(), line_fixed_column_flags.end());
+      _M_line_height_lines.erase(_M_line_height_lines.begin() + line, _M_line_height_lines.begin() + end_line);
+      _M_line_height_lines.insert(_M_line_height_lines.begin() + line, line_offsets.size(), 1);
+      _M_line_height_lines[line] = first_height_line;
+      build_line_height_line_tree();
+      _M_client_size.height_line = tree_sum(_M_line_height_line_tree, _M_line_offsets.size());
+    }
+    if(max_line_columns >= _M_max_line_columns)
+      _M_max_line_columns = max_line_columns;
+    else if(has_max_line_columns)
+      _M_max_line_columns = *max_element(_M_line_columns.begin(), _M_line_columns.end());
+    _M_line_index_byte_count = _M_buffer->byte_count();
+  }
+
+  void Text::scan_lines(size_t offset, size_t end_offset, size_t char_index, vector<size_t> &line_offsets, vector<size_t> &line_char_indices, vector<size_t> &line_columns, vector<bool> &line_fixed_column_flags)
+  {
+    // The text lines are indexed without measuring the characters. A text
+    // line has fixed columns if each its character is one byte and takes one
+    // column, so the columns of the line are its byte offsets.
+    line_offsets.push_back(offset);
+    line_char_indices.push_back(char_index);
+    size_t column = 0;
+    bool has_fixed_columns = true;
+    auto byte_iter = _M_buffer->byte_offset_to_char_iter(offset).byte_iter();
+    for(; offset < end_offset; offset++, byte_iter++) {
+      unsigned char c = *byte_iter;
+      if(c >= 0x80) has_fixed_columns = false;
+      if((c & 0xc0) == 0x80) continue;
+      char_index++;
+      if(c == '\n') {
+        line_columns.push_back(column);
+        line_fixed_column_flags.push_back(has_fixed_columns);
+        column = 0;
+        has_fixed_columns = true;
+        line_offsets.push_back(offset + 1);
+        line_char_indices.push_back(char_index);
+      } else if(c == '\t') {
+        if(tab_spaces() - column % tab_spaces() != 1) has_fixed_columns = false;
+        column += tab_spaces() - column % tab_spaces();
+      } else
+        column++;
+    }
+    line_columns.push_back(column);
+    line_fixed_column_flags.push_back(has_fixed_columns);
+  }
+
+  void Text::build_line_height_line_tree()
+  {
+    // The tree is built in a linear time.
+    _M_line_height_line_tree.assign(_M_line_height_lines.size() + 1, 0);
+    for(size_t i = 1; i < _M_line_height_line_tree.size(); i++) {
+      _M_line_height_line_tree[i] += _M_line_height_lines[i - 1];
+      size_t j = i + (i & (~i + 1));
+      if(j < _M_line_height_line_tree.size()) _M_line_height_line_tree[j] += _M_line_height_line_tree[i];
+    }
+  }
+
+  size_t Text::iter_line(const TextCharIterator &iter) const
+  { return offset_line(_M_buffer->char_iter_to_byte_offset(iter)); }
+
+  size_t Text::offset_line(size_t offset) const
+  {
+    auto offset_iter = upper_bound(_M_line_offsets.begin(), _M_line_offsets.end(), offset);
+    return offset_iter != _M_line_offsets.begin() ? (offset_iter - _M_line_offsets.begin()) - 1 : 0;
+  }
+
+  void Text::set_line_height_line(size_t line, long height_line)
+  {
+    long old_height_line = _M_line_height_lines[line];
+    if(height_line != old_height_line) {
+      _M_line_height_lines[line] = height_line;
+      add_onto_tree_elem(_M_line_height_line_tree, line, height_line - old_height_line);
+      _M_client_size.height_line += height_line - old_height_line;
+    }
+  }
+
+  void Text::update_first_visible_iter_for_view_point(Canvas *canvas)
+  {
+    update_line_index(canvas);
+    long line_y_line;
+    size_t line = find_in_tree(_M_line_height_line_tree, _M_view_point.y_line, line_y_line);
+    auto line_iter = _M_buffer->byte_offset_to_char_iter(_M_line_offsets[line]);
+    _M_first_visible_iter = line_iter;
+    _M_first_visible_color_index = _M_line_char_indices[line];
+    long y_line = _M_view_point.y_line - line_y_line;
+    if(y_line > 0) {
+      // Only the first visible text line is laid out to find the display line.
+      for_text(canvas, line_iter,
+      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+        if(iter == _M_buffer->char_end() || point.y_line >= y_line || **iter == '\n') {
+          _M_first_visible_iter = iter;
+          return make_pair(false, iter == _M_buffer->char_end());
+        }
+        return make_pair(true, false);
+      },
+      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+        _M_first_visible_color_index++;
+      });
+    }
+    _M_visible_point.x = -_M_view_point.x;
+    _M_visible_point.y = -_M_view_point.y_offset;
+    _M_has_view_point_change = false;
+  }
+
+  void Text::update_view_point_for_first_visible_iter(Canvas *canvas)
+  {
+    if(!_M_has_line_index || _M_input_type != InputType::MULTI_LINE) return;
+    // The view point is found from the line index so that the viewport
+    // follows the first visible iterator that is moved with the cursor.
+    size_t line = iter_line(_M_first_visible_iter);
+    auto line_iter = _M_buffer->byte_offset_to_char_iter(_M_line_offsets[line]);
+    long y_line = tree_sum(_M_line_height_line_tree, line);
+    if(_M_has_line_wrap && line_iter != _M_first_visible_iter) {
+      for_text(canvas, line_iter,
+      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+        if(iter == _M_first_visible_iter || iter == _M_buffer->char_end()) {
+          y_line += point.y_line;
+          return make_pair(false, false);
+        }
+        return make_pair(true, false);
+      },
+      [&](const FontMetrics &font_metrics, const TextMetrics &text_metrics, const TextCharIterator &iter, const TextPoint &point, size_t column, bool is_line_break) {
+      });
+    }
+    _M_view_point.y_line = y_line;
+  }
 }
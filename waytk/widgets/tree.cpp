@@ -65,6 +65,7 @@ namespace waytk
     copy_if(paths.begin(), paths.end(), tmp_inserter, [this](const TreePath &path) {
       return _M_adapter->has_node(path);
     });
+    invalidate();
     on_tree_selection(_M_selected_paths);
   }
 
@@ -75,7 +76,10 @@ namespace waytk
       TreePath path({ root_idx });
       were_all_selected &= select_branch(path);
     }
-    if(were_all_selected) on_tree_selection(_M_selected_paths);
+    if(were_all_selected) {
+      invalidate();
+      on_tree_selection(_M_selected_paths);
+    }
   }
 
   void Tree::change_selection(const Range<size_t> &item_pos_range)
@@ -87,6 +91,7 @@ namespace waytk
         TreePath path;
         change_selection_for_branch(item_pos_range, extended_node, path, pos);
       }
+      invalidate();
       on_tree_selection(_M_selected_paths);
     }
   }
@@ -95,7 +100,10 @@ namespace waytk
   {
     bool was_empty = _M_selected_paths.empty();
     _M_selected_paths.clear();
-    if(!was_empty) on_tree_selection(_M_selected_paths);
+    if(!was_empty) {
+      invalidate();
+      on_tree_selection(_M_selected_paths);
+    }
   }
 
   bool Tree::select_branch(TreePath &path)